@@ -6,9 +6,15 @@
 #include "byteorder.h"
 #include "types.h"
 #include "serial.h"
+#include "netdev.h"
+#include "log.h"
+#include "trace.h"
+#include "netstats.h"
+#include "capture.h"
+#include "kprintf.h"
+#include "region.h"
 
 // 引用外部变量
-extern bool disable_rtl_debug;
 extern struct net_device net_dev;
 extern const uint8_t broadcast_mac[6];
 
@@ -29,15 +35,28 @@ void clear_arp_cache(void) {
     serial_write_string("ARP cache cleared\r\n");
 }
 
+void arp_cache_save(struct arp_cache_entry *out) {
+    memcpy(out, arp_cache, sizeof(arp_cache));
+}
+
+void arp_cache_restore(const struct arp_cache_entry *in) {
+    memcpy(arp_cache, in, sizeof(arp_cache));
+}
+
 // 发送ARP请求包
 bool send_arp_request(uint32_t target_ip) {
-    serial_write_string("Sending ARP request for IP: ");
-    serial_print_ip(target_ip);
-    serial_write_string("\r\n");
-    
-    // 创建包缓冲区
-    uint8_t buffer[42]; // 以太网帧大小 + ARP包大小
-    memset(buffer, 0, sizeof(buffer));
+    LOG_INFO(ARP, "request for " IP_FMT, IP_ARGS(target_ip));
+
+    // 直接在网卡发送缓冲区中构造帧
+    struct netdev *dev = netdev_get_default();
+    uint16_t frame_length = sizeof(struct eth_header) + sizeof(struct arp_packet);
+    uint8_t *buffer = netdev_tx_reserve(dev, frame_length);
+    if (!buffer) {
+        LOG_WARN(ARP, "no TX buffer available");
+        return false;
+    }
+    NETSTATS_INC(arp, out_requests);
+    memset(buffer, 0, frame_length);
     
     // 设置以太网帧头
     struct eth_header *eth = (struct eth_header *)buffer;
@@ -65,14 +84,16 @@ bool send_arp_request(uint32_t target_ip) {
     arp->target_ip = htonl(target_ip);
     
     // 发送ARP请求
-    serial_write_string("ARP packet prepared, sending...\r\n");
-    return network_send_packet(buffer, sizeof(buffer));
+    return netdev_tx_commit(dev, frame_length, NULL);
 }
 
 // 处理接收到的ARP包
 void handle_arp_packet(uint8_t *packet, uint16_t length) {
+    NETSTATS_INC(arp, in_packets);
     if (length < sizeof(struct eth_header) + sizeof(struct arp_packet)) {
-        terminal_writestring("ARP packet too short\n");
+        NETSTATS_INC(arp, in_errors);
+        CAPTURE_DROP(CAPTURE_DROP_ARP_INVALID);
+        LOG_DEBUG(ARP, "packet too short (%u bytes)", length);
         return;
     }
     
@@ -82,7 +103,9 @@ void handle_arp_packet(uint8_t *packet, uint16_t length) {
     // 检查ARP包类型
     if (ntohs(arp->hardware_type) != 1 || ntohs(arp->protocol_type) != 0x0800 ||
         arp->hardware_size != 6 || arp->protocol_size != 4) {
-        terminal_writestring("Invalid ARP packet\n");
+        NETSTATS_INC(arp, in_errors);
+        CAPTURE_DROP(CAPTURE_DROP_ARP_INVALID);
+        LOG_DEBUG(ARP, "invalid packet");
         return;
     }
     
@@ -90,30 +113,21 @@ void handle_arp_packet(uint8_t *packet, uint16_t length) {
     uint32_t sender_ip = ntohl(arp->sender_ip);
     uint32_t target_ip = ntohl(arp->target_ip);
     
-    serial_write_string("Received ARP packet: ");
+    const char *op = "UNKNOWN";
     if (ntohs(arp->opcode) == ARP_REQUEST) {
-        serial_write_string("REQUEST");
+        op = "REQUEST";
+        NETSTATS_INC(arp, in_requests);
     } else if (ntohs(arp->opcode) == ARP_REPLY) {
-        serial_write_string("REPLY");
-    } else {
-        serial_write_string("UNKNOWN TYPE");
+        op = "REPLY";
+        NETSTATS_INC(arp, in_replies);
     }
-    
-    serial_write_string("\r\nFrom IP: ");
-    serial_print_ip(sender_ip); // Use the host byte order IP for display
-    serial_write_string(" MAC: ");
-    for (int i = 0; i < 6; i++) {
-        serial_write_hex_byte(arp->sender_mac[i]);
-        if (i < 5) serial_write_string(":");
-    }
-    serial_write_string("\r\n");
+    LOG_DEBUG(ARP, "%s from " IP_FMT " " MAC_FMT, op, IP_ARGS(sender_ip), MAC_ARGS(arp->sender_mac));
     
     // 更新ARP缓存 (使用主机字节序)
     update_arp_cache(sender_ip, arp->sender_mac);
     
     // 如果收到ARP请求并且目标IP是我们的IP, 则发送ARP应答
     if (ntohs(arp->opcode) == ARP_REQUEST && target_ip == net_dev.ip_addr) {
-        serial_write_string("Received ARP request for our IP, responding...\r\n");
         
         // 交换MAC和IP地址
         memcpy(eth->dest_mac, eth->src_mac, 6);
@@ -131,26 +145,30 @@ void handle_arp_packet(uint8_t *packet, uint16_t length) {
         arp->sender_ip = htonl(net_dev.ip_addr); // Convert to network byte order
         
         // 发送ARP应答
-        network_send_packet(packet, length);
-        serial_write_string("ARP reply sent\r\n");
+        if (network_send_packet(packet, length)) {
+            NETSTATS_INC(arp, out_replies);
+        }
+        LOG_INFO(ARP, "reply sent to " IP_FMT, IP_ARGS(sender_ip));
     }
 }
 
 // 从缓存中查找MAC地址
 bool get_mac_from_cache(uint32_t ip_addr, uint8_t *mac_out) {
+    REGION_BEGIN(lookup);
     for (int i = 0; i < ARP_CACHE_SIZE; i++) {
         if (arp_cache[i].valid && arp_cache[i].ip_addr == ip_addr) {
             memcpy(mac_out, arp_cache[i].mac_addr, 6);
-            serial_write_string("MAC found in cache for IP: ");
-            serial_print_ip(ip_addr);
-            serial_write_string("\r\n");
+            REGION_END(REGION_ARP_LOOKUP, lookup);
+            TRACE(TRACE_ARP_HIT, ip_addr, 0, 0);
+            NETSTATS_INC(arp, cache_hits);
             return true;
         }
     }
-    
-    serial_write_string("MAC not found in cache for IP: ");
-    serial_print_ip(ip_addr);
-    serial_write_string("\r\n");
+    REGION_END(REGION_ARP_LOOKUP, lookup);
+
+    TRACE(TRACE_ARP_MISS, ip_addr, 0, 0);
+    NETSTATS_INC(arp, cache_misses);
+    LOG_DEBUG(ARP, "cache miss for " IP_FMT, IP_ARGS(ip_addr));
     return false;
 }
 
@@ -161,9 +179,6 @@ void update_arp_cache(uint32_t ip_addr, uint8_t *mac_addr) {
         if (arp_cache[i].valid && arp_cache[i].ip_addr == ip_addr) {
             // 更新现有条目
             memcpy(arp_cache[i].mac_addr, mac_addr, 6);
-            serial_write_string("Updated existing ARP cache entry for IP: ");
-            serial_print_ip(ip_addr);
-            serial_write_string("\r\n");
             return;
         }
     }
@@ -175,9 +190,7 @@ void update_arp_cache(uint32_t ip_addr, uint8_t *mac_addr) {
             arp_cache[i].ip_addr = ip_addr;
             memcpy(arp_cache[i].mac_addr, mac_addr, 6);
             arp_cache[i].valid = true;
-            serial_write_string("Added new ARP cache entry for IP: ");
-            serial_print_ip(ip_addr);
-            serial_write_string("\r\n");
+            LOG_INFO(ARP, "added " IP_FMT " " MAC_FMT, IP_ARGS(ip_addr), MAC_ARGS(mac_addr));
             return;
         }
     }
@@ -185,21 +198,20 @@ void update_arp_cache(uint32_t ip_addr, uint8_t *mac_addr) {
     // 缓存满了，替换第一个条目
     arp_cache[0].ip_addr = ip_addr;
     memcpy(arp_cache[0].mac_addr, mac_addr, 6);
-    serial_write_string("ARP cache full, replaced first entry with IP: ");
-    serial_print_ip(ip_addr);
-    serial_write_string("\r\n");
+    LOG_WARN(ARP, "cache full, replaced first entry with " IP_FMT, IP_ARGS(ip_addr));
 }
 
 // 解析IP到MAC地址 (先查缓存, 如果没有则发送ARP请求)
 bool arp_resolve(uint32_t ip_addr, uint8_t *mac_out) {
-    serial_write_string("Resolving IP: ");
-    serial_print_ip(ip_addr);
-    serial_write_string("\r\n");
-    
+    // 回环地址不需要ARP，使用全零MAC
+    if (ip_is_loopback(ip_addr)) {
+        memset(mac_out, 0, 6);
+        return true;
+    }
+
     // 检查是否是本机IP
     if (ip_addr == net_dev.ip_addr) {
         memcpy(mac_out, net_dev.mac_addr, 6);
-        serial_write_string("IP is our own IP, using our MAC\r\n");
         return true;
     }
     
@@ -211,6 +223,31 @@ bool arp_resolve(uint32_t ip_addr, uint8_t *mac_out) {
     // 缓存中没有，可以尝试发送ARP请求，但这个实现中
     // 我们只检查缓存，因为发送ARP请求后需要等待处理ARP回复，
     // 这是异步的操作，不适合在这个函数中完成。
-    serial_write_string("IP not in cache and not our IP, resolution failed\r\n");
+    LOG_DEBUG(ARP, "cannot resolve " IP_FMT, IP_ARGS(ip_addr));
     return false;
-} 
\ No newline at end of file
+} 
+
+int arp_cache_count(void) {
+    int count = 0;
+    for (int i = 0; i < ARP_CACHE_SIZE; i++) {
+        if (arp_cache[i].valid) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void arp_dump_cache(void) {
+    char line[64];
+    for (int i = 0; i < ARP_CACHE_SIZE; i++) {
+        if (!arp_cache[i].valid) {
+            continue;
+        }
+        char ip[16];
+        ksnprintf(ip, sizeof(ip), IP_FMT, IP_ARGS(arp_cache[i].ip_addr));
+        ksnprintf(line, sizeof(line), "%-15s " MAC_FMT "\n", ip, MAC_ARGS(arp_cache[i].mac_addr));
+        serial_write_string(line);
+    }
+    ksnprintf(line, sizeof(line), "%d/%d entries\n", arp_cache_count(), ARP_CACHE_SIZE);
+    serial_write_string(line);
+}
@@ -41,5 +41,12 @@ void handle_arp_packet(uint8_t *packet, uint16_t length);
 bool get_mac_from_cache(uint32_t ip_addr, uint8_t *mac_out);  // 传入主机字节序
 void update_arp_cache(uint32_t ip_addr, uint8_t *mac_addr);  // 传入主机字节序
 bool arp_resolve(uint32_t ip_addr, uint8_t *mac_out);  // 解析IP到MAC地址
+// 复制出/写回整个缓存 (ARP_CACHE_SIZE 个条目)，基准测试用来填充并恢复缓存
+void arp_cache_save(struct arp_cache_entry *out);
+void arp_cache_restore(const struct arp_cache_entry *in);
+// 有效缓存条目数
+int arp_cache_count(void);
+// 把缓存内容输出到串口
+void arp_dump_cache(void);
 
 #endif // ARP_H 
\ No newline at end of file
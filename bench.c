@@ -0,0 +1,206 @@
+#include "bench.h"
+#include "tsc.h"
+#include "cpu.h"
+#include "kprintf.h"
+#include "serial.h"
+#include "memory.h"
+#include "network.h"
+#include "arp.h"
+#include "log.h"
+#include "byteorder.h"
+
+#define BENCH_BUF_SIZE 4096
+
+static uint8_t bench_src[BENCH_BUF_SIZE] __attribute__((aligned(16)));
+static uint8_t bench_dst[BENCH_BUF_SIZE] __attribute__((aligned(16)));
+
+// 防止编译器把结果当作无用计算删掉
+static volatile uint32_t bench_sink;
+
+static void bench_memcpy(uint32_t iterations, uint32_t size) {
+    for (uint32_t i = 0; i < iterations; i++) {
+        memcpy(bench_dst, bench_src, size);
+    }
+    bench_sink += bench_dst[0];
+}
+
+static void bench_memset(uint32_t iterations, uint32_t size) {
+    for (uint32_t i = 0; i < iterations; i++) {
+        memset(bench_dst, (int)i, size);
+    }
+    bench_sink += bench_dst[0];
+}
+
+static void bench_checksum(uint32_t iterations, uint32_t size) {
+    for (uint32_t i = 0; i < iterations; i++) {
+        bench_sink += network_checksum(bench_src, size);
+    }
+}
+
+// ARP查找: 缓存中填入 fill 个条目，命中时轮流查找每个条目，未命中时查找不存在的地址
+// 低16位是填充数，BENCH_ARP_MISS 位表示未命中; 运行前后保存并恢复真实缓存
+#define BENCH_ARP_MISS 0x10000
+#define BENCH_ARP_BASE 0xC0A86400   // 192.168.100.0
+
+static void bench_arp_lookup(uint32_t iterations, uint32_t arg) {
+    static struct arp_cache_entry saved[ARP_CACHE_SIZE];
+    static struct arp_cache_entry table[ARP_CACHE_SIZE];
+    uint32_t fill = arg & 0xFFFF;
+    bool miss = arg & BENCH_ARP_MISS;
+    uint8_t mac[6];
+
+    arp_cache_save(saved);
+    memset(table, 0, sizeof(table));
+    for (uint32_t i = 0; i < fill && i < ARP_CACHE_SIZE; i++) {
+        table[i].ip_addr = BENCH_ARP_BASE + 1 + i;
+        table[i].mac_addr[5] = (uint8_t)i;
+        table[i].valid = true;
+    }
+    arp_cache_restore(table);
+    // 未命中路径有调试日志，运行期间不让它写进日志环
+    int level = log_get_level(LOG_SUBSYS_ARP);
+    log_set_level(LOG_SUBSYS_ARP, KLOG_WARN);
+
+    uint32_t slot = 0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        uint32_t ip = miss ? BENCH_ARP_BASE + 0xFF : BENCH_ARP_BASE + 1 + slot;
+        bench_sink += get_mac_from_cache(ip, mac);
+        if (++slot >= fill) {
+            slot = 0;
+        }
+    }
+
+    log_set_level(LOG_SUBSYS_ARP, level);
+    arp_cache_restore(saved);
+}
+
+// 在 bench_src 中放一个回显请求帧，作为构造应答的输入
+static void bench_prepare_echo_request(void) {
+    struct eth_header *eth = (struct eth_header *)bench_src;
+    struct ipv4_header *ip = (struct ipv4_header *)(bench_src + sizeof(struct eth_header));
+    struct icmp_header *icmp = (struct icmp_header *)(ip + 1);
+
+    memset(eth->dest_mac, 0x52, 6);
+    memset(eth->src_mac, 0x54, 6);
+    eth->type = htons(ETH_TYPE_IP);
+    ipv4_build_header(ip, IP_PROTO_ICMP, BENCH_ARP_BASE + 1, BENCH_ARP_BASE + 2,
+                      sizeof(struct icmp_header) + 56, 0, 0);
+    icmp->type = ICMP_TYPE_ECHO_REQUEST;
+    icmp->code = 0;
+    icmp->identifier = htons(1);
+    icmp->sequence = htons(1);
+}
+
+static void bench_icmp_reply(uint32_t iterations, uint32_t arg) {
+    (void)arg;
+    bench_prepare_echo_request();
+    for (uint32_t i = 0; i < iterations; i++) {
+        bench_sink += icmp_build_echo_reply(bench_dst, bench_src);
+    }
+}
+
+static void bench_ip_header(uint32_t iterations, uint32_t arg) {
+    (void)arg;
+    struct ipv4_header *ip = (struct ipv4_header *)bench_dst;
+    for (uint32_t i = 0; i < iterations; i++) {
+        ipv4_build_header(ip, IP_PROTO_TCP, BENCH_ARP_BASE + 1, BENCH_ARP_BASE + 2, 1460, (uint16_t)i, 0x4000);
+    }
+    bench_sink += ip->checksum;
+}
+
+// 分配器只增长，运行后把堆顶回退到开始时的位置
+static void bench_alloc_free(uint32_t iterations, uint32_t size) {
+    uintptr_t mark = memory_heap_mark();
+    for (uint32_t i = 0; i < iterations; i++) {
+        void *p = kmalloc(size);
+        bench_sink += (uint32_t)(uintptr_t)p;
+        kfree(p);
+    }
+    memory_heap_rewind(mark);
+}
+
+static const struct bench_case bench_cases[] = {
+    { "memcpy64", bench_memcpy, 64, 20000, 64 },
+    { "memcpy256", bench_memcpy, 256, 5000, 256 },
+    { "memcpy1500", bench_memcpy, 1500, 2000, 1500 },
+    { "memcpy4096", bench_memcpy, 4096, 500, 4096 },
+    { "memset64", bench_memset, 64, 20000, 64 },
+    { "memset256", bench_memset, 256, 5000, 256 },
+    { "memset1500", bench_memset, 1500, 2000, 1500 },
+    { "memset4096", bench_memset, 4096, 500, 4096 },
+    { "checksum20", bench_checksum, 20, 20000, 20 },
+    { "checksum64", bench_checksum, 64, 20000, 64 },
+    { "checksum1500", bench_checksum, 1500, 2000, 1500 },
+    { "arp_hit1", bench_arp_lookup, 1, 20000, 0 },
+    { "arp_hit8", bench_arp_lookup, 8, 20000, 0 },
+    { "arp_hit16", bench_arp_lookup, ARP_CACHE_SIZE, 20000, 0 },
+    { "arp_miss1", bench_arp_lookup, BENCH_ARP_MISS | 1, 20000, 0 },
+    { "arp_miss16", bench_arp_lookup, BENCH_ARP_MISS | ARP_CACHE_SIZE, 20000, 0 },
+    { "icmp_reply", bench_icmp_reply, 0, 20000, 0 },
+    { "ip_header", bench_ip_header, 0, 20000, 0 },
+    { "alloc_free64", bench_alloc_free, 64, 20000, 0 },
+    { "alloc_free1500", bench_alloc_free, 1500, 20000, 0 },
+};
+
+#define BENCH_NUM_CASES (sizeof(bench_cases) / sizeof(bench_cases[0]))
+
+static bool bench_name_equal(const char *a, const char *b) {
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+// 输出一行: 名称、次数、每次周期数和纳秒 (两位小数)、每周期字节数 (三位小数)
+// 先少量预热，预热和计时期间都关中断: 避免串口等中断处理混入结果，
+// 也避免中断中的收包路径与用例对ARP缓存、堆的保存/恢复交错
+static void bench_run_case(const struct bench_case *bc) {
+    char line[128];
+
+    uint32_t flags = local_irq_save();
+    bc->run(bc->iterations / 16 + 1, bc->arg);
+    uint64_t start = tsc_read_fenced();
+    bc->run(bc->iterations, bc->arg);
+    uint64_t cycles = tsc_read_fenced() - start;
+    local_irq_restore(flags);
+
+    uint32_t khz = tsc_khz();
+    uint32_t cycles_x100 = (uint32_t)div64_u32(cycles * 100, bc->iterations, NULL);
+    uint32_t ns_x100 = khz ? (uint32_t)div64_u32(div64_u32(cycles * 100000000ULL, khz, NULL),
+                                                 bc->iterations, NULL) : 0;
+    uint32_t bpc_x1000 = 0;
+    if (bc->bytes_per_op && cycles_x100) {
+        bpc_x1000 = (uint32_t)div64_u32((uint64_t)bc->bytes_per_op * 100000, cycles_x100, NULL);
+    }
+    ksnprintf(line, sizeof(line),
+              "bench %-16s iters=%u cycles/op=%u.%02u ns/op=%u.%02u bytes/cycle=%u.%03u\n",
+              bc->name, bc->iterations, cycles_x100 / 100, cycles_x100 % 100,
+              ns_x100 / 100, ns_x100 % 100, bpc_x1000 / 1000, bpc_x1000 % 1000);
+    serial_write_string(line);
+}
+
+int bench_run(const char *name) {
+    bool all = !name || bench_name_equal(name, "all");
+    int count = 0;
+    char line[48];
+
+    for (uint32_t i = 0; i < BENCH_NUM_CASES; i++) {
+        if (all || bench_name_equal(name, bench_cases[i].name)) {
+            if (count == 0) {
+                ksnprintf(line, sizeof(line), "# bench tsc_khz=%u\n", tsc_khz());
+                serial_write_string(line);
+            }
+            bench_run_case(&bench_cases[i]);
+            count++;
+        }
+    }
+    return count;
+}
+
+void bench_list(void) {
+    for (uint32_t i = 0; i < BENCH_NUM_CASES; i++) {
+        serial_write_string(bench_cases[i].name);
+        serial_write_string("\n");
+    }
+}
@@ -0,0 +1,24 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "types.h"
+
+// 微基准: 每个用例把被测操作执行 iterations 次，由框架计时
+// arg 是传给 run 的参数 (例如拷贝长度)，同一个函数可以注册多个规模
+struct bench_case {
+    const char *name;
+    void (*run)(uint32_t iterations, uint32_t arg);
+    uint32_t arg;
+    uint32_t iterations;
+    uint32_t bytes_per_op;    // 0 表示不按字节计算吞吐
+};
+
+// 运行名称匹配的用例; name 为 NULL 或 "all" 时运行全部，返回运行的用例数
+// 每个用例输出一行:
+//   bench <name> iters=N cycles/op=X.XX ns/op=X.XX bytes/cycle=X.XXX
+// 第一行为 "# bench tsc_khz=N"，便于主机脚本按空格和 '=' 切分
+int bench_run(const char *name);
+// 列出所有用例
+void bench_list(void);
+
+#endif // BENCH_H
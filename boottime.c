@@ -0,0 +1,52 @@
+#include "boottime.h"
+#include "tsc.h"
+#include "kprintf.h"
+#include "serial.h"
+
+struct boottime_mark {
+    const char *name;
+    uint64_t tsc;
+};
+
+static uint64_t boottime_entry;
+static struct boottime_mark boottime_marks[BOOTTIME_MAX_MARKS];
+static uint32_t boottime_count;
+
+void boottime_start(void) {
+    boottime_entry = tsc_read();
+    boottime_count = 0;
+}
+
+void boottime_mark(const char *name) {
+    if (boottime_count < BOOTTIME_MAX_MARKS) {
+        boottime_marks[boottime_count].name = name;
+        boottime_marks[boottime_count].tsc = tsc_read();
+        boottime_count++;
+    }
+}
+
+uint64_t boottime_elapsed_us(void) {
+    return tsc_to_us(tsc_read() - boottime_entry);
+}
+
+void boottime_dump(void) {
+    char line[80];
+    uint64_t prev = boottime_entry;
+    // 总时间到最后一个记录为止 (启动后几秒内的事件，32位微秒足够)
+    uint32_t total_us = boottime_count ? (uint32_t)tsc_to_us(boottime_marks[boottime_count - 1].tsc - boottime_entry) : 0;
+
+    ksnprintf(line, sizeof(line), "boot: tsc at kernel entry %llu us (firmware and loader)\n",
+              tsc_to_us(boottime_entry));
+    serial_write_string(line);
+    ksnprintf(line, sizeof(line), "%-22s %10s %10s %6s\n", "phase", "us", "at_us", "pct");
+    serial_write_string(line);
+    for (uint32_t i = 0; i < boottime_count; i++) {
+        uint64_t us = tsc_to_us(boottime_marks[i].tsc - prev);
+        // 占比以0.1%为单位，避免浮点
+        uint32_t permille = total_us ? (uint32_t)div64_u32(us * 1000, total_us, NULL) : 0;
+        ksnprintf(line, sizeof(line), "%-22s %10llu %10llu %4u.%u\n", boottime_marks[i].name,
+                  us, tsc_to_us(boottime_marks[i].tsc - boottime_entry), permille / 10, permille % 10);
+        serial_write_string(line);
+        prev = boottime_marks[i].tsc;
+    }
+}
@@ -0,0 +1,21 @@
+#ifndef BOOTTIME_H
+#define BOOTTIME_H
+
+#include "types.h"
+
+// 启动阶段计时: kernel_main 入口调用 boottime_start，之后每个初始化阶段结束时调用 boottime_mark
+// 记录时只读TSC，换算在输出时进行 (tsc_init 校准之前的阶段也能计时)
+// 启动完成后的一次性事件 (第一个收到的帧、网关解析完成) 也用 boottime_mark 记录
+
+#define BOOTTIME_MAX_MARKS 24
+
+// kernel_main 第一条语句; 此时的TSC值近似固件和引导程序用去的时间 (QEMU 复位时TSC从0开始)
+void boottime_start(void);
+// name 描述刚结束的阶段，必须是常量字符串; 超出 BOOTTIME_MAX_MARKS 的记录被丢弃
+void boottime_mark(const char *name);
+// 从 boottime_start 到现在的微秒数
+uint64_t boottime_elapsed_us(void);
+// 输出各阶段耗时、累计时间和占比
+void boottime_dump(void);
+
+#endif // BOOTTIME_H
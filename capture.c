@@ -0,0 +1,356 @@
+#include "capture.h"
+#include "network.h"
+#include "ipv4.h"
+#include "memory.h"
+#include "serial.h"
+#include "kprintf.h"
+#include "tsc.h"
+#include "cpu.h"
+
+struct capture_record {
+    uint64_t tsc;
+    uint32_t id;          // 写入完成后为序号+1，写入过程中为 0
+    uint32_t orig_len;
+    uint16_t cap_len;
+    uint8_t dir;
+    uint8_t drop;
+    uint8_t data[CAPTURE_SNAPLEN_MAX];
+};
+
+volatile bool capture_enabled = false;
+
+static struct capture_record capture_ring[CAPTURE_RING_SIZE];
+static volatile uint32_t capture_head = 0;
+static uint32_t capture_snaplen = CAPTURE_SNAPLEN_MAX;
+static struct capture_filter capture_filt;
+static uint32_t capture_filtered = 0;
+// 每个CPU正在接收处理的帧
+static uint32_t capture_rx_current[NR_CPUS];
+
+static const char *const capture_drop_names[CAPTURE_DROP_COUNT] = {
+    "none", "unknown_type", "arp_invalid", "ip_hdr", "ip_addr",
+    "ip_proto", "no_port", "tx_offload", "tx_device",
+};
+
+const char *capture_drop_name(uint32_t reason) {
+    return reason < CAPTURE_DROP_COUNT ? capture_drop_names[reason] : "?";
+}
+
+void capture_init(void) {
+    capture_enabled = false;
+    capture_snaplen = CAPTURE_SNAPLEN_MAX;
+    memset(&capture_filt, 0, sizeof(capture_filt));
+    capture_reset();
+}
+
+void capture_start(void) {
+    memset(capture_rx_current, 0, sizeof(capture_rx_current));
+    mb();
+    capture_enabled = true;
+}
+
+void capture_stop(void) {
+    capture_enabled = false;
+    mb();
+}
+
+void capture_reset(void) {
+    bool was_enabled = capture_enabled;
+    capture_stop();
+    for (uint32_t i = 0; i < CAPTURE_RING_SIZE; i++) {
+        capture_ring[i].id = 0;
+    }
+    capture_head = 0;
+    capture_filtered = 0;
+    if (was_enabled) {
+        capture_start();
+    }
+}
+
+void capture_set_snaplen(uint32_t snaplen) {
+    if (snaplen == 0 || snaplen > CAPTURE_SNAPLEN_MAX) {
+        snaplen = CAPTURE_SNAPLEN_MAX;
+    }
+    capture_snaplen = snaplen;
+}
+
+void capture_set_filter(const struct capture_filter *filter) {
+    if (filter) {
+        capture_filt = *filter;
+    } else {
+        memset(&capture_filt, 0, sizeof(capture_filt));
+    }
+}
+
+void capture_get_filter(struct capture_filter *filter) {
+    *filter = capture_filt;
+}
+
+void capture_get_stats(struct capture_stats *stats) {
+    uint32_t head = capture_head;
+    stats->captured = head;
+    stats->filtered = capture_filtered;
+    stats->stored = head < CAPTURE_RING_SIZE ? head : CAPTURE_RING_SIZE;
+    stats->snaplen = capture_snaplen;
+    stats->enabled = capture_enabled;
+}
+
+// 只检查第一个分片 (协议层的头部总在第一个分片中)
+static bool capture_match(const uint8_t *hdr, uint32_t len) {
+    const struct capture_filter *f = &capture_filt;
+    if (!f->ethertype && !f->ip_proto && !f->port) {
+        return true;
+    }
+    if (len < 14) {
+        return false;
+    }
+    uint16_t type = (uint16_t)(hdr[12] << 8 | hdr[13]);
+    if (f->ethertype && type != f->ethertype) {
+        return false;
+    }
+    if (!f->ip_proto && !f->port) {
+        return true;
+    }
+
+    // IP协议号在IP头第9字节，端口紧跟在IP头 (含选项) 之后
+    if (type != ETH_TYPE_IP || len < 14 + 20) {
+        return false;
+    }
+    uint8_t proto = hdr[14 + 9];
+    if (f->ip_proto && proto != f->ip_proto) {
+        return false;
+    }
+    if (!f->port) {
+        return true;
+    }
+    if (proto != IP_PROTO_TCP && proto != IP_PROTO_UDP) {
+        return false;
+    }
+    uint32_t l4 = 14 + (hdr[14] & 0x0F) * 4;
+    if (len < l4 + 4) {
+        return false;
+    }
+    uint16_t sport = (uint16_t)(hdr[l4] << 8 | hdr[l4 + 1]);
+    uint16_t dport = (uint16_t)(hdr[l4 + 2] << 8 | hdr[l4 + 3]);
+    return sport == f->port || dport == f->port;
+}
+
+uint32_t capture_frame(uint8_t dir, const struct netdev_frag *frags, int nfrags, uint32_t length) {
+    if (!capture_match((const uint8_t *)frags[0].data, frags[0].length)) {
+        capture_filtered++;
+        return 0;
+    }
+
+    uint32_t seq = __sync_fetch_and_add(&capture_head, 1);
+    struct capture_record *rec = &capture_ring[seq & (CAPTURE_RING_SIZE - 1)];
+    rec->id = 0;
+    barrier();
+
+    rec->tsc = tsc_read();
+    rec->orig_len = length;
+    rec->dir = dir;
+    rec->drop = CAPTURE_DROP_NONE;
+
+    // 按 snaplen 截断，跨分片复制
+    uint32_t copied = 0;
+    for (int i = 0; i < nfrags && copied < capture_snaplen; i++) {
+        uint32_t n = frags[i].length;
+        if (n > capture_snaplen - copied) {
+            n = capture_snaplen - copied;
+        }
+        memcpy(rec->data + copied, frags[i].data, n);
+        copied += n;
+    }
+    rec->cap_len = (uint16_t)copied;
+
+    barrier();
+    rec->id = seq + 1;
+    return seq + 1;
+}
+
+// 记录可能已被覆盖，标识不一致时忽略
+void capture_mark(uint32_t id, uint8_t reason) {
+    if (!id) {
+        return;
+    }
+    struct capture_record *rec = &capture_ring[(id - 1) & (CAPTURE_RING_SIZE - 1)];
+    if (rec->id == id) {
+        rec->drop = reason;
+    }
+}
+
+uint32_t capture_rx_begin(const uint8_t *frame, uint16_t length) {
+    struct netdev_frag frag = { frame, length };
+    uint32_t cpu = smp_processor_id();
+    uint32_t outer = capture_rx_current[cpu];
+    capture_rx_current[cpu] = capture_frame(CAPTURE_DIR_RX, &frag, 1, length);
+    return outer;
+}
+
+void capture_rx_end(uint32_t outer) {
+    capture_rx_current[smp_processor_id()] = outer;
+}
+
+void capture_rx_drop(uint8_t reason) {
+    capture_mark(capture_rx_current[smp_processor_id()], reason);
+}
+
+// 导出: 字节流按每行32字节的十六进制输出
+#define CAPTURE_HEX_LINE 32
+
+static uint8_t capture_line[CAPTURE_HEX_LINE];
+static uint32_t capture_line_len = 0;
+
+static void capture_emit_flush(void) {
+    static const char digits[] = "0123456789abcdef";
+    char text[CAPTURE_HEX_LINE * 2 + 2];
+    uint32_t pos = 0;
+
+    if (capture_line_len == 0) {
+        return;
+    }
+    for (uint32_t i = 0; i < capture_line_len; i++) {
+        text[pos++] = digits[capture_line[i] >> 4];
+        text[pos++] = digits[capture_line[i] & 0xF];
+    }
+    text[pos++] = '\n';
+    text[pos] = '\0';
+    serial_write_string(text);
+    capture_line_len = 0;
+}
+
+static void capture_emit(const void *data, uint32_t length) {
+    const uint8_t *bytes = (const uint8_t *)data;
+    for (uint32_t i = 0; i < length; i++) {
+        capture_line[capture_line_len++] = bytes[i];
+        if (capture_line_len == CAPTURE_HEX_LINE) {
+            capture_emit_flush();
+        }
+    }
+}
+
+static void capture_emit_u16(uint16_t value) {
+    capture_emit(&value, 2);
+}
+
+static void capture_emit_u32(uint32_t value) {
+    capture_emit(&value, 4);
+}
+
+static void capture_emit_pad(uint32_t length) {
+    static const uint8_t zeros[4];
+    capture_emit(zeros, (4 - (length & 3)) & 3);
+}
+
+static uint32_t pad4(uint32_t length) {
+    return (length + 3) & ~3u;
+}
+
+// pcapng 块类型和选项 (小端)
+#define PCAPNG_SHB          0x0A0D0D0A
+#define PCAPNG_IDB          0x00000001
+#define PCAPNG_EPB          0x00000006
+#define PCAPNG_BYTE_ORDER   0x1A2B3C4D
+#define PCAPNG_OPT_END      0
+#define PCAPNG_OPT_COMMENT  1
+#define PCAPNG_OPT_IF_NAME  2
+#define PCAPNG_OPT_FLAGS    2
+#define PCAPNG_LINKTYPE_ETHERNET 1
+#define PCAPNG_FLAG_INBOUND  1
+#define PCAPNG_FLAG_OUTBOUND 2
+
+static void capture_emit_option(uint16_t code, const void *data, uint16_t length) {
+    capture_emit_u16(code);
+    capture_emit_u16(length);
+    capture_emit(data, length);
+    capture_emit_pad(length);
+}
+
+static void capture_emit_headers(void) {
+    // Section Header Block: 版本 1.0，节长度未知
+    capture_emit_u32(PCAPNG_SHB);
+    capture_emit_u32(28);
+    capture_emit_u32(PCAPNG_BYTE_ORDER);
+    capture_emit_u16(1);
+    capture_emit_u16(0);
+    capture_emit_u32(0xFFFFFFFF);
+    capture_emit_u32(0xFFFFFFFF);
+    capture_emit_u32(28);
+
+    // Interface Description Block: 以太网，时间戳默认单位为微秒
+    static const char if_name[] = "minios";
+    uint32_t idb_len = 20 + 4 + pad4(sizeof(if_name) - 1) + 4;
+    capture_emit_u32(PCAPNG_IDB);
+    capture_emit_u32(idb_len);
+    capture_emit_u16(PCAPNG_LINKTYPE_ETHERNET);
+    capture_emit_u16(0);
+    capture_emit_u32(capture_snaplen);
+    capture_emit_option(PCAPNG_OPT_IF_NAME, if_name, sizeof(if_name) - 1);
+    capture_emit_u32(PCAPNG_OPT_END);
+    capture_emit_u32(idb_len);
+}
+
+// Enhanced Packet Block: 方向写入 epb_flags，丢弃原因写入注释
+static void capture_emit_record(const struct capture_record *rec) {
+    char comment[32];
+    uint32_t comment_len = 0;
+    if (rec->drop != CAPTURE_DROP_NONE) {
+        comment_len = (uint32_t)ksnprintf(comment, sizeof(comment), "drop: %s", capture_drop_name(rec->drop));
+    }
+
+    // 固定字段 28 字节 + 数据 + epb_flags 选项 + 选项结束 + 尾部长度
+    uint32_t len = 28 + pad4(rec->cap_len) + 8 + 4 + 4;
+    if (comment_len) {
+        len += 4 + pad4(comment_len);
+    }
+    uint64_t us = tsc_to_uptime_us(rec->tsc);
+    uint32_t flags = rec->dir == CAPTURE_DIR_RX ? PCAPNG_FLAG_INBOUND : PCAPNG_FLAG_OUTBOUND;
+
+    capture_emit_u32(PCAPNG_EPB);
+    capture_emit_u32(len);
+    capture_emit_u32(0);
+    capture_emit_u32((uint32_t)(us >> 32));
+    capture_emit_u32((uint32_t)us);
+    capture_emit_u32(rec->cap_len);
+    capture_emit_u32(rec->orig_len);
+    capture_emit(rec->data, rec->cap_len);
+    capture_emit_pad(rec->cap_len);
+    capture_emit_option(PCAPNG_OPT_FLAGS, &flags, 4);
+    if (comment_len) {
+        capture_emit_option(PCAPNG_OPT_COMMENT, comment, (uint16_t)comment_len);
+    }
+    capture_emit_u32(PCAPNG_OPT_END);
+    capture_emit_u32(len);
+}
+
+void capture_export(void) {
+    char line[64];
+    bool was_enabled = capture_enabled;
+    capture_stop();
+
+    uint32_t head = capture_head;
+    uint32_t count = head < CAPTURE_RING_SIZE ? head : CAPTURE_RING_SIZE;
+    uint32_t frames = 0;
+    for (uint32_t i = head - count; i != head; i++) {
+        if (capture_ring[i & (CAPTURE_RING_SIZE - 1)].id == i + 1) {
+            frames++;
+        }
+    }
+
+    ksnprintf(line, sizeof(line), "\n@@PCAPNG v1 frames=%u\n", frames);
+    serial_write_string(line);
+    capture_line_len = 0;
+    capture_emit_headers();
+    for (uint32_t i = head - count; i != head; i++) {
+        const struct capture_record *rec = &capture_ring[i & (CAPTURE_RING_SIZE - 1)];
+        if (rec->id == i + 1) {
+            capture_emit_record(rec);
+        }
+    }
+    capture_emit_flush();
+    serial_write_string("@@END\n");
+
+    if (was_enabled) {
+        capture_start();
+    }
+}
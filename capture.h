@@ -0,0 +1,78 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include "types.h"
+#include "netdev.h"
+
+// 内核抓包: 收发路径把帧的前 snaplen 字节复制到环形缓冲区 (满时覆盖最旧的帧)
+// capture_export 以 pcapng 格式 (十六进制行) 写到串口，主机上用 tools/pcap_extract.py 还原
+// 关闭时收发路径上只有一次标志测试
+
+// 缓冲区中的帧数 (2的幂) 和每帧最多保存的字节数
+#define CAPTURE_RING_SIZE   128
+#define CAPTURE_SNAPLEN_MAX 256
+
+#define CAPTURE_DIR_RX 0
+#define CAPTURE_DIR_TX 1
+
+// 丢弃原因 (与 capture_drop_name 的表对应)
+#define CAPTURE_DROP_NONE           0
+#define CAPTURE_DROP_UNKNOWN_TYPE   1   // 不支持的以太网类型
+#define CAPTURE_DROP_ARP_INVALID    2   // ARP报文格式错误
+#define CAPTURE_DROP_IP_HDR         3   // IP头不完整
+#define CAPTURE_DROP_IP_ADDR        4   // 目的地址不是本机
+#define CAPTURE_DROP_IP_PROTO       5   // 不支持的IP协议
+#define CAPTURE_DROP_NO_PORT        6   // 没有监听的端口
+#define CAPTURE_DROP_TX_OFFLOAD     7   // 设备无法处理的卸载请求或超长帧
+#define CAPTURE_DROP_TX_DEVICE      8   // 驱动拒绝 (队列满、链路断开)
+#define CAPTURE_DROP_COUNT          9
+
+// 过滤条件，各字段为 0 表示不限制; 端口匹配TCP/UDP的源或目的端口
+struct capture_filter {
+    uint16_t ethertype;
+    uint8_t ip_proto;
+    uint16_t port;
+};
+
+struct capture_stats {
+    uint32_t captured;   // 写入缓冲区的帧
+    uint32_t filtered;   // 不匹配过滤条件的帧
+    uint32_t stored;     // 缓冲区中当前保存的帧
+    uint32_t snaplen;
+    bool enabled;
+};
+
+extern volatile bool capture_enabled;
+
+void capture_init(void);
+void capture_start(void);
+void capture_stop(void);
+void capture_reset(void);
+void capture_set_snaplen(uint32_t snaplen);
+// filter 为 NULL 时清除过滤条件
+void capture_set_filter(const struct capture_filter *filter);
+void capture_get_filter(struct capture_filter *filter);
+void capture_get_stats(struct capture_stats *stats);
+const char *capture_drop_name(uint32_t reason);
+
+// 以下由收发路径调用，调用前先测试 capture_enabled
+// 返回记录的标识 (0 表示未记录)，之后可以用 capture_mark 补上丢弃原因
+uint32_t capture_frame(uint8_t dir, const struct netdev_frag *frags, int nfrags, uint32_t length);
+void capture_mark(uint32_t id, uint8_t reason);
+
+// 接收处理期间的当前帧: 协议层用 CAPTURE_DROP 给它标记丢弃原因
+// 回环发送可能在处理中嵌套接收，因此 begin 返回外层的当前帧，end 时恢复
+uint32_t capture_rx_begin(const uint8_t *frame, uint16_t length);
+void capture_rx_end(uint32_t outer);
+void capture_rx_drop(uint8_t reason);
+
+#define CAPTURE_DROP(reason) do { \
+    if (capture_enabled) { \
+        capture_rx_drop(reason); \
+    } \
+} while (0)
+
+// 以 pcapng 十六进制块输出缓冲区中的帧; 输出期间暂停抓包
+void capture_export(void);
+
+#endif // CAPTURE_H
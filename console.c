@@ -0,0 +1,561 @@
+#include "console.h"
+#include "serial.h"
+#include "kprintf.h"
+#include "memory.h"
+#include "network.h"
+#include "netdev.h"
+#include "netstats.h"
+#include "arp.h"
+#include "klog.h"
+#include "log.h"
+#include "trace.h"
+#include "ping.h"
+#include "bench.h"
+#include "virtio_net.h"
+#include "dashboard.h"
+#include "capture.h"
+#include "netlat.h"
+#include "profile.h"
+#include "region.h"
+#include "gcov.h"
+#include "boottime.h"
+#include "pci.h"
+#include "msi.h"
+#include "tsc.h"
+#include "ipv4.h"
+
+static char console_line[CONSOLE_LINE_MAX];
+static uint32_t console_len = 0;
+static bool console_last_cr = false;   // 终端发送 "\r\n" 时只执行一次
+
+struct console_cmd {
+    const char *name;
+    const char *usage;
+    void (*fn)(int argc, char **argv);
+};
+
+static void console_print(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+static void console_print(const char *fmt, ...) {
+    char buf[128];
+    va_list args;
+    va_start(args, fmt);
+    kvsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    serial_write_string(buf);
+}
+
+static bool str_equal(const char *a, const char *b) {
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+// 无符号整数，十进制或 0x 开头的十六进制，整个字符串都必须是数字
+static bool parse_uint(const char *s, uint32_t *out) {
+    uint32_t value = 0;
+    uint32_t base = 10;
+    if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+        base = 16;
+        s += 2;
+    }
+    if (!*s) {
+        return false;
+    }
+    while (*s) {
+        uint32_t digit;
+        if (*s >= '0' && *s <= '9') {
+            digit = (uint32_t)(*s - '0');
+        } else if (base == 16 && *s >= 'a' && *s <= 'f') {
+            digit = (uint32_t)(*s - 'a' + 10);
+        } else if (base == 16 && *s >= 'A' && *s <= 'F') {
+            digit = (uint32_t)(*s - 'A' + 10);
+        } else {
+            return false;
+        }
+        if (value > (0xFFFFFFFF - digit) / base) {
+            return false;
+        }
+        value = value * base + digit;
+        s++;
+    }
+    *out = value;
+    return true;
+}
+
+// 点分十进制，结果为主机字节序
+static bool parse_ip(const char *s, uint32_t *out) {
+    uint32_t ip = 0;
+    for (int part = 0; part < 4; part++) {
+        uint32_t octet = 0;
+        int digits = 0;
+        while (*s >= '0' && *s <= '9' && digits < 3) {
+            octet = octet * 10 + (uint32_t)(*s - '0');
+            s++;
+            digits++;
+        }
+        if (digits == 0 || octet > 255) {
+            return false;
+        }
+        ip = (ip << 8) | octet;
+        if (part < 3) {
+            if (*s != '.') {
+                return false;
+            }
+            s++;
+        }
+    }
+    if (*s) {
+        return false;
+    }
+    *out = ip;
+    return true;
+}
+
+static const char *const console_level_names[] = { "err", "warn", "info", "debug" };
+
+// 级别名或数字
+static int parse_level(const char *s) {
+    uint32_t n;
+    for (int i = 0; i <= KLOG_DEBUG; i++) {
+        if (str_equal(s, console_level_names[i])) {
+            return i;
+        }
+    }
+    if (parse_uint(s, &n) && n <= KLOG_DEBUG) {
+        return (int)n;
+    }
+    return -1;
+}
+
+static void cmd_help(int argc, char **argv);
+
+static void cmd_stats(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    netstats_dump();
+
+    for (struct netdev *dev = netdev_first(); dev; dev = dev->next) {
+        console_print("%s: tx_packets=%u tx_bytes=%u tx_dropped=%u tx_sw_csum=%u\n",
+                      dev->name, dev->tx_packets, dev->tx_bytes, dev->tx_dropped, dev->tx_sw_csum);
+    }
+
+    struct klog_stats ks;
+    klog_get_stats(&ks);
+    console_print("klog: logged=%u dropped=%u drained=%u\n", ks.logged, ks.dropped, ks.drained);
+    // 两次 stats 之间 idle_us 的增量除以 uptime_us 的增量即为空闲比例
+    console_print("cpu: uptime_us=%llu idle_us=%llu\n", tsc_uptime_us(), tsc_to_us(dashboard_idle_cycles()));
+    virtio_net_dump_stats();
+}
+
+static void cmd_arp(int argc, char **argv) {
+    if (argc > 1 && str_equal(argv[1], "flush")) {
+        clear_arp_cache();
+        serial_write_string("arp cache flushed\n");
+        return;
+    }
+    arp_dump_cache();
+}
+
+static void cmd_ifconfig(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    console_print("ip " IP_FMT " netmask " IP_FMT " gateway " IP_FMT "\n",
+                  IP_ARGS(net_dev.ip_addr), IP_ARGS(net_dev.netmask), IP_ARGS(net_dev.gateway));
+
+    for (struct netdev *dev = netdev_first(); dev; dev = dev->next) {
+        console_print("%-8s mac " MAC_FMT " mtu %u%s\n", dev->name, MAC_ARGS(dev->mac_addr),
+                      dev->mtu, (dev->flags & NETDEV_FLAG_LOOPBACK) ? " loopback" : "");
+        console_print("         features:%s%s%s%s\n",
+                      (dev->features & NETDEV_F_TX_CSUM) ? " tx-csum" : "",
+                      (dev->features & NETDEV_F_RX_CSUM) ? " rx-csum" : "",
+                      (dev->features & NETDEV_F_TSO4) ? " tso4" : "",
+                      (dev->features & NETDEV_F_SG) ? " sg" : "");
+    }
+}
+
+// ping <ip> [-c count] [-i interval_ms] | ping stop
+static void cmd_ping(int argc, char **argv) {
+    uint32_t target;
+    uint32_t count = 4;
+    uint32_t interval_ms = 1000;
+
+    if (argc > 1 && str_equal(argv[1], "stop")) {
+        ping_stop();
+        return;
+    }
+    if (argc < 2 || !parse_ip(argv[1], &target)) {
+        serial_write_string("usage: ping <ip> [-c count] [-i interval_ms]\n");
+        return;
+    }
+    for (int i = 2; i < argc; i++) {
+        if (i + 1 < argc && str_equal(argv[i], "-c") && parse_uint(argv[i + 1], &count)) {
+            i++;
+        } else if (i + 1 < argc && str_equal(argv[i], "-i") && parse_uint(argv[i + 1], &interval_ms)) {
+            i++;
+        } else {
+            console_print("ping: bad option '%s'\n", argv[i]);
+            return;
+        }
+    }
+    ping_start(target, count, interval_ms);
+}
+
+// trace on|off [event] | trace dump | trace reset | trace list
+static void cmd_trace(int argc, char **argv) {
+    if (argc < 2 || str_equal(argv[1], "list")) {
+        for (uint32_t i = 0; i < TRACE_EVENT_COUNT; i++) {
+            console_print("%-12s %s\n", trace_event_name(i), trace_is_enabled(i) ? "on" : "off");
+        }
+        return;
+    }
+    if (str_equal(argv[1], "dump")) {
+        klog_flush();
+        trace_dump();
+        return;
+    }
+    if (str_equal(argv[1], "reset")) {
+        trace_reset();
+        return;
+    }
+
+    bool enable = str_equal(argv[1], "on");
+    if (!enable && !str_equal(argv[1], "off")) {
+        serial_write_string("usage: trace on|off [event] | dump | reset | list\n");
+        return;
+    }
+    uint32_t event = TRACE_EVENT_COUNT;
+    if (argc > 2) {
+        int ev = trace_event_from_name(argv[2]);
+        if (ev < 0) {
+            console_print("trace: unknown event '%s'\n", argv[2]);
+            return;
+        }
+        event = (uint32_t)ev;
+    }
+    trace_enable(event, enable);
+}
+
+static void cmd_bench(int argc, char **argv) {
+    if (argc < 2) {
+        bench_list();
+        return;
+    }
+    if (bench_run(argv[1]) == 0) {
+        console_print("bench: unknown case '%s'\n", argv[1]);
+    }
+}
+
+// loglevel | loglevel <sub|all> <level>
+static void cmd_loglevel(int argc, char **argv) {
+    if (argc < 2) {
+        for (int i = 0; i < LOG_SUBSYS_COUNT; i++) {
+            console_print("%-5s runtime=%s compiled=%s\n", log_subsys_name(i),
+                          console_level_names[log_get_level(i)],
+                          console_level_names[log_get_compiled_level(i)]);
+        }
+        return;
+    }
+    int level = argc > 2 ? parse_level(argv[2]) : -1;
+    if (level < 0) {
+        serial_write_string("usage: loglevel [<sub|all> <err|warn|info|debug|0-3>]\n");
+        return;
+    }
+    if (str_equal(argv[1], "all")) {
+        log_set_all(level);
+        return;
+    }
+    int sub = log_subsys_from_name(argv[1]);
+    if (sub < 0) {
+        console_print("loglevel: unknown subsystem '%s'\n", argv[1]);
+        return;
+    }
+    log_set_level(sub, level);
+    if (log_get_compiled_level(sub) < level) {
+        console_print("loglevel: %s compiled with %s, higher levels are not built in\n", log_subsys_name(sub),
+                      console_level_names[log_get_compiled_level(sub)]);
+    }
+}
+
+// dash [hz]: 查看或设置仪表盘刷新频率，0 停止刷新
+static void cmd_dash(int argc, char **argv) {
+    uint32_t hz;
+    if (argc < 2) {
+        console_print("dashboard refresh %u Hz\n", dashboard_get_rate());
+        return;
+    }
+    if (!parse_uint(argv[1], &hz) || hz > 60) {
+        serial_write_string("usage: dash [0-60]\n");
+        return;
+    }
+    dashboard_set_rate(hz);
+}
+
+static bool parse_ip_proto(const char *s, uint8_t *out) {
+    uint32_t n;
+    if (str_equal(s, "icmp")) {
+        *out = IP_PROTO_ICMP;
+    } else if (str_equal(s, "tcp")) {
+        *out = IP_PROTO_TCP;
+    } else if (str_equal(s, "udp")) {
+        *out = IP_PROTO_UDP;
+    } else if (parse_uint(s, &n) && n > 0 && n <= 255) {
+        *out = (uint8_t)n;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static void cap_status(void) {
+    struct capture_stats cs;
+    struct capture_filter f;
+    capture_get_stats(&cs);
+    capture_get_filter(&f);
+    console_print("capture %s, snaplen %u, %u captured, %u stored, %u filtered out\n",
+                  cs.enabled ? "on" : "off", cs.snaplen, cs.captured, cs.stored, cs.filtered);
+    console_print("filter: ether 0x%04x proto %u port %u (0 = any)\n", f.ethertype, f.ip_proto, f.port);
+}
+
+// cap filter clear | cap filter [ether <type>] [proto <icmp|tcp|udp|n>] [port <n>]
+static void cap_filter(int argc, char **argv) {
+    struct capture_filter f;
+    memset(&f, 0, sizeof(f));
+
+    if (argc == 3 && str_equal(argv[2], "clear")) {
+        capture_set_filter(NULL);
+        return;
+    }
+    for (int i = 2; i < argc; i += 2) {
+        uint32_t n;
+        bool ok = i + 1 < argc;
+        if (ok && str_equal(argv[i], "ether")) {
+            ok = parse_uint(argv[i + 1], &n) && n <= 0xFFFF;
+            f.ethertype = (uint16_t)n;
+        } else if (ok && str_equal(argv[i], "proto")) {
+            ok = parse_ip_proto(argv[i + 1], &f.ip_proto);
+        } else if (ok && str_equal(argv[i], "port")) {
+            ok = parse_uint(argv[i + 1], &n) && n <= 0xFFFF;
+            f.port = (uint16_t)n;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            serial_write_string("usage: cap filter clear | [ether <type>] [proto <icmp|tcp|udp|n>] [port <n>]\n");
+            return;
+        }
+    }
+    capture_set_filter(&f);
+}
+
+static void cmd_cap(int argc, char **argv) {
+    uint32_t n;
+    if (argc < 2 || str_equal(argv[1], "status")) {
+        cap_status();
+    } else if (str_equal(argv[1], "on")) {
+        capture_start();
+    } else if (str_equal(argv[1], "off")) {
+        capture_stop();
+    } else if (str_equal(argv[1], "reset")) {
+        capture_reset();
+    } else if (str_equal(argv[1], "dump")) {
+        capture_export();
+    } else if (str_equal(argv[1], "snaplen") && argc > 2 && parse_uint(argv[2], &n)) {
+        capture_set_snaplen(n);
+    } else if (str_equal(argv[1], "filter")) {
+        cap_filter(argc, argv);
+    } else {
+        serial_write_string("usage: cap [on|off|reset|dump|status|snaplen <n>|filter ...]\n");
+    }
+}
+
+// lat [reset]: 各阶段延迟分位数
+static void cmd_lat(int argc, char **argv) {
+    if (argc > 1 && str_equal(argv[1], "reset")) {
+        netlat_reset();
+        return;
+    }
+    netlat_dump();
+}
+
+// region [reset|hist]: 各代码段的周期数
+static void cmd_region(int argc, char **argv) {
+    if (argc > 1 && str_equal(argv[1], "reset")) {
+        region_reset();
+    } else if (argc > 1 && !str_equal(argv[1], "hist")) {
+        serial_write_string("usage: region [reset|hist]\n");
+    } else {
+        region_dump(argc > 1);
+    }
+}
+
+// prof start [hz] | stop | reset | dump: 定时器采样，dump 输出交给 tools/profile_fold.py
+static void cmd_prof(int argc, char **argv) {
+    uint32_t hz = 0;
+    if (argc < 2 || str_equal(argv[1], "status")) {
+        console_print("profiler %s, %u Hz, %u samples\n",
+                      profile_running() ? "on" : "off", profile_get_hz(), profile_sample_count());
+    } else if (str_equal(argv[1], "start") && (argc < 3 || parse_uint(argv[2], &hz))) {
+        if (!profile_start(hz)) {
+            serial_write_string("prof: rate must be 19-10000 Hz\n");
+        }
+    } else if (str_equal(argv[1], "stop")) {
+        profile_stop();
+    } else if (str_equal(argv[1], "reset")) {
+        profile_reset();
+    } else if (str_equal(argv[1], "dump")) {
+        profile_dump();
+    } else {
+        serial_write_string("usage: prof [start [hz]|stop|reset|dump|status]\n");
+    }
+}
+
+static void cmd_gcov(int argc, char **argv) {
+    if (argc < 2 || str_equal(argv[1], "status")) {
+        console_print("gcov: %u instrumented objects%s\n", gcov_object_count(),
+                      gcov_object_count() ? "" : " (build with PGO=gen)");
+    } else if (str_equal(argv[1], "reset")) {
+        gcov_reset();
+    } else if (str_equal(argv[1], "dump")) {
+        gcov_dump();
+    } else {
+        serial_write_string("usage: gcov [reset|dump|status]\n");
+    }
+}
+
+static void cmd_boot(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    boottime_dump();
+}
+
+static void cmd_pci(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    pci_dump();
+}
+
+static void cmd_msi(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    msi_dump();
+}
+
+static void cmd_mem(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    struct memory_stats ms;
+    memory_get_stats(&ms);
+    console_print("heap 0x%x-0x%x used %u bytes, %u allocs, %u frees\n",
+                  ms.heap_start, ms.heap_end, ms.heap_end - ms.heap_start, ms.allocs, ms.frees);
+}
+
+static const struct console_cmd console_cmds[] = {
+    { "help", "list commands", cmd_help },
+    { "stats", "protocol and device counters", cmd_stats },
+    { "arp", "[flush] show or clear the ARP cache", cmd_arp },
+    { "ifconfig", "interface addresses and features", cmd_ifconfig },
+    { "ping", "<ip> [-c count] [-i ms] | stop", cmd_ping },
+    { "trace", "on|off [event] | dump | reset | list", cmd_trace },
+    { "bench", "[name|all] run microbenchmarks", cmd_bench },
+    { "loglevel", "[<sub|all> <level>] per-subsystem log level", cmd_loglevel },
+    { "cap", "on|off|reset|dump|snaplen n|filter ... packet capture", cmd_cap },
+    { "lat", "[reset] per-stage rx-to-reply latency p50/p99/p999", cmd_lat },
+    { "region", "[reset|hist] cycles per instrumented code region", cmd_region },
+    { "prof", "start [hz]|stop|reset|dump sampling profiler", cmd_prof },
+    { "gcov", "[reset|dump] PGO branch counters", cmd_gcov },
+    { "boot", "boot phase timings", cmd_boot },
+    { "pci", "device table, BARs, capabilities and bound drivers", cmd_pci },
+    { "msi", "MSI/MSI-X vectors, target CPUs and interrupt counts", cmd_msi },
+    { "dash", "[hz] VGA dashboard refresh rate, 0 stops", cmd_dash },
+    { "mem", "heap usage", cmd_mem },
+};
+
+#define CONSOLE_NUM_CMDS (sizeof(console_cmds) / sizeof(console_cmds[0]))
+
+static void cmd_help(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    for (uint32_t i = 0; i < CONSOLE_NUM_CMDS; i++) {
+        console_print("%-9s %s\n", console_cmds[i].name, console_cmds[i].usage);
+    }
+}
+
+static void console_prompt(void) {
+    serial_write_string("> ");
+}
+
+// 就地切分参数，空格分隔
+static int console_split(char *line, char **argv) {
+    int argc = 0;
+    while (*line && argc < CONSOLE_MAX_ARGS) {
+        while (*line == ' ') {
+            *line++ = '\0';
+        }
+        if (!*line) {
+            break;
+        }
+        argv[argc++] = line;
+        while (*line && *line != ' ') {
+            line++;
+        }
+    }
+    return argc;
+}
+
+static void console_execute(void) {
+    char *argv[CONSOLE_MAX_ARGS];
+    console_line[console_len] = '\0';
+    int argc = console_split(console_line, argv);
+    console_len = 0;
+
+    if (argc == 0) {
+        return;
+    }
+    for (uint32_t i = 0; i < CONSOLE_NUM_CMDS; i++) {
+        if (str_equal(argv[0], console_cmds[i].name)) {
+            // 先输出积压日志，避免与命令输出交错
+            klog_flush();
+            console_cmds[i].fn(argc, argv);
+            return;
+        }
+    }
+    console_print("unknown command '%s', try 'help'\n", argv[0]);
+}
+
+void console_init(void) {
+    console_len = 0;
+    serial_write_string("\nconsole ready, type 'help'\n");
+    console_prompt();
+}
+
+void console_poll(void) {
+    ping_poll();
+
+    for (int n = 0; n < CONSOLE_POLL_CHARS; n++) {
+        int c = serial_getc();
+        if (c < 0) {
+            break;
+        }
+        bool skip_lf = (c == '\n' && console_last_cr);
+        console_last_cr = (c == '\r');
+        if (skip_lf) {
+            continue;
+        }
+        if (c == '\r' || c == '\n') {
+            serial_write_string("\n");
+            console_execute();
+            console_prompt();
+        } else if (c == '\b' || c == 0x7F) {
+            if (console_len > 0) {
+                console_len--;
+                serial_write_string("\b \b");
+            }
+        } else if (c >= ' ' && c < 0x7F && console_len < CONSOLE_LINE_MAX - 1) {
+            console_line[console_len++] = (char)c;
+            serial_putc((char)c);
+        }
+    }
+}
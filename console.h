@@ -0,0 +1,19 @@
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include "types.h"
+
+// 串口命令控制台
+// 在主循环中收包之后调用，每轮只处理少量输入，不打断收包
+
+// 一轮最多读取的输入字符数
+#define CONSOLE_POLL_CHARS 16
+// 命令行最大长度和参数个数
+#define CONSOLE_LINE_MAX 80
+#define CONSOLE_MAX_ARGS 8
+
+void console_init(void);
+// 读取输入，收到回车时执行命令; 同时推进正在进行的 ping
+void console_poll(void);
+
+#endif // CONSOLE_H
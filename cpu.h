@@ -0,0 +1,54 @@
+#ifndef CPU_H
+#define CPU_H
+
+#include "types.h"
+
+// 支持的最大CPU数量 (按CPU划分的数据结构以此为大小)
+#define NR_CPUS 4
+
+// 缓存行大小，按CPU的计数器需要按缓存行对齐以避免伪共享
+#define CACHE_LINE_SIZE 64
+#define __cacheline_aligned __attribute__((aligned(CACHE_LINE_SIZE)))
+
+// 当前只运行在引导CPU上，尚未启动其他AP
+static inline uint32_t smp_processor_id(void) {
+    return 0;
+}
+
+static inline uint32_t num_online_cpus(void) {
+    return 1;
+}
+
+// 编译器屏障和全内存屏障
+#define barrier() asm volatile("" ::: "memory")
+#define mb() __sync_synchronize()
+
+// 忙等循环中的提示 (pause)
+static inline void cpu_relax(void) {
+    asm volatile("pause" ::: "memory");
+}
+
+// 本地中断开关; local_irq_save 返回原来的 EFLAGS
+#define EFLAGS_IF 0x200
+
+static inline uint32_t local_irq_save(void) {
+    uint32_t flags;
+    asm volatile("pushfl; popl %0; cli" : "=r"(flags) :: "memory");
+    return flags;
+}
+
+static inline void local_irq_restore(uint32_t flags) {
+    if (flags & EFLAGS_IF) {
+        asm volatile("sti" ::: "memory");
+    }
+}
+
+static inline void local_irq_enable(void) {
+    asm volatile("sti" ::: "memory");
+}
+
+static inline void local_irq_disable(void) {
+    asm volatile("cli" ::: "memory");
+}
+
+#endif // CPU_H
@@ -0,0 +1,138 @@
+#include "dashboard.h"
+#include "terminal.h"
+#include "kprintf.h"
+#include "tsc.h"
+#include "network.h"
+#include "netstats.h"
+#include "arp.h"
+#include "tcp.h"
+#include "klog.h"
+#include "ping.h"
+#include "hist.h"
+
+#define DASH_LINE_MAX 81
+
+static uint32_t dash_hz = DASHBOARD_HZ;
+static uint64_t dash_interval = 0;
+static uint64_t dash_last_tsc = 0;
+
+// 上一帧的计数，用于计算速率
+static struct netstats dash_prev;
+static uint64_t dash_idle_cycles = 0;
+static uint64_t dash_prev_idle = 0;
+
+static void dash_line(uint16_t row, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static void dash_line(uint16_t row, const char *fmt, ...) {
+    char buf[DASH_LINE_MAX];
+    va_list args;
+    va_start(args, fmt);
+    kvsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    terminal_write_line(row, buf);
+}
+
+// delta 个单位在 elapsed_us 微秒内的每秒速率
+static uint32_t dash_rate(uint32_t delta, uint32_t elapsed_us, uint32_t scale) {
+    if (elapsed_us == 0) {
+        return 0;
+    }
+    return (uint32_t)div64_u32((uint64_t)delta * scale, elapsed_us, NULL);
+}
+
+// 微秒格式化为 "x.yyy"
+static void dash_ms(char *buf, uint32_t size, uint32_t us) {
+    ksnprintf(buf, size, "%u.%03u", us / 1000, us % 1000);
+}
+
+static void dashboard_render(uint64_t now) {
+    struct netstats cur;
+    netstats_snapshot(&cur);
+
+    uint32_t elapsed_us = (uint32_t)tsc_to_us(now - dash_last_tsc);
+    uint32_t idle_us = (uint32_t)tsc_to_us(dash_idle_cycles - dash_prev_idle);
+    uint32_t idle_pct = elapsed_us ? (uint32_t)div64_u32((uint64_t)idle_us * 100, elapsed_us, NULL) : 0;
+    if (idle_pct > 100) idle_pct = 100;
+    uint32_t uptime = (uint32_t)div64_u32(tsc_uptime_us(), 1000000, NULL);
+
+    dash_line(0, "MiniOS network dashboard                          up %6us   refresh %2u Hz",
+              uptime, dash_hz);
+    dash_line(1, "--------------------------------------------------------------------------------");
+    dash_line(2, "IP " IP_FMT "/%d  gw " IP_FMT "  MAC " MAC_FMT,
+              IP_ARGS(net_dev.ip_addr), net_dev.netmask ? 32 - __builtin_ctz(net_dev.netmask) : 0, IP_ARGS(net_dev.gateway),
+              MAC_ARGS(net_dev.mac_addr));
+
+    dash_line(4, "Traffic         pps     kbit/s       frames        bytes");
+    dash_line(5, "  RX     %10u %10u %12u %12u",
+              dash_rate(cur.link.rx_frames - dash_prev.link.rx_frames, elapsed_us, 1000000),
+              dash_rate(cur.link.rx_bytes - dash_prev.link.rx_bytes, elapsed_us, 8000),
+              cur.link.rx_frames, cur.link.rx_bytes);
+    dash_line(6, "  TX     %10u %10u %12u %12u",
+              dash_rate(cur.link.tx_frames - dash_prev.link.tx_frames, elapsed_us, 1000000),
+              dash_rate(cur.link.tx_bytes - dash_prev.link.tx_bytes, elapsed_us, 8000),
+              cur.link.tx_frames, cur.link.tx_bytes);
+
+    dash_line(8, "Drops    rx errors %u  unknown type %u  ip hdr %u  ip addr %u",
+              cur.link.rx_errors, cur.link.rx_unknown_type, cur.ip.in_hdr_errors, cur.ip.in_addr_errors);
+    dash_line(9, "         tx dropped %u  tx timeouts %u  tx aborts %u  icmp out errors %u",
+              cur.link.tx_dropped, cur.link.tx_timeouts, cur.link.tx_aborts, cur.icmp.out_errors);
+
+    dash_line(11, "ARP      %d/%d entries  hits %u  misses %u",
+              arp_cache_count(), ARP_CACHE_SIZE, cur.arp.cache_hits, cur.arp.cache_misses);
+    dash_line(12, "TCP      %d/%d connections  segs in %u  out %u",
+              tcp_active_connections(), NR_CPUS * MAX_TCP_CONNECTIONS, cur.tcp.in_segs, cur.tcp.out_segs);
+    dash_line(13, "ICMP     echo in %u  replies out %u  echo out %u  replies in %u",
+              cur.icmp.in_echos, cur.icmp.out_echo_reps, cur.icmp.out_echos, cur.icmp.in_echo_reps);
+
+    const struct hist *rtt = ping_rtt_histogram();
+    char p50[16], p90[16], p99[16], max[16];
+    dash_ms(p50, sizeof(p50), hist_percentile(rtt, 500));
+    dash_ms(p90, sizeof(p90), hist_percentile(rtt, 900));
+    dash_ms(p99, sizeof(p99), hist_percentile(rtt, 990));
+    dash_ms(max, sizeof(max), rtt->max);
+    dash_line(15, "RTT ms   p50 %s  p90 %s  p99 %s  max %s  (%u samples)", p50, p90, p99, max, rtt->count);
+
+    struct klog_stats ks;
+    klog_get_stats(&ks);
+    dash_line(17, "CPU      idle %3u%%", idle_pct);
+    dash_line(18, "Log      logged %u  dropped %u", ks.logged, ks.dropped);
+
+    dash_prev = cur;
+    dash_prev_idle = dash_idle_cycles;
+    dash_last_tsc = now;
+    terminal_flush();
+}
+
+void dashboard_init(void) {
+    terminal_clear();
+    netstats_snapshot(&dash_prev);
+    dash_last_tsc = tsc_read();
+    dashboard_set_rate(dash_hz);
+}
+
+void dashboard_set_rate(uint32_t hz) {
+    dash_hz = hz;
+    dash_interval = hz ? div64_u32((uint64_t)tsc_khz() * 1000, hz, NULL) : 0;
+}
+
+uint32_t dashboard_get_rate(void) {
+    return dash_hz;
+}
+
+void dashboard_account_idle(uint64_t cycles) {
+    dash_idle_cycles += cycles;
+}
+
+uint64_t dashboard_idle_cycles(void) {
+    return dash_idle_cycles;
+}
+
+void dashboard_poll(void) {
+    if (!dash_hz) {
+        return;
+    }
+    uint64_t now = tsc_read();
+    if (now - dash_last_tsc >= dash_interval) {
+        dashboard_render(now);
+    }
+}
@@ -0,0 +1,23 @@
+#ifndef DASHBOARD_H
+#define DASHBOARD_H
+
+#include "types.h"
+
+// VGA仪表盘: 启动完成后接管屏幕，按固定布局定时重画
+// 收发包路径不写屏幕，数据全部来自计数器，刷新之间没有额外开销
+
+// 默认刷新频率，可用 dashboard_set_rate 或控制台 dash 命令修改
+#define DASHBOARD_HZ 2
+
+void dashboard_init(void);
+// 每秒刷新次数，0 表示停止刷新 (屏幕保持最后一帧)
+void dashboard_set_rate(uint32_t hz);
+uint32_t dashboard_get_rate(void);
+// 主循环中没有处理任何帧的一轮所用的周期数，用来估算空闲比例
+void dashboard_account_idle(uint64_t cycles);
+// 累计的空闲周期数 (启动以来)
+uint64_t dashboard_idle_cycles(void);
+// 主循环中调用，到时间时重画
+void dashboard_poll(void);
+
+#endif // DASHBOARD_H
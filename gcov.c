@@ -0,0 +1,217 @@
+#include "gcov.h"
+#include "kprintf.h"
+#include "serial.h"
+
+// GCC 12 起的 gcov_info 布局 (libgcc/libgcov.h)，.gcda 中的长度字段以字节计
+// 只支持 -fprofile-arcs 的边计数; 值剖析 (-fprofile-values) 的 topn 计数器格式不同，不要打开
+#if __GNUC__ >= 14
+#define GCOV_COUNTERS 9
+#else
+#define GCOV_COUNTERS 8
+#endif
+
+#define GCOV_DATA_MAGIC          0x67636461   // "gcda"
+#define GCOV_TAG_FUNCTION        0x01000000
+#define GCOV_TAG_FUNCTION_LENGTH 12
+#define GCOV_TAG_COUNTER_BASE    0x01a10000
+#define GCOV_TAG_FOR_COUNTER(t)  (GCOV_TAG_COUNTER_BASE + ((uint32_t)(t) << 17))
+#define GCOV_TAG_OBJECT_SUMMARY  0xa1000000
+#define GCOV_TAG_SUMMARY_LENGTH  8
+#define GCOV_COUNTER_ARCS        0
+
+// 每行输出的字数
+#define GCOV_WORDS_PER_LINE 8
+
+typedef uint64_t gcov_type;
+typedef void (*gcov_merge_fn)(gcov_type *, uint32_t);
+
+struct gcov_info;
+
+struct gcov_ctr_info {
+    uint32_t num;
+    gcov_type *values;
+};
+
+// ctrs 只包含 merge[t] 非空的计数器类型
+struct gcov_fn_info {
+    const struct gcov_info *key;
+    uint32_t ident;
+    uint32_t lineno_checksum;
+    uint32_t cfg_checksum;
+    struct gcov_ctr_info ctrs[];
+};
+
+struct gcov_info {
+    uint32_t version;
+    struct gcov_info *next;
+    uint32_t stamp;
+    uint32_t checksum;
+    const char *filename;
+    gcov_merge_fn merge[GCOV_COUNTERS];
+    uint32_t n_functions;
+    const struct gcov_fn_info *const *functions;
+};
+
+// link.ld 中 .gcov_info 段的边界
+extern const struct gcov_info *const __gcov_info_start[];
+extern const struct gcov_info *const __gcov_info_end[];
+
+// 插桩代码的 merge[] 引用这个函数; 多次运行的合并由 libgcov 写文件时完成，内核里不会调用
+void __gcov_merge_add(gcov_type *counters, uint32_t n) {
+    (void)counters;
+    (void)n;
+}
+
+// 函数记录只属于 key 指向的目标文件 (COMDAT 函数只有一份计数)
+static bool gcov_fn_valid(const struct gcov_info *info, const struct gcov_fn_info *fn) {
+    return fn && fn->key == info;
+}
+
+uint32_t gcov_object_count(void) {
+    return (uint32_t)(__gcov_info_end - __gcov_info_start);
+}
+
+void gcov_reset(void) {
+    for (const struct gcov_info *const *p = __gcov_info_start; p < __gcov_info_end; p++) {
+        const struct gcov_info *info = *p;
+        for (uint32_t f = 0; f < info->n_functions; f++) {
+            const struct gcov_fn_info *fn = info->functions[f];
+            if (!gcov_fn_valid(info, fn)) {
+                continue;
+            }
+            const struct gcov_ctr_info *ctr = fn->ctrs;
+            for (uint32_t t = 0; t < GCOV_COUNTERS; t++) {
+                if (!info->merge[t]) {
+                    continue;
+                }
+                for (uint32_t i = 0; i < ctr->num; i++) {
+                    ctr->values[i] = 0;
+                }
+                ctr++;
+            }
+        }
+    }
+}
+
+// 全程序最大的边计数，写入每个文件的对象摘要 (与 libgcov 相同)
+static gcov_type gcov_sum_max(void) {
+    gcov_type max = 0;
+    for (const struct gcov_info *const *p = __gcov_info_start; p < __gcov_info_end; p++) {
+        const struct gcov_info *info = *p;
+        if (!info->merge[GCOV_COUNTER_ARCS]) {
+            continue;
+        }
+        for (uint32_t f = 0; f < info->n_functions; f++) {
+            const struct gcov_fn_info *fn = info->functions[f];
+            if (!gcov_fn_valid(info, fn)) {
+                continue;
+            }
+            for (uint32_t i = 0; i < fn->ctrs[0].num; i++) {
+                if (fn->ctrs[0].values[i] > max) {
+                    max = fn->ctrs[0].values[i];
+                }
+            }
+        }
+    }
+    return max;
+}
+
+// 两遍输出: 第一遍只计数字数 (写在块头中)，第二遍输出
+// 计数器总是完整写出 (不用全零压缩)，两遍之间计数变化不影响长度
+struct gcov_writer {
+    bool emit;
+    uint32_t words;
+    char line[GCOV_WORDS_PER_LINE * 9 + 2];
+    uint32_t len;
+};
+
+static void gcov_put(struct gcov_writer *w, uint32_t value) {
+    if (w->emit) {
+        w->len += ksnprintf(w->line + w->len, sizeof(w->line) - w->len, "%s%08x",
+                            w->len ? " " : "", value);
+        if ((w->words + 1) % GCOV_WORDS_PER_LINE == 0) {
+            w->line[w->len++] = '\n';
+            w->line[w->len] = '\0';
+            serial_write_string(w->line);
+            w->len = 0;
+        }
+    }
+    w->words++;
+}
+
+static void gcov_put_counter(struct gcov_writer *w, gcov_type value) {
+    gcov_put(w, (uint32_t)value);
+    gcov_put(w, (uint32_t)(value >> 32));
+}
+
+static void gcov_flush(struct gcov_writer *w) {
+    if (w->emit && w->len) {
+        w->line[w->len++] = '\n';
+        w->line[w->len] = '\0';
+        serial_write_string(w->line);
+        w->len = 0;
+    }
+}
+
+// 与 libgcov 的 write_one_data 相同的记录顺序
+static void gcov_write_info(struct gcov_writer *w, const struct gcov_info *info, gcov_type sum_max) {
+    gcov_put(w, GCOV_DATA_MAGIC);
+    gcov_put(w, info->version);
+    gcov_put(w, info->stamp);
+    gcov_put(w, info->checksum);
+
+    gcov_put(w, GCOV_TAG_OBJECT_SUMMARY);
+    gcov_put(w, GCOV_TAG_SUMMARY_LENGTH);
+    gcov_put(w, 1);                       // runs
+    gcov_put(w, (uint32_t)sum_max);       // libgcov 也只写低32位
+
+    for (uint32_t f = 0; f < info->n_functions; f++) {
+        const struct gcov_fn_info *fn = info->functions[f];
+        bool valid = gcov_fn_valid(info, fn);
+        gcov_put(w, GCOV_TAG_FUNCTION);
+        gcov_put(w, valid ? GCOV_TAG_FUNCTION_LENGTH : 0);
+        if (!valid) {
+            continue;
+        }
+        gcov_put(w, fn->ident);
+        gcov_put(w, fn->lineno_checksum);
+        gcov_put(w, fn->cfg_checksum);
+
+        const struct gcov_ctr_info *ctr = fn->ctrs;
+        for (uint32_t t = 0; t < GCOV_COUNTERS; t++) {
+            if (!info->merge[t]) {
+                continue;
+            }
+            gcov_put(w, GCOV_TAG_FOR_COUNTER(t));
+            gcov_put(w, ctr->num * 8);
+            for (uint32_t i = 0; i < ctr->num; i++) {
+                gcov_put_counter(w, ctr->values[i]);
+            }
+            ctr++;
+        }
+    }
+    gcov_put(w, 0);
+}
+
+void gcov_dump(void) {
+    char line[64];
+    uint32_t count = gcov_object_count();
+    gcov_type sum_max = gcov_sum_max();
+
+    ksnprintf(line, sizeof(line), "\n@@GCOV v1 objects=%u\n", count);
+    serial_write_string(line);
+    for (const struct gcov_info *const *p = __gcov_info_start; p < __gcov_info_end; p++) {
+        struct gcov_writer w = { .emit = false };
+        gcov_write_info(&w, *p, sum_max);
+
+        ksnprintf(line, sizeof(line), "@@GCDA words=%u file=", w.words);
+        serial_write_string(line);
+        serial_write_string((*p)->filename);
+        serial_write_string("\n");
+
+        w = (struct gcov_writer){ .emit = true };
+        gcov_write_info(&w, *p, sum_max);
+        gcov_flush(&w);
+    }
+    serial_write_string("@@END\n");
+}
@@ -0,0 +1,18 @@
+#ifndef GCOV_H
+#define GCOV_H
+
+#include "types.h"
+
+// PGO训练用的分支计数: PGO=gen 构建以 -fprofile-arcs -fprofile-info-section 编译，
+// GCC 把每个目标文件的 gcov_info 指针放进 .gcov_info 段，内核没有 libgcov，自己按 .gcda 格式输出计数
+// 主机上 tools/gcov_extract.py 从串口日志还原 .gcda 文件，供 PGO=use 构建的 -fprofile-use 读取
+// 未插桩的构建中段为空，下面的函数什么也不做
+
+// 已插桩的目标文件数
+uint32_t gcov_object_count(void);
+// 计数清零，训练负载开始前调用，启动过程不计入
+void gcov_reset(void);
+// 以 @@GCOV 块输出每个目标文件的 .gcda 内容 (32位字，十六进制)
+void gcov_dump(void);
+
+#endif // GCOV_H
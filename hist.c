@@ -0,0 +1,68 @@
+#include "hist.h"
+#include "memory.h"
+#include "tsc.h"
+
+static inline uint32_t hist_index(uint32_t value) {
+    if (value < HIST_LINEAR) {
+        return value;
+    }
+    uint32_t exp = 31 - __builtin_clz(value);
+    uint32_t sub = (value >> (exp - HIST_SUB_BITS)) & (HIST_SUB_BUCKETS - 1);
+    return HIST_LINEAR + (exp - HIST_SUB_BITS - 1) * HIST_SUB_BUCKETS + sub;
+}
+
+// 桶内最大的值
+static uint32_t hist_bucket_upper(uint32_t index) {
+    if (index < HIST_LINEAR) {
+        return index;
+    }
+    uint32_t exp = (index - HIST_LINEAR) / HIST_SUB_BUCKETS + HIST_SUB_BITS + 1;
+    uint32_t sub = (index - HIST_LINEAR) % HIST_SUB_BUCKETS;
+    uint32_t shift = exp - HIST_SUB_BITS;
+    uint64_t low = (uint64_t)(HIST_SUB_BUCKETS + sub) << shift;
+    uint64_t upper = low + (1u << shift) - 1;
+    return upper > 0xFFFFFFFF ? 0xFFFFFFFF : (uint32_t)upper;
+}
+
+void hist_reset(struct hist *h) {
+    memset(h, 0, sizeof(*h));
+}
+
+void hist_record(struct hist *h, uint32_t value) {
+    h->buckets[hist_index(value)]++;
+    h->count++;
+    if (value > h->max) {
+        h->max = value;
+    }
+}
+
+uint32_t hist_percentile(const struct hist *h, uint32_t permille) {
+    if (h->count == 0) {
+        return 0;
+    }
+    // 需要覆盖的样本数，向上取整
+    uint32_t rem;
+    uint32_t target = (uint32_t)div64_u32((uint64_t)h->count * permille, 1000, &rem);
+    if (rem || target == 0) {
+        target++;
+    }
+    uint32_t seen = 0;
+    for (uint32_t i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= target) {
+            uint32_t upper = hist_bucket_upper(i);
+            return upper < h->max ? upper : h->max;
+        }
+    }
+    return h->max;
+}
+
+void hist_merge(struct hist *dst, const struct hist *src) {
+    for (uint32_t i = 0; i < HIST_BUCKETS; i++) {
+        dst->buckets[i] += src->buckets[i];
+    }
+    dst->count += src->count;
+    if (src->max > dst->max) {
+        dst->max = src->max;
+    }
+}
@@ -0,0 +1,27 @@
+#ifndef HIST_H
+#define HIST_H
+
+#include "types.h"
+
+// 对数-线性直方图: 小于 HIST_LINEAR 的值每个值一个桶，
+// 之后每个2的幂区间分成 HIST_SUB_BUCKETS 个桶，相对误差不超过 1/HIST_SUB_BUCKETS
+// 记录只是一次数组递增，可以在收包路径上使用
+#define HIST_SUB_BITS    3
+#define HIST_SUB_BUCKETS (1 << HIST_SUB_BITS)
+#define HIST_LINEAR      (2 * HIST_SUB_BUCKETS)
+#define HIST_BUCKETS     (HIST_LINEAR + (32 - HIST_SUB_BITS - 1) * HIST_SUB_BUCKETS)
+
+struct hist {
+    uint32_t buckets[HIST_BUCKETS];
+    uint32_t count;
+    uint32_t max;
+};
+
+void hist_reset(struct hist *h);
+void hist_record(struct hist *h, uint32_t value);
+// 第 permille/1000 分位 (例如 500、990、999) 所在桶的上界; 没有样本时返回 0
+uint32_t hist_percentile(const struct hist *h, uint32_t permille);
+// 把 src 累加到 dst (合并每CPU的直方图)
+void hist_merge(struct hist *dst, const struct hist *src);
+
+#endif // HIST_H
@@ -0,0 +1,12 @@
+#ifndef HOST_H
+#define HOST_H
+
+#include "types.h"
+
+// 主机构建 (HOST_BUILD): 协议栈源文件原样编译为Linux程序，
+// host_shims.c 提供串口/屏幕/TSC的替代实现，pcap_netdev.c 是读写pcap文件的假网卡
+
+// 为真时内核的串口输出写到 stderr，否则丢弃
+extern bool host_verbose;
+
+#endif // HOST_H
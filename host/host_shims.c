@@ -0,0 +1,81 @@
+// 主机构建: 替代内核中依赖硬件的串口、屏幕和TSC校准
+// 协议栈代码不变，只是输出到 stderr，TSC频率用 clock_gettime 校准
+
+#include <stdio.h>
+#include <time.h>
+#include "host.h"
+#include "serial.h"
+#include "terminal.h"
+#include "tsc.h"
+
+bool host_verbose = false;
+
+static uint32_t host_tsc_khz = 1000000;
+static uint64_t host_tsc_boot = 0;
+
+static uint64_t host_monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// 用单调时钟测量 50ms 内的TSC增量
+void tsc_init(void) {
+    uint64_t ns_start = host_monotonic_ns();
+    uint64_t tsc_start = tsc_read();
+    while (host_monotonic_ns() - ns_start < 50000000ULL) {
+    }
+    uint64_t ns = host_monotonic_ns() - ns_start;
+    uint64_t cycles = tsc_read() - tsc_start;
+    host_tsc_khz = (uint32_t)(cycles * 1000000ULL / ns);
+    host_tsc_boot = tsc_read();
+}
+
+uint32_t tsc_khz(void) {
+    return host_tsc_khz;
+}
+
+uint64_t tsc_to_us(uint64_t cycles) {
+    return cycles * 1000 / host_tsc_khz;
+}
+
+uint64_t tsc_from_us(uint32_t us) {
+    return (uint64_t)us * host_tsc_khz / 1000;
+}
+
+uint64_t tsc_to_uptime_us(uint64_t tsc) {
+    return tsc > host_tsc_boot ? tsc_to_us(tsc - host_tsc_boot) : 0;
+}
+
+uint64_t tsc_uptime_us(void) {
+    return tsc_to_uptime_us(tsc_read());
+}
+
+void serial_write_string(const char *str) {
+    if (host_verbose) {
+        fputs(str, stderr);
+    }
+}
+
+void serial_print_ip(uint32_t ip) {
+    if (host_verbose) {
+        fprintf(stderr, "%u.%u.%u.%u", (ip >> 24) & 0xFF, (ip >> 16) & 0xFF, (ip >> 8) & 0xFF, ip & 0xFF);
+    }
+}
+
+uint32_t serial_get_output(void) {
+    return SERIAL_OUT_UART;
+}
+
+// 输出从不阻塞，导出代码不需要等待队列
+uint32_t serial_tx_room(void) {
+    return SERIAL_TX_QUEUE_SIZE;
+}
+
+void terminal_writestring(const char *data) {
+    (void)data;
+}
+
+void terminal_writedec(uint32_t n) {
+    (void)n;
+}
@@ -0,0 +1,248 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "pcap_netdev.h"
+#include "netdev.h"
+#include "network.h"
+#include "netlat.h"
+#include "tsc.h"
+
+#define PCAP_MAGIC_US   0xA1B2C3D4
+#define PCAP_MAGIC_NS   0xA1B23C4D
+#define PCAP_LINKTYPE_ETHERNET 1
+
+struct pcap_file_header {
+    uint32_t magic;
+    uint16_t version_major;
+    uint16_t version_minor;
+    int32_t thiszone;
+    uint32_t sigfigs;
+    uint32_t snaplen;
+    uint32_t linktype;
+};
+
+struct pcap_record_header {
+    uint32_t ts_sec;
+    uint32_t ts_frac;
+    uint32_t incl_len;
+    uint32_t orig_len;
+};
+
+struct pcap_frame {
+    const uint8_t *data;
+    uint16_t length;
+};
+
+static struct pcap_frame *pn_frames;
+static uint32_t pn_num_frames;
+static uint8_t *pn_file_data;
+static uint32_t pn_next;
+static uint64_t pn_remaining;
+static FILE *pn_tx_dump;
+static struct pcap_netdev_stats pn_stats;
+
+static uint8_t pn_rx_buf[PCAP_NETDEV_FRAME_MAX] __attribute__((aligned(16)));
+static uint8_t pn_tx_buf[NETDEV_TX_RESERVE_MAX] __attribute__((aligned(16)));
+
+static bool pcap_netdev_xmit(struct netdev *dev, const struct netdev_frag *frags, int nfrags,
+                             uint16_t length, const struct netdev_tx_meta *meta);
+static uint8_t *pcap_netdev_tx_reserve(struct netdev *dev, uint16_t length);
+static bool pcap_netdev_tx_commit(struct netdev *dev, uint16_t length, const struct netdev_tx_meta *meta);
+static void pcap_netdev_poll(struct netdev *dev);
+
+static const struct netdev_ops pcap_netdev_ops = {
+    .xmit = pcap_netdev_xmit,
+    .tx_reserve = pcap_netdev_tx_reserve,
+    .tx_commit = pcap_netdev_tx_commit,
+    .poll = pcap_netdev_poll,
+};
+
+// 与 network_init 的默认MAC相同，回放QEMU抓到的流量时目的地址一致
+static struct netdev pcap_netdev = {
+    .name = "pcap0",
+    .mac_addr = {0x52, 0x54, 0x00, 0x12, 0x34, 0x56},
+    .mtu = ETH_MTU,
+    .ops = &pcap_netdev_ops,
+};
+
+static uint32_t pcap_swap32(uint32_t v) {
+    return __builtin_bswap32(v);
+}
+
+bool pcap_netdev_open(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    pn_file_data = malloc(size > 0 ? (size_t)size : 1);
+    if (!pn_file_data || fread(pn_file_data, 1, (size_t)size, f) != (size_t)size) {
+        fprintf(stderr, "%s: read failed\n", path);
+        fclose(f);
+        return false;
+    }
+    fclose(f);
+
+    struct pcap_file_header hdr;
+    if ((size_t)size < sizeof(hdr)) {
+        fprintf(stderr, "%s: not a pcap file\n", path);
+        return false;
+    }
+    memcpy(&hdr, pn_file_data, sizeof(hdr));
+    bool swap = false;
+    if (hdr.magic == pcap_swap32(PCAP_MAGIC_US) || hdr.magic == pcap_swap32(PCAP_MAGIC_NS)) {
+        swap = true;
+        hdr.linktype = pcap_swap32(hdr.linktype);
+    } else if (hdr.magic != PCAP_MAGIC_US && hdr.magic != PCAP_MAGIC_NS) {
+        fprintf(stderr, "%s: not a pcap file (pcapng is not supported)\n", path);
+        return false;
+    }
+    if (hdr.linktype != PCAP_LINKTYPE_ETHERNET) {
+        fprintf(stderr, "%s: link type %u is not ethernet\n", path, hdr.linktype);
+        return false;
+    }
+
+    // 为每条记录建立索引; 帧数据直接指向文件缓冲区
+    uint32_t capacity = 1024;
+    pn_frames = malloc(capacity * sizeof(*pn_frames));
+    size_t offset = sizeof(hdr);
+    while (offset + sizeof(struct pcap_record_header) <= (size_t)size) {
+        struct pcap_record_header rec;
+        memcpy(&rec, pn_file_data + offset, sizeof(rec));
+        uint32_t incl = swap ? pcap_swap32(rec.incl_len) : rec.incl_len;
+        offset += sizeof(rec);
+        if (offset + incl > (size_t)size) {
+            break;
+        }
+        if (incl < sizeof(struct eth_header) || incl > PCAP_NETDEV_FRAME_MAX) {
+            pn_stats.skipped++;
+        } else {
+            if (pn_num_frames == capacity) {
+                capacity *= 2;
+                pn_frames = realloc(pn_frames, capacity * sizeof(*pn_frames));
+            }
+            pn_frames[pn_num_frames].data = pn_file_data + offset;
+            pn_frames[pn_num_frames].length = (uint16_t)incl;
+            pn_num_frames++;
+        }
+        offset += incl;
+    }
+    if (pn_num_frames == 0) {
+        fprintf(stderr, "%s: no usable frames\n", path);
+        return false;
+    }
+
+    netdev_register(&pcap_netdev);
+    return true;
+}
+
+bool pcap_netdev_set_tx_dump(const char *path) {
+    if (pn_tx_dump) {
+        fclose(pn_tx_dump);
+        pn_tx_dump = NULL;
+    }
+    if (!path) {
+        return true;
+    }
+    pn_tx_dump = fopen(path, "wb");
+    if (!pn_tx_dump) {
+        perror(path);
+        return false;
+    }
+    struct pcap_file_header hdr = {
+        .magic = PCAP_MAGIC_US,
+        .version_major = 2,
+        .version_minor = 4,
+        .snaplen = 65535,
+        .linktype = PCAP_LINKTYPE_ETHERNET,
+    };
+    fwrite(&hdr, sizeof(hdr), 1, pn_tx_dump);
+    return true;
+}
+
+void pcap_netdev_set_budget(uint64_t frames) {
+    pn_remaining = frames;
+}
+
+uint64_t pcap_netdev_remaining(void) {
+    return pn_remaining;
+}
+
+uint32_t pcap_netdev_num_frames(void) {
+    return pn_num_frames;
+}
+
+const struct pcap_netdev_stats *pcap_netdev_get_stats(void) {
+    return &pn_stats;
+}
+
+void pcap_netdev_close(void) {
+    pcap_netdev_set_tx_dump(NULL);
+    free(pn_frames);
+    free(pn_file_data);
+    pn_frames = NULL;
+    pn_file_data = NULL;
+    pn_num_frames = 0;
+}
+
+static void pcap_netdev_dump_frag(const void *data, uint32_t length) {
+    fwrite(data, 1, length, pn_tx_dump);
+}
+
+static void pcap_netdev_dump_header(uint32_t length) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    struct pcap_record_header rec = {
+        .ts_sec = (uint32_t)ts.tv_sec,
+        .ts_frac = (uint32_t)(ts.tv_nsec / 1000),
+        .incl_len = length,
+        .orig_len = length,
+    };
+    fwrite(&rec, sizeof(rec), 1, pn_tx_dump);
+}
+
+static bool pcap_netdev_xmit(struct netdev *dev, const struct netdev_frag *frags, int nfrags,
+                             uint16_t length, const struct netdev_tx_meta *meta) {
+    (void)dev;
+    (void)meta;
+    if (pn_tx_dump) {
+        pcap_netdev_dump_header(length);
+        for (int i = 0; i < nfrags; i++) {
+            pcap_netdev_dump_frag(frags[i].data, frags[i].length);
+        }
+    }
+    pn_stats.tx_frames++;
+    pn_stats.tx_bytes += length;
+    return true;
+}
+
+static uint8_t *pcap_netdev_tx_reserve(struct netdev *dev, uint16_t length) {
+    (void)dev;
+    return length <= sizeof(pn_tx_buf) ? pn_tx_buf : NULL;
+}
+
+static bool pcap_netdev_tx_commit(struct netdev *dev, uint16_t length, const struct netdev_tx_meta *meta) {
+    struct netdev_frag frag = { pn_tx_buf, length };
+    return pcap_netdev_xmit(dev, &frag, 1, length, meta);
+}
+
+static void pcap_netdev_poll(struct netdev *dev) {
+    (void)dev;
+    for (uint32_t n = 0; n < PCAP_NETDEV_BATCH && pn_remaining; n++) {
+        const struct pcap_frame *frame = &pn_frames[pn_next];
+        if (++pn_next == pn_num_frames) {
+            pn_next = 0;
+        }
+        pn_remaining--;
+
+        memcpy(pn_rx_buf, frame->data, frame->length);
+        pn_stats.rx_frames++;
+        pn_stats.rx_bytes += frame->length;
+        netlat_rx_arrival(tsc_read());
+        handle_network_packet(pn_rx_buf, frame->length);
+    }
+}
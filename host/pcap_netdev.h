@@ -0,0 +1,30 @@
+#ifndef PCAP_NETDEV_H
+#define PCAP_NETDEV_H
+
+#include "types.h"
+
+// 假网卡 "pcap0": 接收端按顺序 (循环) 注入pcap文件中的帧，发送端只计数，可选写入pcap文件
+// 每次 poll 最多注入 PCAP_NETDEV_BATCH 帧，和真实驱动一样先把帧复制到接收缓冲区
+#define PCAP_NETDEV_BATCH    64
+#define PCAP_NETDEV_FRAME_MAX 2048
+
+struct pcap_netdev_stats {
+    uint64_t rx_frames;
+    uint64_t rx_bytes;
+    uint64_t tx_frames;
+    uint64_t tx_bytes;
+    uint32_t skipped;      // 文件中超长或非以太网的帧
+};
+
+// 读入经典pcap文件 (微秒或纳秒时间戳，任一字节序，链路类型为以太网) 并注册设备
+bool pcap_netdev_open(const char *path);
+// 发送的帧写入 path (NULL 关闭)
+bool pcap_netdev_set_tx_dump(const char *path);
+// 之后的 poll 共注入 frames 帧，从文件开头循环播放
+void pcap_netdev_set_budget(uint64_t frames);
+uint64_t pcap_netdev_remaining(void);
+uint32_t pcap_netdev_num_frames(void);
+const struct pcap_netdev_stats *pcap_netdev_get_stats(void);
+void pcap_netdev_close(void);
+
+#endif // PCAP_NETDEV_H
@@ -2,14 +2,18 @@
 #include "terminal.h"
 #include "rtl8139.h"
 #include "io.h"
+#include "irq.h"
+#include "msi.h"
+#include "log.h"
 
 // IDT表
 static struct idt_entry idt[IDT_ENTRIES];
 // IDT指针
 static struct idt_ptr idtp;
 
-// 中断处理函数声明
-extern void rtl8139_handler(void);
+// IRQ入口表 (idt_asm.asm)
+extern void (*irq_stub_table[NR_IRQS])(void);
+extern void (*msi_stub_table[NR_MSI_VECTORS])(void);
 
 // 设置IDT表项
 static void idt_set_gate(int num, uint32_t base, uint16_t sel, uint8_t flags) {
@@ -25,34 +29,20 @@ extern void idt_load(uint32_t);
 
 // 网卡中断处理函数
 void handle_rtl8139_interrupt(void) {
-    uint16_t isr = inw(get_rtl8139_iobase(rtl8139_bus, rtl8139_slot) + RTL8139_REG_ISR);
-    
-    terminal_writestring("RTL8139 interrupt: ");
-    terminal_writehex16(isr);
-    terminal_writestring("\n");
+    uint16_t iobase = get_rtl8139_iobase();
+    uint16_t isr = inw(iobase + RTL8139_REG_ISR);
+
+    LOG_DEBUG(RTL, "irq ISR 0x%04x%s%s CAPR 0x%04x CBR 0x%04x", isr,
+              (isr & RTL8139_ISR_ROK) ? " ROK" : "",
+              (isr & RTL8139_ISR_TOK) ? " TOK" : "",
+              inw(iobase + RTL8139_REG_CAPR), inw(iobase + RTL8139_REG_CBR));
 
     if(isr & RTL8139_ISR_ROK) {
-        terminal_writestring("Receive OK\n");
-        
-        uint16_t current_rx_ptr = inw(get_rtl8139_iobase(rtl8139_bus, rtl8139_slot) + RTL8139_REG_CAPR);
-        terminal_writestring("CAPR: ");
-        terminal_writehex16(current_rx_ptr);
-        terminal_writestring("\n");
-        
-        uint16_t rx_buf_ptr = inw(get_rtl8139_iobase(rtl8139_bus, rtl8139_slot) + RTL8139_REG_CBR);
-        terminal_writestring("CBR: ");
-        terminal_writehex16(rx_buf_ptr);
-        terminal_writestring("\n");
-        
         check_rx_buffer();
     }
-    
-    if(isr & RTL8139_ISR_TOK) {
-        terminal_writestring("Transmit OK\n");
-    }
 
     // 清除中断标志
-    outw(get_rtl8139_iobase(rtl8139_bus, rtl8139_slot) + RTL8139_REG_ISR, isr);
+    outw(iobase + RTL8139_REG_ISR, isr);
     
     rtl8139_dump_registers();
 }
@@ -68,30 +58,22 @@ void idt_install(void) {
         idt_set_gate(i, (uint32_t)isr_default, 0x08, 0x8E);
     }
 
-    // 注册RTL8139中断处理程序 (IRQ11)
-    idt_set_gate(43, (uint32_t)rtl8139_handler, 0x08, 0x8E);
+    // IRQ0-15 使用统一的入口，由 irq_dispatch 分发
+    for (int i = 0; i < NR_IRQS; i++) {
+        idt_set_gate(IRQ_BASE_VECTOR + i, (uint32_t)irq_stub_table[i], 0x08, 0x8E);
+    }
+
+    // MSI/MSI-X 向量，由 msi_alloc_vector 分配给设备
+    for (int i = 0; i < NR_MSI_VECTORS; i++) {
+        idt_set_gate(MSI_BASE_VECTOR + i, (uint32_t)msi_stub_table[i], 0x08, 0x8E);
+    }
 
     // 加载IDT
     idt_load((uint32_t)&idtp);
-    
-    // 初始化PIC
-    // ICW1: 初始化命令开始
-    outb(0x20, 0x11);
-    outb(0xA0, 0x11);
-    
-    // ICW2: 中断向量偏移
-    outb(0x21, 0x20);  // Master PIC - IRQ0 映射到 0x20
-    outb(0xA1, 0x28);  // Slave PIC - IRQ8 映射到 0x28
-    
-    // ICW3: 主从PIC连接
-    outb(0x21, 0x04);  // Master PIC - IRQ2连接从PIC
-    outb(0xA1, 0x02);  // Slave PIC - 连接到主PIC的IRQ2
-    
-    // ICW4: 设置8086模式
-    outb(0x21, 0x01);
-    outb(0xA1, 0x01);
-    
-    // 清除IMR，允许所有中断
-    outb(0x21, 0x00);
-    outb(0xA1, 0x00);
-} 
\ No newline at end of file
+
+    // 初始化PIC，所有IRQ先保持屏蔽
+    irq_init();
+
+    // RTL8139 处理程序 (IRQ11); 驱动目前轮询接收，该IRQ保持屏蔽
+    irq_register(IRQ_RTL8139, handle_rtl8139_interrupt);
+}
@@ -1,8 +1,10 @@
 global idt_load
 global isr_default
-global rtl8139_handler
+global irq_stub_table
+global msi_stub_table
 
-extern handle_rtl8139_interrupt
+extern irq_dispatch
+extern msi_dispatch
 
 section .text
 idt_load:
@@ -22,10 +24,78 @@ isr_default:
     popad             ; 恢复所有通用寄存器
     iret              ; 中断返回
 
-rtl8139_handler:
+; IRQ入口: 保存寄存器，把IRQ号和寄存器帧传给 irq_dispatch (由它发送EOI)
+; 寄存器帧 = pushad 保存的寄存器 + CPU压入的 EIP/CS/EFLAGS (struct irq_frame)
+%macro IRQ_STUB 1
+irq_stub_%1:
     pushad           ; 保存所有通用寄存器
-    
-    call handle_rtl8139_interrupt
-    
+    cld
+    push esp         ; struct irq_frame *
+    push dword %1
+    call irq_dispatch
+    add esp, 8
     popad            ; 恢复所有通用寄存器
-    iret             ; 中断返回
\ No newline at end of file
+    iret             ; 中断返回
+%endmacro
+
+IRQ_STUB 0
+IRQ_STUB 1
+IRQ_STUB 2
+IRQ_STUB 3
+IRQ_STUB 4
+IRQ_STUB 5
+IRQ_STUB 6
+IRQ_STUB 7
+IRQ_STUB 8
+IRQ_STUB 9
+IRQ_STUB 10
+IRQ_STUB 11
+IRQ_STUB 12
+IRQ_STUB 13
+IRQ_STUB 14
+IRQ_STUB 15
+
+; MSI/MSI-X入口: 与IRQ入口相同，参数是向量在 msi.c 表中的下标 (由 msi_dispatch 向LAPIC发送EOI)
+%macro MSI_STUB 1
+msi_stub_%1:
+    pushad
+    cld
+    push esp
+    push dword %1
+    call msi_dispatch
+    add esp, 8
+    popad
+    iret
+%endmacro
+
+MSI_STUB 0
+MSI_STUB 1
+MSI_STUB 2
+MSI_STUB 3
+MSI_STUB 4
+MSI_STUB 5
+MSI_STUB 6
+MSI_STUB 7
+MSI_STUB 8
+MSI_STUB 9
+MSI_STUB 10
+MSI_STUB 11
+MSI_STUB 12
+MSI_STUB 13
+MSI_STUB 14
+MSI_STUB 15
+
+section .data
+; 按IRQ号排列的入口地址，idt_install 据此填写IDT
+irq_stub_table:
+    dd irq_stub_0, irq_stub_1, irq_stub_2, irq_stub_3
+    dd irq_stub_4, irq_stub_5, irq_stub_6, irq_stub_7
+    dd irq_stub_8, irq_stub_9, irq_stub_10, irq_stub_11
+    dd irq_stub_12, irq_stub_13, irq_stub_14, irq_stub_15
+
+; 按向量下标排列 (MSI_BASE_VECTOR 起的 NR_MSI_VECTORS 个)
+msi_stub_table:
+    dd msi_stub_0, msi_stub_1, msi_stub_2, msi_stub_3
+    dd msi_stub_4, msi_stub_5, msi_stub_6, msi_stub_7
+    dd msi_stub_8, msi_stub_9, msi_stub_10, msi_stub_11
+    dd msi_stub_12, msi_stub_13, msi_stub_14, msi_stub_15
@@ -4,34 +4,35 @@
 #include "types.h"
 
 // 端口输出函数
+// 都带 memory 约束: 优化构建中编译器不能把DMA缓冲区的读写移到端口访问的另一侧
 static inline void outb(uint16_t port, uint8_t value) {
-    asm volatile ("outb %0, %1" : : "a"(value), "Nd"(port));
+    asm volatile ("outb %0, %1" : : "a"(value), "Nd"(port) : "memory");
 }
 
 static inline void outw(uint16_t port, uint16_t value) {
-    asm volatile ("outw %0, %1" : : "a"(value), "Nd"(port));
+    asm volatile ("outw %0, %1" : : "a"(value), "Nd"(port) : "memory");
 }
 
 static inline void outl(uint16_t port, uint32_t value) {
-    asm volatile ("outl %0, %1" : : "a"(value), "Nd"(port));
+    asm volatile ("outl %0, %1" : : "a"(value), "Nd"(port) : "memory");
 }
 
 // 端口输入函数
 static inline uint8_t inb(uint16_t port) {
     uint8_t ret;
-    asm volatile ("inb %1, %0" : "=a"(ret) : "Nd"(port));
+    asm volatile ("inb %1, %0" : "=a"(ret) : "Nd"(port) : "memory");
     return ret;
 }
 
 static inline uint16_t inw(uint16_t port) {
     uint16_t ret;
-    asm volatile ("inw %1, %0" : "=a"(ret) : "Nd"(port));
+    asm volatile ("inw %1, %0" : "=a"(ret) : "Nd"(port) : "memory");
     return ret;
 }
 
 static inline uint32_t inl(uint16_t port) {
     uint32_t ret;
-    asm volatile ("inl %1, %0" : "=a"(ret) : "Nd"(port));
+    asm volatile ("inl %1, %0" : "=a"(ret) : "Nd"(port) : "memory");
     return ret;
 }
 
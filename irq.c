@@ -0,0 +1,117 @@
+#include "irq.h"
+#include "io.h"
+#include "cpu.h"
+#include "trace.h"
+
+static irq_handler_t irq_handlers[NR_IRQS];
+static uint32_t irq_counts[NR_IRQS];
+static uint32_t irq_spurious = 0;
+// 每个CPU正在处理的中断现场
+static struct irq_frame *irq_frames[NR_CPUS];
+
+// 当前屏蔽字 (主片低8位，从片高8位)
+static uint16_t irq_mask = 0xFFFF;
+
+static void irq_write_mask(void) {
+    outb(PIC1_DATA, irq_mask & 0xFF);
+    outb(PIC2_DATA, irq_mask >> 8);
+}
+
+void irq_init(void) {
+    // ICW1: 初始化命令开始
+    outb(PIC1_CMD, 0x11);
+    outb(PIC2_CMD, 0x11);
+
+    // ICW2: 中断向量偏移
+    outb(PIC1_DATA, IRQ_BASE_VECTOR);      // Master PIC - IRQ0 映射到 0x20
+    outb(PIC2_DATA, IRQ_BASE_VECTOR + 8);  // Slave PIC - IRQ8 映射到 0x28
+
+    // ICW3: 主从PIC连接
+    outb(PIC1_DATA, 0x04);  // Master PIC - IRQ2连接从PIC
+    outb(PIC2_DATA, 0x02);  // Slave PIC - 连接到主PIC的IRQ2
+
+    // ICW4: 设置8086模式
+    outb(PIC1_DATA, 0x01);
+    outb(PIC2_DATA, 0x01);
+
+    // 屏蔽所有中断: 没有处理函数的IRQ一旦触发，会因为收不到EOI而阻塞同级及更低优先级的中断
+    irq_mask = 0xFFFF;
+    irq_write_mask();
+}
+
+void irq_register(uint8_t irq, irq_handler_t handler) {
+    if (irq < NR_IRQS) {
+        irq_handlers[irq] = handler;
+    }
+}
+
+void irq_enable(uint8_t irq) {
+    if (irq >= NR_IRQS) {
+        return;
+    }
+    uint32_t flags = local_irq_save();
+    irq_mask &= ~(1u << irq);
+    // 从片的IRQ需要同时打开主片的级联输入
+    if (irq >= 8) {
+        irq_mask &= ~(1u << IRQ_CASCADE);
+    }
+    irq_write_mask();
+    local_irq_restore(flags);
+}
+
+void irq_disable(uint8_t irq) {
+    if (irq >= NR_IRQS) {
+        return;
+    }
+    uint32_t flags = local_irq_save();
+    irq_mask |= (1u << irq);
+    irq_write_mask();
+    local_irq_restore(flags);
+}
+
+// 读取 PIC 的 ISR (正在服务的中断)
+static uint8_t pic_read_isr(uint16_t cmd_port) {
+    outb(cmd_port, 0x0B);  // OCW3: 下次读取返回ISR
+    return inb(cmd_port);
+}
+
+struct irq_frame *irq_get_frame(void) {
+    return irq_frames[smp_processor_id()];
+}
+
+void irq_dispatch(uint32_t irq, struct irq_frame *frame) {
+    // IRQ7/IRQ15 可能是伪中断: ISR 位没有置位时不处理，也不向该片发EOI
+    if (irq == 7 || irq == 15) {
+        uint16_t port = irq == 7 ? PIC1_CMD : PIC2_CMD;
+        if (!(pic_read_isr(port) & 0x80)) {
+            irq_spurious++;
+            // 从片的伪中断仍然占用了主片的级联输入
+            if (irq == 15) {
+                outb(PIC1_CMD, PIC_EOI);
+            }
+            return;
+        }
+    }
+
+    irq_counts[irq]++;
+    TRACE(TRACE_IRQ_ENTRY, irq, 0, 0);
+    irq_frames[smp_processor_id()] = frame;
+    if (irq_handlers[irq]) {
+        irq_handlers[irq]();
+    }
+    irq_frames[smp_processor_id()] = NULL;
+    TRACE(TRACE_IRQ_EXIT, irq, 0, 0);
+
+    if (irq >= 8) {
+        outb(PIC2_CMD, PIC_EOI);
+    }
+    outb(PIC1_CMD, PIC_EOI);
+}
+
+uint32_t irq_get_count(uint8_t irq) {
+    return irq < NR_IRQS ? irq_counts[irq] : 0;
+}
+
+uint32_t irq_get_spurious(void) {
+    return irq_spurious;
+}
@@ -0,0 +1,46 @@
+#ifndef IRQ_H
+#define IRQ_H
+
+#include "types.h"
+
+// 8259A PIC 端口
+#define PIC1_CMD  0x20
+#define PIC1_DATA 0x21
+#define PIC2_CMD  0xA0
+#define PIC2_DATA 0xA1
+#define PIC_EOI   0x20
+
+// IRQ0 映射到的中断向量
+#define IRQ_BASE_VECTOR 0x20
+#define NR_IRQS 16
+
+// 常用IRQ号
+#define IRQ_TIMER   0
+#define IRQ_CASCADE 2
+#define IRQ_COM1    4
+#define IRQ_RTL8139 11
+
+typedef void (*irq_handler_t)(void);
+
+// 中断入口保存的寄存器: pushad 的顺序 (低地址在前)，之后是CPU压入的返回现场
+// 同特权级中断没有栈切换，不含 SS/ESP
+struct irq_frame {
+    uint32_t edi, esi, ebp, esp, ebx, edx, ecx, eax;
+    uint32_t eip, cs, eflags;
+} __attribute__((packed));
+
+// 重新映射PIC并屏蔽全部IRQ，驱动注册后再逐个打开
+void irq_init(void);
+void irq_register(uint8_t irq, irq_handler_t handler);
+void irq_enable(uint8_t irq);
+void irq_disable(uint8_t irq);
+
+// 由汇编入口调用: 执行处理函数并发送EOI
+void irq_dispatch(uint32_t irq, struct irq_frame *frame);
+// 正在处理的中断的寄存器帧 (被中断代码的现场)，不在中断处理中时为 NULL
+struct irq_frame *irq_get_frame(void);
+
+uint32_t irq_get_count(uint8_t irq);
+uint32_t irq_get_spurious(void);
+
+#endif // IRQ_H
@@ -12,6 +12,24 @@
 #include "memory.h"
 #include "serial.h"
 #include "pci.h"
+#include "netdev.h"
+#include "loopback.h"
+#include "virtio_net.h"
+#include "tsc.h"
+#include "klog.h"
+#include "log.h"
+#include "trace.h"
+#include "netstats.h"
+#include "console.h"
+#include "bench.h"
+#include "dashboard.h"
+#include "capture.h"
+#include "netlat.h"
+#include "profile.h"
+#include "region.h"
+#include "boottime.h"
+#include "cpu.h"
+#include "lapic.h"
 
 // RTL8139 PCI device ID
 #define RTL8139_VENDOR_ID 0x10EC
@@ -19,7 +37,6 @@
 
 // External function declarations
 extern void print_ip(uint32_t ip);
-extern bool disable_rtl_debug;
 extern struct net_device net_dev;
 extern void rtl8139_dump_registers(void);
 extern void check_rx_buffer(void);
@@ -99,9 +116,9 @@ void test_network_basics(void) {
     uint8_t gateway_mac[6];
     memset(gateway_mac, 0, 6);
     
-    // Enable RTL debug output for ARP resolution
-    bool original_debug_setting = disable_rtl_debug;
-    disable_rtl_debug = false;
+    // Enable ARP debug logging for the resolution
+    int original_arp_level = log_get_level(LOG_SUBSYS_ARP);
+    log_set_level(LOG_SUBSYS_ARP, KLOG_DEBUG);
     
     // Send ARP request to gateway
     send_arp_request(net_dev.gateway);
@@ -111,7 +128,9 @@ void test_network_basics(void) {
     for(volatile int i = 0; i < 50000000; i++) {
         // Check for responses periodically
         if (i % 10000000 == 0) {
-            check_rx_buffer();
+            netdev_poll_all();
+            klog_drain(KLOG_DRAIN_BATCH);
+            terminal_poll();
             
             // Try to resolve gateway MAC again after some time
             if (arp_resolve(net_dev.gateway, gateway_mac)) {
@@ -126,8 +145,8 @@ void test_network_basics(void) {
         }
     }
     
-    // Restore original debug setting
-    disable_rtl_debug = original_debug_setting;
+    // Restore original log level
+    log_set_level(LOG_SUBSYS_ARP, original_arp_level);
     
     // Check if we got the MAC address
     if (gateway_mac[0] == 0 && gateway_mac[1] == 0 && gateway_mac[2] == 0 &&
@@ -156,8 +175,47 @@ void test_http_request(void) {
     terminal_writestring("\n(HTTP send feature not implemented yet)\n");
 }
 
+// The gateway MAC is resolved from the main loop so boot never waits for it:
+// re-send the ARP request every GATEWAY_ARP_RETRY_MS, give up after GATEWAY_ARP_TRIES
+// (a later ARP request from the gateway still fills the cache and is picked up)
+#define GATEWAY_ARP_RETRY_MS 250
+#define GATEWAY_ARP_TRIES    8
+
+static bool gateway_resolved = false;
+static uint32_t gateway_arp_tries = 0;
+static uint64_t gateway_next_arp = 0;
+
+// Called after passes that received frames and when the retry timer expires
+static void gateway_poll(void) {
+    uint8_t gateway_mac[6];
+    if (get_mac_from_cache(net_dev.gateway, gateway_mac)) {
+        gateway_resolved = true;
+        boottime_mark("gateway resolved");
+        klog(KLOG_INFO, "Gateway MAC %02x:%02x:%02x:%02x:%02x:%02x resolved %u us after boot",
+             gateway_mac[0], gateway_mac[1], gateway_mac[2], gateway_mac[3], gateway_mac[4], gateway_mac[5],
+             (uint32_t)boottime_elapsed_us());
+        // Send first ping request
+        send_icmp_echo_request(net_dev.gateway);
+        return;
+    }
+    uint64_t now = tsc_read();
+    if (now < gateway_next_arp) {
+        return;
+    }
+    if (gateway_arp_tries == GATEWAY_ARP_TRIES) {
+        klog(KLOG_WARN, "Gateway not responding to ARP, no pings until it shows up");
+        gateway_next_arp = ~0ULL;
+        return;
+    }
+    send_arp_request(net_dev.gateway);
+    gateway_arp_tries++;
+    gateway_next_arp = now + (uint64_t)tsc_khz() * GATEWAY_ARP_RETRY_MS;
+}
+
 // Kernel main function
 void kernel_main(void) {
+    boottime_start();
+
     // Initialize terminal
     terminal_initialize();
     terminal_writestring("MiniOS Booting...\n");
@@ -173,21 +231,48 @@ void kernel_main(void) {
     // Initialize serial port
     serial_init();
     serial_write_string("Serial port initialized\r\n");
+    boottime_mark("terminal/gdt/idt/uart");
+
+    // Calibrate the TSC used for all timestamps
+    tsc_init();
+    boottime_mark("tsc calibration");
+
+    // In-memory log, drained to the UART by the main loop
+    klog_init();
+
+    // Diagnostics: trace rings, counters, packet capture and latency histograms
+    trace_init();
+    netstats_init();
+    capture_init();
+    netlat_init();
+
+    // Sampling profiler (idle until 'prof start') and region cycle tables
+    profile_init();
+    region_init();
+
+    // Local APIC for MSI/MSI-X delivery; legacy IRQs keep arriving through the PIC
+    lapic_init();
+
+    // Serial output becomes IRQ4 driven; every other IRQ stays masked
+    serial_enable_irq();
+    local_irq_enable();
+    boottime_mark("subsystems");
     
-    // Initialize PCI and find network device
+    // Scan the PCI bus once into the device table (BARs, class codes, capabilities)
     pci_init();
     terminal_writestring("PCI initialized\n");
+    boottime_mark("pci scan");
     
-    // Find RTL8139 device
-    uint16_t rtl8139_bus = 0, rtl8139_slot = 0;
-    if (!pci_find_device(RTL8139_VENDOR_ID, RTL8139_DEVICE_ID, &rtl8139_bus, &rtl8139_slot)) {
-        terminal_writestring("RTL8139 not found!\n");
-        return;
+    // Bind the network driver: RTL8139 first, then virtio-net; the stack uses a single NIC
+    if (pci_register_driver(&rtl8139_pci_driver)) {
+        terminal_writestring("RTL8139 initialized\n");
+    } else if (pci_register_driver(&virtio_net_pci_driver)) {
+        terminal_writestring("virtio-net initialized\n");
+    } else {
+        // Without a NIC the stack still runs over the loopback device
+        terminal_writestring("No network card found, loopback only\n");
     }
-    
-    // Initialize RTL8139
-    rtl8139_init(rtl8139_bus, rtl8139_slot);
-    terminal_writestring("RTL8139 initialized\n");
+    boottime_mark("nic init");
     
     // Initialize ARP
     arp_init();
@@ -196,6 +281,10 @@ void kernel_main(void) {
     // Initialize network
     network_init();
     
+    // Register loopback device (127.0.0.0/8 and our own address)
+    loopback_init();
+    boottime_mark("network stack");
+    
     // Clear screen and display welcome message
     terminal_clear();
     terminal_writestring("\n\n");
@@ -227,64 +316,57 @@ void kernel_main(void) {
     serial_print_ip(net_dev.gateway);
     serial_write_string("\r\n");
     
-    // Try to resolve the gateway MAC (10.0.2.2) for connectivity test
-    uint8_t gateway_mac[6];
+    // Ask for the gateway MAC now; the reply is picked up by the main loop
     serial_write_string("Sending ARP request to resolve gateway MAC...\r\n");
-    
-    // First send ARP request to gateway
-    send_arp_request(net_dev.gateway);
-    
-    // Wait a bit for response and check RX buffer
-    bool gateway_resolved = false;
-    for (int i = 0; i < 20; i++) {
-        // Check for received packets
-        check_rx_buffer();
-        
-        // Check if we now have the MAC address
-        if (get_mac_from_cache(net_dev.gateway, gateway_mac)) {
-            serial_write_string("Gateway MAC resolved successfully: ");
-            for (int j = 0; j < 6; j++) {
-                serial_write_hex_byte(gateway_mac[j]);
-                if (j < 5) serial_write_string(":");
-            }
-            serial_write_string("\r\n");
-            
-            terminal_writestring("Network connectivity: GOOD\n");
-            terminal_writestring("Gateway (10.0.2.2) is reachable\n\n");
-            gateway_resolved = true;
-            break;
-        }
-        
-        // Delay a bit
-        for (volatile int j = 0; j < 100000; j++) {}
-    }
-    
-    if (!gateway_resolved) {
-        serial_write_string("Warning: Failed to resolve gateway MAC\r\n");
-        terminal_writestring("Warning: Gateway (10.0.2.2) not responding to ARP\n");
-        terminal_writestring("Cannot send PING without gateway MAC address\n");
-    } else {
-        // Send first ping request
-        terminal_writestring("Sending PING request to host...\n\n");
-        send_icmp_echo_request(net_dev.gateway);
-    }
+    gateway_poll();
+    boottime_mark("banner");
     
     // Force serial buffer flush
+    klog_flush();
     serial_write_string("\r\n=== System ready ===\r\n");
     serial_write_string("Sending pings to gateway 10.0.2.2\r\n");
     serial_write_string("======================================\r\n\r\n");
+    // From here on the screen only shows the dashboard
+    dashboard_init();
+    boottime_mark("ready");
+    boottime_dump();
+    console_init();
+#ifdef BENCH_AT_BOOT
+    // Run the microbenchmark suite once before the main loop (make run_bench)
+    bench_run("all");
+#endif
     
     // Main loop - keep checking for network packets and periodically send pings
     uint32_t ping_timer = 0;
+    bool first_rx = false;
     while (1) {
-        check_rx_buffer();
-        
+        uint64_t pass_start = tsc_read();
+        uint32_t frames = netdev_poll_all();
+        if (frames && !first_rx) {
+            first_rx = true;
+            boottime_mark("first rx frame");
+        }
+        // Until the gateway is known, look for its ARP reply after passes that received frames
+        if (!gateway_resolved && (frames || tsc_read() >= gateway_next_arp)) {
+            gateway_poll();
+        }
+        klog_drain(KLOG_DRAIN_BATCH);
+        terminal_poll();
+
+        // Serial command console runs last so packet processing is never delayed
+        console_poll();
+
+        // A pass that handled no frames counts as idle time on the dashboard
+        if (!frames) {
+            dashboard_account_idle(tsc_read() - pass_start);
+        }
+        dashboard_poll();
+
         // Every 20M iterations, send another ping
         ping_timer++;
         if (ping_timer >= 20000000 && gateway_resolved) {
             ping_timer = 0;
-            serial_write_string("\r\nSending periodic PING to gateway...\r\n");
-            terminal_writestring("\nSending new PING request to host...\n");
+            klog(KLOG_INFO, "Sending periodic PING to gateway");
             send_icmp_echo_request(net_dev.gateway);
         }
     }
@@ -0,0 +1,179 @@
+#include "klog.h"
+#include "kprintf.h"
+#include "cpu.h"
+#include "tsc.h"
+#include "serial.h"
+
+// 一条日志; seq 在内容写完后才设置，消费者据此判断条目是否就绪
+struct klog_entry {
+    volatile uint32_t seq;
+    uint8_t level;
+    uint8_t cpu;
+    uint16_t length;
+    uint64_t tsc;
+    char msg[KLOG_MSG_MAX];
+};
+
+// 每个CPU一个环: 多个写者 (本CPU及其中断) 用CAS预留位置，主循环是唯一的读者
+struct klog_ring {
+    volatile uint32_t head;     // 下一个预留位置
+    volatile uint32_t tail;     // 下一个输出位置
+    volatile uint32_t logged;
+    volatile uint32_t dropped;
+    uint32_t dropped_reported;
+    uint32_t drained;
+    struct klog_entry entries[KLOG_RING_SIZE];
+} __cacheline_aligned;
+
+static struct klog_ring klog_rings[NR_CPUS];
+
+static const char klog_level_chars[] = "EWID";
+
+// 输出一行的最大长度: 前缀 + 消息 + 换行
+#define KLOG_LINE_MAX (32 + KLOG_MSG_MAX + 2)
+
+void klog_init(void) {
+    for (int i = 0; i < NR_CPUS; i++) {
+        struct klog_ring *ring = &klog_rings[i];
+        ring->head = 0;
+        ring->tail = 0;
+        ring->logged = 0;
+        ring->dropped = 0;
+        ring->dropped_reported = 0;
+        ring->drained = 0;
+    }
+}
+
+// 预留一个条目，缓冲区满时返回 NULL
+static struct klog_entry *klog_reserve(struct klog_ring *ring, uint32_t *seq) {
+    uint32_t head;
+    do {
+        head = ring->head;
+        if (head - ring->tail >= KLOG_RING_SIZE) {
+            __sync_fetch_and_add(&ring->dropped, 1);
+            return NULL;
+        }
+    } while (!__sync_bool_compare_and_swap(&ring->head, head, head + 1));
+
+    *seq = head + 1;
+    return &ring->entries[head & (KLOG_RING_SIZE - 1)];
+}
+
+// 发布条目: 先写内容，再写序号
+static void klog_publish(struct klog_ring *ring, struct klog_entry *entry, uint32_t seq) {
+    barrier();
+    entry->seq = seq;
+    __sync_fetch_and_add(&ring->logged, 1);
+}
+
+void klog(int level, const char *fmt, ...) {
+    struct klog_ring *ring = &klog_rings[smp_processor_id()];
+    uint32_t seq;
+    struct klog_entry *entry = klog_reserve(ring, &seq);
+    if (!entry) {
+        return;
+    }
+
+    entry->tsc = tsc_read();
+    entry->level = level;
+    entry->cpu = smp_processor_id();
+
+    va_list ap;
+    va_start(ap, fmt);
+    int n = kvsnprintf(entry->msg, sizeof(entry->msg), fmt, ap);
+    va_end(ap);
+    entry->length = n < KLOG_MSG_MAX ? n : KLOG_MSG_MAX - 1;
+
+    klog_publish(ring, entry, seq);
+}
+
+void klog_hex(int level, const char *prefix, const uint8_t *data, uint16_t length) {
+    static const char digits[] = "0123456789abcdef";
+    struct klog_ring *ring = &klog_rings[smp_processor_id()];
+    uint32_t seq;
+    struct klog_entry *entry = klog_reserve(ring, &seq);
+    if (!entry) {
+        return;
+    }
+
+    entry->tsc = tsc_read();
+    entry->level = level;
+    entry->cpu = smp_processor_id();
+
+    int pos = ksnprintf(entry->msg, sizeof(entry->msg), "%s", prefix);
+    for (uint16_t i = 0; i < length && pos + 4 < KLOG_MSG_MAX; i++) {
+        entry->msg[pos++] = ' ';
+        entry->msg[pos++] = digits[data[i] >> 4];
+        entry->msg[pos++] = digits[data[i] & 0xF];
+    }
+    if (pos >= KLOG_MSG_MAX) {
+        pos = KLOG_MSG_MAX - 1;
+    }
+    entry->msg[pos] = '\0';
+    entry->length = pos;
+
+    klog_publish(ring, entry, seq);
+}
+
+// 输出一条: "[    秒.微秒] 级别 cpu 消息"
+static void klog_emit(const struct klog_entry *entry) {
+    char line[32];
+    uint32_t usec;
+    uint64_t sec = div64_u32(tsc_to_uptime_us(entry->tsc), 1000000, &usec);
+    ksnprintf(line, sizeof(line), "[%5u.%06u] %c%u ", (uint32_t)sec, usec,
+              klog_level_chars[entry->level & 3], entry->cpu);
+    serial_write_string(line);
+    serial_write_string(entry->msg);
+    serial_write_string("\r\n");
+}
+
+uint32_t klog_drain(uint32_t max) {
+    uint32_t count = 0;
+
+    for (int cpu = 0; cpu < NR_CPUS && count < max; cpu++) {
+        struct klog_ring *ring = &klog_rings[cpu];
+
+        // 报告新增的丢弃数量
+        uint32_t dropped = ring->dropped;
+        if (dropped != ring->dropped_reported) {
+            char line[48];
+            ksnprintf(line, sizeof(line), "klog: cpu%u dropped %u messages\r\n",
+                      (uint32_t)cpu, dropped - ring->dropped_reported);
+            serial_write_string(line);
+            ring->dropped_reported = dropped;
+        }
+
+        while (count < max && ring->tail != ring->head) {
+            // 串口队列放不下一整行时留到下一轮，不在这里等待
+            if ((serial_get_output() & SERIAL_OUT_UART) && serial_tx_room() < KLOG_LINE_MAX) {
+                return count;
+            }
+            uint32_t tail = ring->tail;
+            struct klog_entry *entry = &ring->entries[tail & (KLOG_RING_SIZE - 1)];
+            if (entry->seq != tail + 1) {
+                break;   // 写者尚未完成
+            }
+            klog_emit(entry);
+            mb();
+            ring->tail = tail + 1;
+            ring->drained++;
+            count++;
+        }
+    }
+    return count;
+}
+
+void klog_flush(void) {
+    while (klog_drain(KLOG_RING_SIZE)) {}
+}
+
+void klog_get_stats(struct klog_stats *stats) {
+    stats->logged = 0;
+    stats->dropped = 0;
+    stats->drained = 0;
+    for (int i = 0; i < NR_CPUS; i++) {
+        stats->logged += klog_rings[i].logged;
+        stats->dropped += klog_rings[i].dropped;
+        stats->drained += klog_rings[i].drained;
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef KLOG_H
+#define KLOG_H
+
+#include "types.h"
+
+// 日志级别
+#define KLOG_ERR   0
+#define KLOG_WARN  1
+#define KLOG_INFO  2
+#define KLOG_DEBUG 3
+
+// 每个CPU的日志条目数 (2的幂) 和单条消息最大长度
+#define KLOG_RING_SIZE 128
+#define KLOG_MSG_MAX   112
+
+// 主循环每轮最多输出的条目数，避免串口输出拖慢收包
+#define KLOG_DRAIN_BATCH 4
+
+struct klog_stats {
+    uint32_t logged;    // 写入环形缓冲区的条目
+    uint32_t dropped;   // 缓冲区满时丢弃的条目
+    uint32_t drained;   // 已输出到串口的条目
+};
+
+void klog_init(void);
+
+// 记录一条日志: 只格式化到内存，不等待串口; 缓冲区满时丢弃并计数
+void klog(int level, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+// 记录一段数据的十六进制内容 (最多到单条消息长度)
+void klog_hex(int level, const char *prefix, const uint8_t *data, uint16_t length);
+
+// 把缓冲区中的日志写到串口，最多 max 条，返回输出条数
+uint32_t klog_drain(uint32_t max);
+// 输出全部积压的日志
+void klog_flush(void);
+
+// 所有CPU的计数之和
+void klog_get_stats(struct klog_stats *stats);
+
+#endif // KLOG_H
@@ -0,0 +1,158 @@
+#include "kprintf.h"
+#include "tsc.h"
+
+// 输出游标: 超出缓冲区的字符被丢弃，但仍然计数
+struct kprintf_out {
+    char *buf;
+    size_t size;
+    size_t pos;
+};
+
+static void out_char(struct kprintf_out *out, char c) {
+    if (out->pos + 1 < out->size) {
+        out->buf[out->pos] = c;
+    }
+    out->pos++;
+}
+
+// 输出一个已转换好的字段，按宽度补齐
+static void out_field(struct kprintf_out *out, const char *s, int len, int width,
+                      bool left, char pad) {
+    int fill = width > len ? width - len : 0;
+
+    // 补零时负号必须在零之前
+    if (pad == '0' && len > 0 && s[0] == '-') {
+        out_char(out, '-');
+        s++;
+        len--;
+    }
+    if (!left) {
+        while (fill-- > 0) out_char(out, pad);
+    }
+    for (int i = 0; i < len; i++) {
+        out_char(out, s[i]);
+    }
+    if (left) {
+        while (fill-- > 0) out_char(out, ' ');
+    }
+}
+
+// 无符号数转换为字符串，返回长度; tmp 至少 24 字节
+static int format_unsigned(char *tmp, uint64_t value, uint32_t base, bool upper) {
+    const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    char rev[24];
+    int n = 0;
+
+    do {
+        uint32_t rem;
+        value = div64_u32(value, base, &rem);
+        rev[n++] = digits[rem];
+    } while (value);
+
+    for (int i = 0; i < n; i++) {
+        tmp[i] = rev[n - 1 - i];
+    }
+    return n;
+}
+
+int kvsnprintf(char *buf, size_t size, const char *fmt, va_list ap) {
+    struct kprintf_out out = { buf, size, 0 };
+    char tmp[24];
+
+    while (*fmt) {
+        if (*fmt != '%') {
+            out_char(&out, *fmt++);
+            continue;
+        }
+        fmt++;
+
+        bool left = false;
+        char pad = ' ';
+        while (*fmt == '-' || *fmt == '0') {
+            if (*fmt == '-') left = true;
+            else pad = '0';
+            fmt++;
+        }
+        if (left) pad = ' ';
+
+        int width = 0;
+        while (*fmt >= '0' && *fmt <= '9') {
+            width = width * 10 + (*fmt++ - '0');
+        }
+
+        int longs = 0;
+        while (*fmt == 'l') {
+            longs++;
+            fmt++;
+        }
+
+        switch (*fmt) {
+            case 'd':
+            case 'i': {
+                long long value = longs >= 2 ? va_arg(ap, long long) : va_arg(ap, int);
+                int len = 0;
+                uint64_t mag = (uint64_t)value;
+                if (value < 0) {
+                    tmp[len++] = '-';
+                    mag = -(uint64_t)value;
+                }
+                len += format_unsigned(tmp + len, mag, 10, false);
+                out_field(&out, tmp, len, width, left, pad);
+                break;
+            }
+            case 'u':
+            case 'x':
+            case 'X': {
+                uint64_t value = longs >= 2 ? va_arg(ap, uint64_t) : va_arg(ap, uint32_t);
+                uint32_t base = *fmt == 'u' ? 10 : 16;
+                int len = format_unsigned(tmp, value, base, *fmt == 'X');
+                out_field(&out, tmp, len, width, left, pad);
+                break;
+            }
+            case 'p': {
+                tmp[0] = '0';
+                tmp[1] = 'x';
+                int len = 2 + format_unsigned(tmp + 2, (uintptr_t)va_arg(ap, void *), 16, false);
+                out_field(&out, tmp, len, width, left, ' ');
+                break;
+            }
+            case 'c':
+                tmp[0] = (char)va_arg(ap, int);
+                out_field(&out, tmp, 1, width, left, ' ');
+                break;
+            case 's': {
+                const char *s = va_arg(ap, const char *);
+                if (!s) s = "(null)";
+                int len = 0;
+                while (s[len]) len++;
+                out_field(&out, s, len, width, left, ' ');
+                break;
+            }
+            case '%':
+                out_char(&out, '%');
+                break;
+            case '\0':
+                fmt--;
+                break;
+            default:
+                // 未知格式原样输出
+                out_char(&out, '%');
+                out_char(&out, *fmt);
+                break;
+        }
+        fmt++;
+    }
+
+    if (size > 0) {
+        buf[out.pos < size ? out.pos : size - 1] = '\0';
+    }
+    return (int)out.pos;
+}
+
+int ksnprintf(char *buf, size_t size, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = kvsnprintf(buf, size, fmt, ap);
+    va_end(ap);
+    return n;
+}
@@ -0,0 +1,17 @@
+#ifndef KPRINTF_H
+#define KPRINTF_H
+
+#include "types.h"
+
+// 可变参数 (内核不使用标准头文件)
+typedef __builtin_va_list va_list;
+#define va_start(ap, last) __builtin_va_start(ap, last)
+#define va_arg(ap, type)   __builtin_va_arg(ap, type)
+#define va_end(ap)         __builtin_va_end(ap)
+
+// 格式化到缓冲区，总是以 '\0' 结尾; 与 snprintf 相同，返回完整输出需要的长度
+// 支持 %d %i %u %x %X %c %s %p %%，标志 '-' '0'，宽度，长度修饰 l / ll
+int kvsnprintf(char *buf, size_t size, const char *fmt, va_list ap);
+int ksnprintf(char *buf, size_t size, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+
+#endif // KPRINTF_H
@@ -0,0 +1,59 @@
+#include "lapic.h"
+
+#define MSR_IA32_APIC_BASE       0x1B
+#define MSR_APIC_BASE_ENABLE     0x800
+#define CPUID_1_EDX_APIC         (1u << 9)
+
+static volatile uint32_t *lapic_base;
+static uint32_t lapic_apic_ids[NR_CPUS];
+
+static inline uint32_t lapic_read(uint32_t reg) {
+    return lapic_base[reg / 4];
+}
+
+static inline void lapic_write(uint32_t reg, uint32_t value) {
+    lapic_base[reg / 4] = value;
+}
+
+static inline uint64_t rdmsr(uint32_t msr) {
+    uint32_t lo, hi;
+    asm volatile("rdmsr" : "=a"(lo), "=d"(hi) : "c"(msr));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+bool lapic_init(void) {
+    uint32_t eax = 1, ebx, ecx, edx;
+    asm volatile("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+    if (!(edx & CPUID_1_EDX_APIC)) {
+        return false;
+    }
+    // 全局使能位由固件设置; 清除后需要复位才能重新打开，这里只检查
+    uint64_t base = rdmsr(MSR_IA32_APIC_BASE);
+    if (!(base & MSR_APIC_BASE_ENABLE)) {
+        return false;
+    }
+    lapic_base = (volatile uint32_t *)(uint32_t)(base & 0xFFFFF000);
+
+    // 软件使能; LVT (LINT0 虚拟线) 保持固件的设置
+    lapic_write(LAPIC_REG_SVR, LAPIC_SVR_ENABLE | LAPIC_SPURIOUS_VECTOR);
+    for (uint32_t cpu = 0; cpu < NR_CPUS; cpu++) {
+        lapic_apic_ids[cpu] = lapic_id();
+    }
+    return true;
+}
+
+bool lapic_present(void) {
+    return lapic_base != NULL;
+}
+
+uint32_t lapic_id(void) {
+    return lapic_read(LAPIC_REG_ID) >> 24;
+}
+
+uint32_t lapic_cpu_apic_id(uint32_t cpu) {
+    return lapic_apic_ids[cpu < NR_CPUS ? cpu : 0];
+}
+
+void lapic_eoi(void) {
+    lapic_write(LAPIC_REG_EOI, 0);
+}
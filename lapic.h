@@ -0,0 +1,32 @@
+#ifndef LAPIC_H
+#define LAPIC_H
+
+#include "types.h"
+#include "cpu.h"
+
+// 本地APIC: 只用于接收MSI/MSI-X (消息直接写到目标CPU的LAPIC)
+// 传统IRQ仍由8259A经LINT0 (虚拟线模式) 送达，不受影响
+// 没有分页，寄存器页按物理地址访问
+
+#define LAPIC_DEFAULT_BASE 0xFEE00000
+
+// 寄存器偏移
+#define LAPIC_REG_ID   0x020
+#define LAPIC_REG_VER  0x030
+#define LAPIC_REG_EOI  0x0B0
+#define LAPIC_REG_SVR  0x0F0
+
+#define LAPIC_SVR_ENABLE 0x100
+
+// 伪中断向量; isr_default 直接返回，伪中断不需要EOI
+#define LAPIC_SPURIOUS_VECTOR 0xFF
+
+// 检测LAPIC (CPUID.1:EDX bit 9) 并软件使能，返回是否可用
+bool lapic_init(void);
+bool lapic_present(void);
+uint32_t lapic_id(void);
+// 逻辑CPU对应的APIC ID; 其他AP尚未启动，未知的CPU返回引导CPU的ID
+uint32_t lapic_cpu_apic_id(uint32_t cpu);
+void lapic_eoi(void);
+
+#endif // LAPIC_H
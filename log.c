@@ -0,0 +1,67 @@
+#include "log.h"
+
+// 每个子系统的运行时级别; LOG_ENABLED 在热路径上直接读取
+uint8_t log_runtime_level[LOG_SUBSYS_COUNT] = {
+    LOG_RUNTIME_DEFAULT, LOG_RUNTIME_DEFAULT, LOG_RUNTIME_DEFAULT,
+    LOG_RUNTIME_DEFAULT, LOG_RUNTIME_DEFAULT,
+};
+
+static const char *const log_subsys_names[LOG_SUBSYS_COUNT] = {
+    "RTL", "ARP", "IP", "ICMP", "TCP",
+};
+
+static const uint8_t log_compiled_level[LOG_SUBSYS_COUNT] = {
+    LOG_LEVEL_RTL, LOG_LEVEL_ARP, LOG_LEVEL_IP, LOG_LEVEL_ICMP, LOG_LEVEL_TCP,
+};
+
+void log_set_level(int subsys, int level) {
+    if (subsys < 0 || subsys >= LOG_SUBSYS_COUNT) {
+        return;
+    }
+    if (level < KLOG_ERR) level = KLOG_ERR;
+    if (level > KLOG_DEBUG) level = KLOG_DEBUG;
+    log_runtime_level[subsys] = (uint8_t)level;
+}
+
+int log_get_level(int subsys) {
+    if (subsys < 0 || subsys >= LOG_SUBSYS_COUNT) {
+        return -1;
+    }
+    return log_runtime_level[subsys];
+}
+
+int log_get_compiled_level(int subsys) {
+    if (subsys < 0 || subsys >= LOG_SUBSYS_COUNT) {
+        return -1;
+    }
+    return log_compiled_level[subsys];
+}
+
+void log_set_all(int level) {
+    for (int i = 0; i < LOG_SUBSYS_COUNT; i++) {
+        log_set_level(i, level);
+    }
+}
+
+const char *log_subsys_name(int subsys) {
+    if (subsys < 0 || subsys >= LOG_SUBSYS_COUNT) {
+        return "?";
+    }
+    return log_subsys_names[subsys];
+}
+
+// 名称比较不区分大小写，便于控制台输入
+int log_subsys_from_name(const char *name) {
+    for (int i = 0; i < LOG_SUBSYS_COUNT; i++) {
+        const char *a = log_subsys_names[i];
+        const char *b = name;
+        while (*a && (*b == *a || *b == *a + ('a' - 'A'))) {
+            a++;
+            b++;
+        }
+        if (*a == '\0' && *b == '\0') {
+            return i;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,83 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include "types.h"
+#include "klog.h"
+
+// 按子系统分级的日志
+// 编译期级别决定语句是否存在: 高于 LOG_LEVEL_<子系统> 的语句整体被编译器删除
+// 运行时级别只能在编译期级别以内调节 (log_set_level)
+
+// 子系统编号
+#define LOG_SUBSYS_RTL   0
+#define LOG_SUBSYS_ARP   1
+#define LOG_SUBSYS_IP    2
+#define LOG_SUBSYS_ICMP  3
+#define LOG_SUBSYS_TCP   4
+#define LOG_SUBSYS_COUNT 5
+
+// 编译期默认级别: 调试构建保留全部语句，发布构建只保留警告和错误
+// 可以用 -DLOG_LEVEL_DEFAULT=n 或 -DLOG_LEVEL_RTL=n 等单独覆盖
+#ifndef LOG_LEVEL_DEFAULT
+#ifdef DEBUG
+#define LOG_LEVEL_DEFAULT KLOG_DEBUG
+#else
+#define LOG_LEVEL_DEFAULT KLOG_WARN
+#endif
+#endif
+
+// 运行时初始级别 (不超过编译期级别)
+#ifndef LOG_RUNTIME_DEFAULT
+#define LOG_RUNTIME_DEFAULT KLOG_INFO
+#endif
+
+#ifndef LOG_LEVEL_RTL
+#define LOG_LEVEL_RTL LOG_LEVEL_DEFAULT
+#endif
+#ifndef LOG_LEVEL_ARP
+#define LOG_LEVEL_ARP LOG_LEVEL_DEFAULT
+#endif
+#ifndef LOG_LEVEL_IP
+#define LOG_LEVEL_IP LOG_LEVEL_DEFAULT
+#endif
+#ifndef LOG_LEVEL_ICMP
+#define LOG_LEVEL_ICMP LOG_LEVEL_DEFAULT
+#endif
+#ifndef LOG_LEVEL_TCP
+#define LOG_LEVEL_TCP LOG_LEVEL_DEFAULT
+#endif
+
+extern uint8_t log_runtime_level[LOG_SUBSYS_COUNT];
+
+// 某子系统的某级别当前是否输出; 编译期关闭时为常量 false
+#define LOG_ENABLED(sub, level) \
+    ((level) <= LOG_LEVEL_##sub && (level) <= log_runtime_level[LOG_SUBSYS_##sub])
+
+#define LOG(sub, level, fmt, ...) do { \
+    if (LOG_ENABLED(sub, level)) { \
+        klog((level), #sub ": " fmt, ##__VA_ARGS__); \
+    } \
+} while (0)
+
+#define LOG_HEX(sub, level, prefix, data, length) do { \
+    if (LOG_ENABLED(sub, level)) { \
+        klog_hex((level), #sub ": " prefix, (data), (length)); \
+    } \
+} while (0)
+
+#define LOG_ERR(sub, fmt, ...)   LOG(sub, KLOG_ERR, fmt, ##__VA_ARGS__)
+#define LOG_WARN(sub, fmt, ...)  LOG(sub, KLOG_WARN, fmt, ##__VA_ARGS__)
+#define LOG_INFO(sub, fmt, ...)  LOG(sub, KLOG_INFO, fmt, ##__VA_ARGS__)
+#define LOG_DEBUG(sub, fmt, ...) LOG(sub, KLOG_DEBUG, fmt, ##__VA_ARGS__)
+
+// 运行时调节; 超过编译期级别的部分没有效果
+void log_set_level(int subsys, int level);
+int log_get_level(int subsys);
+int log_get_compiled_level(int subsys);
+void log_set_all(int level);
+
+// 子系统名称 ("RTL"、"ARP" ...) 与编号互查，未知名称返回 -1
+const char *log_subsys_name(int subsys);
+int log_subsys_from_name(const char *name);
+
+#endif // LOG_H
@@ -0,0 +1,34 @@
+#ifndef LOOPBACK_H
+#define LOOPBACK_H
+
+#include "types.h"
+
+// 回环队列深度和最大帧长
+#define LOOPBACK_RING_SIZE 32
+#define LOOPBACK_FRAME_MAX 1536
+
+// 回环设备统计
+struct loopback_stats {
+    uint32_t tx_frames;    // 进入队列的帧
+    uint32_t rx_frames;    // 投递到协议栈的帧
+    uint32_t dropped;      // 队列满或帧过长被丢弃
+    uint32_t batches;      // 投递批次数
+};
+
+// 初始化并注册回环设备 "lo"
+void loopback_init(void);
+
+// 批量投递阈值: 队列中积累到 batch 帧时立即投递
+// 1 = 每帧立即投递, 0 = 只在轮询时投递
+void loopback_set_batch(uint16_t batch);
+uint16_t loopback_get_batch(void);
+
+// 投递队列中所有待处理的帧
+void loopback_flush(void);
+
+// 当前排队的帧数
+uint32_t loopback_pending(void);
+
+const struct loopback_stats *loopback_get_stats(void);
+
+#endif // LOOPBACK_H
@@ -2,16 +2,27 @@
 #include "memory.h"
 
 // 内核堆的起始和结束地址
+#ifdef HOST_BUILD
+// 主机构建没有链接脚本提供的 kernel_end，堆是一块静态数组
+#define HOST_HEAP_SIZE (64 * 1024 * 1024)
+static uint8_t host_heap[HOST_HEAP_SIZE];
+#define HEAP_START ((uintptr_t)host_heap)
+#else
 extern uint32_t kernel_end;
-static uint32_t heap_end = (uint32_t)&kernel_end;
+#define HEAP_START ((uintptr_t)&kernel_end)
+#endif
+static uintptr_t heap_end = HEAP_START;
+static uint32_t alloc_count = 0;
+static uint32_t free_count = 0;
 
 // 简单的内存分配器
 void* kmalloc(size_t size) {
     // 对齐到4字节边界
     size = (size + 3) & ~3;
+    alloc_count++;
     
     // 分配内存
-    uint32_t addr = heap_end;
+    uintptr_t addr = heap_end;
     heap_end += size;
     
     return (void*)addr;
@@ -21,9 +32,30 @@ void* kmalloc(size_t size) {
 void kfree(void* ptr) {
     // 这个简单的实现不做任何事情
     (void)ptr;
+    free_count++;
 }
 
-void* memset(void* dest, int val, size_t len) {
+void memory_get_stats(struct memory_stats *stats) {
+    stats->heap_start = (uint32_t)HEAP_START;
+    stats->heap_end = (uint32_t)heap_end;
+    stats->allocs = alloc_count;
+    stats->frees = free_count;
+}
+
+uintptr_t memory_heap_mark(void) {
+    return heap_end;
+}
+
+void memory_heap_rewind(uintptr_t mark) {
+    if (mark >= HEAP_START && mark <= heap_end) {
+        heap_end = mark;
+    }
+}
+
+// 主机构建使用libc的 memset/memcpy/memcmp
+// used: LTO 构建中编译器生成的 memset/memcpy 调用 (结构体赋值等) 在代码生成时才出现，不能被当作无引用删除
+#ifndef HOST_BUILD
+__attribute__((used)) void* memset(void* dest, int val, size_t len) {
     uint8_t* ptr = (uint8_t*)dest;
     while(len-- > 0) {
         *ptr++ = val;
@@ -31,7 +63,7 @@ void* memset(void* dest, int val, size_t len) {
     return dest;
 }
 
-void* memcpy(void* dest, const void* src, size_t len) {
+__attribute__((used)) void* memcpy(void* dest, const void* src, size_t len) {
     uint8_t* d = (uint8_t*)dest;
     const uint8_t* s = (const uint8_t*)src;
     while(len-- > 0) {
@@ -51,4 +83,5 @@ int memcmp(const void* s1, const void* s2, size_t n) {
         p2++;
     }
     return 0;
-} 
\ No newline at end of file
+}
+#endif // HOST_BUILD
@@ -3,13 +3,29 @@
 
 #include "types.h"
 
-// 内存操作函数声明
+// 内存操作函数声明 (主机构建中由libc提供)
+#ifdef HOST_BUILD
+#include <string.h>
+#else
 void* memset(void* dest, int val, size_t len);
 void* memcpy(void* dest, const void* src, size_t len);
 int memcmp(const void* s1, const void* s2, size_t n);
+#endif
 
 // 内存分配函数声明
 void* kmalloc(size_t size);
 void kfree(void* ptr);
 
+// 堆使用情况 (分配器只增长，kfree 不回收)
+struct memory_stats {
+    uint32_t heap_start;
+    uint32_t heap_end;
+    uint32_t allocs;
+    uint32_t frees;
+};
+void memory_get_stats(struct memory_stats *stats);
+// 记下堆顶 / 回退到记下的位置，期间分配的内存全部作废 (基准测试用)
+uintptr_t memory_heap_mark(void);
+void memory_heap_rewind(uintptr_t mark);
+
 #endif // MEMORY_H 
\ No newline at end of file
@@ -0,0 +1,210 @@
+#include "msi.h"
+#include "lapic.h"
+#include "trace.h"
+#include "kprintf.h"
+#include "serial.h"
+
+struct msi_vector {
+    const char *name;
+    msi_handler_t handler;
+    void *data;
+    uint32_t cpu;
+    uint32_t count;
+};
+
+static struct msi_vector msi_vectors[NR_MSI_VECTORS];
+
+uint8_t msi_alloc_vector(const char *name, msi_handler_t handler, void *data, uint32_t cpu) {
+    if (!lapic_present()) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < NR_MSI_VECTORS; i++) {
+        struct msi_vector *v = &msi_vectors[i];
+        if (!v->handler) {
+            v->name = name;
+            v->data = data;
+            v->cpu = cpu;
+            v->count = 0;
+            v->handler = handler;
+            return MSI_BASE_VECTOR + i;
+        }
+    }
+    return 0;
+}
+
+void msi_free_vector(uint8_t vector) {
+    uint32_t i = vector - MSI_BASE_VECTOR;
+    if (i < NR_MSI_VECTORS) {
+        uint32_t flags = local_irq_save();
+        msi_vectors[i].handler = NULL;
+        msi_vectors[i].data = NULL;
+        local_irq_restore(flags);
+    }
+}
+
+void msi_dispatch(uint32_t index, struct irq_frame *frame) {
+    (void)frame;
+    struct msi_vector *v = &msi_vectors[index];
+    v->count++;
+    TRACE(TRACE_IRQ_ENTRY, MSI_BASE_VECTOR + index, 0, 0);
+    if (v->handler) {
+        v->handler(v->data);
+    }
+    TRACE(TRACE_IRQ_EXIT, MSI_BASE_VECTOR + index, 0, 0);
+    lapic_eoi();
+}
+
+uint32_t msi_get_count(uint8_t vector) {
+    uint32_t i = vector - MSI_BASE_VECTOR;
+    return i < NR_MSI_VECTORS ? msi_vectors[i].count : 0;
+}
+
+static uint32_t msi_address(uint8_t vector) {
+    return MSI_ADDR_BASE | MSI_ADDR_DEST(lapic_cpu_apic_id(msi_vectors[vector - MSI_BASE_VECTOR].cpu));
+}
+
+static bool msi_vector_valid(uint8_t vector) {
+    return vector >= MSI_BASE_VECTOR && vector < MSI_BASE_VECTOR + NR_MSI_VECTORS &&
+           msi_vectors[vector - MSI_BASE_VECTOR].handler;
+}
+
+bool pci_msi_enable(struct pci_dev *dev, uint8_t vector) {
+    uint8_t cap = pci_find_capability(dev, PCI_CAP_ID_MSI);
+    if (!cap || !msi_vector_valid(vector)) {
+        return false;
+    }
+    uint16_t flags = pci_read_word(dev, cap + PCI_MSI_FLAGS);
+    bool is64 = flags & PCI_MSI_FLAGS_64BIT;
+
+    pci_write_dword(dev, cap + PCI_MSI_ADDRESS_LO, msi_address(vector));
+    if (is64) {
+        pci_write_dword(dev, cap + PCI_MSI_ADDRESS_HI, 0);
+    }
+    pci_write_word(dev, cap + (is64 ? PCI_MSI_DATA_64 : PCI_MSI_DATA_32), vector);
+
+    // 只启用一个消息 (多消息要求连续且对齐的向量块)
+    flags = (flags & ~PCI_MSI_FLAGS_QSIZE) | PCI_MSI_FLAGS_ENABLE;
+    pci_write_word(dev, cap + PCI_MSI_FLAGS, flags);
+    pci_enable_device(dev, PCI_COMMAND_MASTER | PCI_COMMAND_INTX_DISABLE);
+    pci_msi_unmask(dev);
+    return true;
+}
+
+void pci_msi_disable(struct pci_dev *dev) {
+    uint8_t cap = pci_find_capability(dev, PCI_CAP_ID_MSI);
+    if (cap) {
+        uint16_t flags = pci_read_word(dev, cap + PCI_MSI_FLAGS);
+        pci_write_word(dev, cap + PCI_MSI_FLAGS, flags & ~PCI_MSI_FLAGS_ENABLE);
+    }
+}
+
+// 屏蔽寄存器每位对应一个消息，只用了第0个
+static void pci_msi_set_mask(struct pci_dev *dev, uint32_t mask) {
+    uint8_t cap = pci_find_capability(dev, PCI_CAP_ID_MSI);
+    if (!cap) {
+        return;
+    }
+    uint16_t flags = pci_read_word(dev, cap + PCI_MSI_FLAGS);
+    if (flags & PCI_MSI_FLAGS_MASKBIT) {
+        pci_write_dword(dev, cap + ((flags & PCI_MSI_FLAGS_64BIT) ? PCI_MSI_MASK_64 : PCI_MSI_MASK_32), mask);
+    }
+}
+
+void pci_msi_mask(struct pci_dev *dev) {
+    pci_msi_set_mask(dev, 1);
+}
+
+void pci_msi_unmask(struct pci_dev *dev) {
+    pci_msi_set_mask(dev, 0);
+}
+
+uint16_t pci_msix_table_size(const struct pci_dev *dev) {
+    uint8_t cap = pci_find_capability(dev, PCI_CAP_ID_MSIX);
+    if (!cap) {
+        return 0;
+    }
+    return (pci_read_word(dev, cap + PCI_MSIX_FLAGS) & PCI_MSIX_FLAGS_QSIZE) + 1;
+}
+
+bool pci_msix_enable(struct pci_dev *dev) {
+    uint8_t cap = pci_find_capability(dev, PCI_CAP_ID_MSIX);
+    if (!cap || !lapic_present()) {
+        return false;
+    }
+    uint32_t table = pci_read_dword(dev, cap + PCI_MSIX_TABLE);
+    uint8_t bir = table & 7;
+    if (bir >= PCI_MAX_BARS) {
+        return false;
+    }
+    const struct pci_bar *bar = &dev->bars[bir];
+    if (!bar->size || (bar->flags & PCI_BAR_IO) || bar->base + (table & ~7u) >= 0x100000000ULL) {
+        return false;
+    }
+    dev->msix_table = (volatile uint32_t *)(uint32_t)(bar->base + (table & ~7u));
+    dev->msix_entries = pci_msix_table_size(dev);
+    pci_enable_device(dev, PCI_COMMAND_MEMORY | PCI_COMMAND_MASTER | PCI_COMMAND_INTX_DISABLE);
+
+    // 先在功能级屏蔽下启用，逐项屏蔽后再解除功能级屏蔽，避免表项中的旧内容触发中断
+    uint16_t flags = pci_read_word(dev, cap + PCI_MSIX_FLAGS);
+    pci_write_word(dev, cap + PCI_MSIX_FLAGS, flags | PCI_MSIX_FLAGS_ENABLE | PCI_MSIX_FLAGS_MASKALL);
+    for (uint16_t i = 0; i < dev->msix_entries; i++) {
+        pci_msix_mask(dev, i);
+    }
+    pci_write_word(dev, cap + PCI_MSIX_FLAGS, (flags | PCI_MSIX_FLAGS_ENABLE) & ~PCI_MSIX_FLAGS_MASKALL);
+    return true;
+}
+
+void pci_msix_disable(struct pci_dev *dev) {
+    uint8_t cap = pci_find_capability(dev, PCI_CAP_ID_MSIX);
+    if (cap) {
+        uint16_t flags = pci_read_word(dev, cap + PCI_MSIX_FLAGS);
+        pci_write_word(dev, cap + PCI_MSIX_FLAGS, flags & ~PCI_MSIX_FLAGS_ENABLE);
+    }
+    dev->msix_table = NULL;
+    dev->msix_entries = 0;
+}
+
+bool pci_msix_set_vector(struct pci_dev *dev, uint16_t entry, uint8_t vector) {
+    if (!dev->msix_table || entry >= dev->msix_entries || !msi_vector_valid(vector)) {
+        return false;
+    }
+    volatile uint32_t *e = dev->msix_table + entry * (PCI_MSIX_ENTRY_SIZE / 4);
+    // 修改消息时保持屏蔽
+    e[PCI_MSIX_ENTRY_CTRL] |= PCI_MSIX_ENTRY_CTRL_MASK;
+    e[PCI_MSIX_ENTRY_ADDR_LO] = msi_address(vector);
+    e[PCI_MSIX_ENTRY_ADDR_HI] = 0;
+    e[PCI_MSIX_ENTRY_DATA] = vector;
+    e[PCI_MSIX_ENTRY_CTRL] &= ~PCI_MSIX_ENTRY_CTRL_MASK;
+    return true;
+}
+
+void pci_msix_mask(struct pci_dev *dev, uint16_t entry) {
+    if (dev->msix_table && entry < dev->msix_entries) {
+        dev->msix_table[entry * (PCI_MSIX_ENTRY_SIZE / 4) + PCI_MSIX_ENTRY_CTRL] |= PCI_MSIX_ENTRY_CTRL_MASK;
+    }
+}
+
+void pci_msix_unmask(struct pci_dev *dev, uint16_t entry) {
+    if (dev->msix_table && entry < dev->msix_entries) {
+        dev->msix_table[entry * (PCI_MSIX_ENTRY_SIZE / 4) + PCI_MSIX_ENTRY_CTRL] &= ~PCI_MSIX_ENTRY_CTRL_MASK;
+    }
+}
+
+void msi_dump(void) {
+    char line[80];
+    if (!lapic_present()) {
+        serial_write_string("msi: no local APIC\n");
+        return;
+    }
+    ksnprintf(line, sizeof(line), "lapic id %u\n", lapic_id());
+    serial_write_string(line);
+    for (uint32_t i = 0; i < NR_MSI_VECTORS; i++) {
+        const struct msi_vector *v = &msi_vectors[i];
+        if (!v->handler) {
+            continue;
+        }
+        ksnprintf(line, sizeof(line), "vector 0x%02x cpu %u apic %u count %u %s\n", MSI_BASE_VECTOR + i,
+                  v->cpu, lapic_cpu_apic_id(v->cpu), v->count, v->name);
+        serial_write_string(line);
+    }
+}
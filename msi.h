@@ -0,0 +1,80 @@
+#ifndef MSI_H
+#define MSI_H
+
+#include "types.h"
+#include "pci.h"
+
+// MSI/MSI-X: 设备把中断消息直接写到目标CPU的LAPIC，不经过PIC
+// 每个向量有自己的处理函数和目标CPU，多队列网卡可以每个队列一个向量
+// 向量紧接在PIC的16个向量之后，入口在 idt_asm.asm (msi_stub_table)
+
+#define MSI_BASE_VECTOR 0x30
+#define NR_MSI_VECTORS  16
+
+// MSI能力结构 (相对能力偏移)
+#define PCI_MSI_FLAGS         0x02
+#define PCI_MSI_ADDRESS_LO    0x04
+#define PCI_MSI_ADDRESS_HI    0x08    // 仅64位
+#define PCI_MSI_DATA_32       0x08
+#define PCI_MSI_DATA_64       0x0C
+#define PCI_MSI_MASK_32       0x0C
+#define PCI_MSI_MASK_64       0x10
+
+#define PCI_MSI_FLAGS_ENABLE  0x0001
+#define PCI_MSI_FLAGS_QMASK   0x000E  // 设备支持的消息数 (log2)
+#define PCI_MSI_FLAGS_QSIZE   0x0070  // 启用的消息数 (log2)
+#define PCI_MSI_FLAGS_64BIT   0x0080
+#define PCI_MSI_FLAGS_MASKBIT 0x0100  // 支持按向量屏蔽
+
+// MSI-X能力结构
+#define PCI_MSIX_FLAGS        0x02
+#define PCI_MSIX_TABLE        0x04    // 低3位为BAR编号 (BIR)
+#define PCI_MSIX_PBA          0x08
+
+#define PCI_MSIX_FLAGS_QSIZE  0x07FF  // 表项数 - 1
+#define PCI_MSIX_FLAGS_MASKALL 0x4000
+#define PCI_MSIX_FLAGS_ENABLE 0x8000
+
+// MSI-X表项 (16字节)，按32位字访问
+#define PCI_MSIX_ENTRY_SIZE      16
+#define PCI_MSIX_ENTRY_ADDR_LO   0
+#define PCI_MSIX_ENTRY_ADDR_HI   1
+#define PCI_MSIX_ENTRY_DATA      2
+#define PCI_MSIX_ENTRY_CTRL      3
+#define PCI_MSIX_ENTRY_CTRL_MASK 0x1
+
+// 消息地址: 0xFEE 区域 + 目标APIC ID (物理目标模式)，数据: 固定投递、边沿触发的向量号
+#define MSI_ADDR_BASE       0xFEE00000
+#define MSI_ADDR_DEST(id)   ((uint32_t)(id) << 12)
+
+typedef void (*msi_handler_t)(void *data);
+
+struct irq_frame;
+
+// 分配一个向量并把消息目标设为 cpu 的LAPIC，没有空闲向量或LAPIC不可用时返回0
+uint8_t msi_alloc_vector(const char *name, msi_handler_t handler, void *data, uint32_t cpu);
+// 释放向量; 调用者必须先让设备停止使用它 (屏蔽表项或关闭MSI/MSI-X)
+void msi_free_vector(uint8_t vector);
+// 由汇编入口调用: 执行处理函数并向LAPIC发送EOI
+void msi_dispatch(uint32_t index, struct irq_frame *frame);
+uint32_t msi_get_count(uint8_t vector);
+
+// MSI: 单个消息; 设备不支持按向量屏蔽时 mask/unmask 什么也不做
+bool pci_msi_enable(struct pci_dev *dev, uint8_t vector);
+void pci_msi_disable(struct pci_dev *dev);
+void pci_msi_mask(struct pci_dev *dev);
+void pci_msi_unmask(struct pci_dev *dev);
+
+// MSI-X: 启用后所有表项处于屏蔽状态，pci_msix_set_vector 写入消息并解除屏蔽
+// 表所在的内存BAR按物理地址访问，必须在4GB以下
+uint16_t pci_msix_table_size(const struct pci_dev *dev);
+bool pci_msix_enable(struct pci_dev *dev);
+void pci_msix_disable(struct pci_dev *dev);
+bool pci_msix_set_vector(struct pci_dev *dev, uint16_t entry, uint8_t vector);
+void pci_msix_mask(struct pci_dev *dev, uint16_t entry);
+void pci_msix_unmask(struct pci_dev *dev, uint16_t entry);
+
+// 已分配的向量、目标CPU和中断次数 (控制台 msi 命令)
+void msi_dump(void);
+
+#endif // MSI_H
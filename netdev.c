@@ -0,0 +1,277 @@
+#include "netdev.h"
+#include "network.h"
+#include "serial.h"
+#include "memory.h"
+#include "trace.h"
+#include "netstats.h"
+#include "capture.h"
+#include "netlat.h"
+#include "region.h"
+
+// 已注册设备链表
+static struct netdev *netdev_list = NULL;
+// 默认出口设备 (第一个注册的非回环设备)
+static struct netdev *default_dev = NULL;
+// 回环设备
+static struct netdev *loopback_dev = NULL;
+
+static bool name_equal(const char *a, const char *b) {
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+// 注册网络设备
+void netdev_register(struct netdev *dev) {
+    struct netdev **pp = &netdev_list;
+    while (*pp) {
+        pp = &(*pp)->next;
+    }
+    dev->next = NULL;
+    *pp = dev;
+
+    if (dev->flags & NETDEV_FLAG_LOOPBACK) {
+        if (!loopback_dev) loopback_dev = dev;
+    } else if (!default_dev) {
+        default_dev = dev;
+    }
+
+    serial_write_string("netdev: registered ");
+    serial_write_string(dev->name);
+    serial_write_string("\r\n");
+}
+
+// 按名称查找设备
+struct netdev *netdev_find(const char *name) {
+    for (struct netdev *dev = netdev_list; dev; dev = dev->next) {
+        if (name_equal(dev->name, name)) {
+            return dev;
+        }
+    }
+    return NULL;
+}
+
+struct netdev *netdev_get_default(void) {
+    return default_dev;
+}
+
+struct netdev *netdev_get_loopback(void) {
+    return loopback_dev;
+}
+
+struct netdev *netdev_first(void) {
+    return netdev_list;
+}
+
+// 127.0.0.0/8
+bool ip_is_loopback(uint32_t ip) {
+    return (ip >> 24) == 127;
+}
+
+// 发给本机的地址: 回环网段或本机IP
+bool ip_is_local(uint32_t ip) {
+    return ip_is_loopback(ip) || ip == net_dev.ip_addr;
+}
+
+// 选择出口设备
+struct netdev *netdev_route(uint32_t dst_ip) {
+    if (loopback_dev && ip_is_local(dst_ip)) {
+        return loopback_dev;
+    }
+    return default_dev;
+}
+
+// 软件补全部分校验和: 字段中已有伪首部和，从 csum_start 累加到帧尾
+// 分片可能从奇数偏移开始，此时该段的和需要交换字节
+static void netdev_sw_checksum(const struct netdev_frag *frags, int nfrags,
+                               const struct netdev_tx_meta *meta) {
+    uint32_t sum = 0;
+    uint32_t offset = 0;
+    uint32_t sum_offset = 0;   // 相对 csum_start 已累加的字节数
+
+    for (int i = 0; i < nfrags; i++) {
+        const uint8_t *data = (const uint8_t *)frags[i].data;
+        uint32_t start = 0;
+        if (offset + frags[i].length <= meta->csum_start) {
+            offset += frags[i].length;
+            continue;
+        }
+        if (offset < meta->csum_start) {
+            start = meta->csum_start - offset;
+        }
+
+        uint32_t part = network_checksum_fold(
+            network_checksum_add(data + start, frags[i].length - start, 0));
+        if (sum_offset & 1) {
+            part = ((part & 0xFF) << 8) | (part >> 8);
+        }
+        sum += part;
+        sum_offset += frags[i].length - start;
+        offset += frags[i].length;
+    }
+
+    // 字段已在累加范围内; 它位于调用者自己的头部缓冲区，可以写回
+    uint16_t *field = (uint16_t *)((uint8_t *)frags[0].data + meta->csum_start + meta->csum_offset);
+    *field = ~network_checksum_fold(sum);
+}
+
+// 通过指定设备发送一帧
+bool netdev_xmit(struct netdev *dev, uint8_t *frame, uint16_t length) {
+    return netdev_xmit_meta(dev, frame, length, NULL);
+}
+
+bool netdev_xmit_meta(struct netdev *dev, uint8_t *frame, uint16_t length,
+                      const struct netdev_tx_meta *meta) {
+    struct netdev_frag frag = { frame, length };
+    return netdev_xmit_sg(dev, &frag, 1, meta);
+}
+
+// 检查并处理设备不支持的卸载; 返回 false 表示帧无法发送
+static bool netdev_tx_offload(struct netdev *dev, const struct netdev_frag *frags, int nfrags,
+                              const struct netdev_tx_meta **meta) {
+    if (!*meta) {
+        return true;
+    }
+    // 超长段只能交给支持TSO的设备，协议层负责在其他设备上按MSS分段
+    if (((*meta)->flags & NETDEV_TX_GSO_TCPV4) && !netdev_has_feature(dev, NETDEV_F_TSO4)) {
+        return false;
+    }
+    if (((*meta)->flags & NETDEV_TX_CSUM_PARTIAL) && !netdev_has_feature(dev, NETDEV_F_TX_CSUM)) {
+        netdev_sw_checksum(frags, nfrags, *meta);
+        dev->tx_sw_csum++;
+        *meta = NULL;
+    }
+    return true;
+}
+
+static bool netdev_tx_account(struct netdev *dev, bool sent, uint32_t length) {
+    if (!sent) {
+        dev->tx_dropped++;
+        NETSTATS_INC(link, tx_dropped);
+        return false;
+    }
+    dev->tx_packets++;
+    dev->tx_bytes += length;
+    NETSTATS_INC(link, tx_frames);
+    NETSTATS_ADD(link, tx_bytes, length);
+    return true;
+}
+
+bool netdev_xmit_sg(struct netdev *dev, const struct netdev_frag *frags, int nfrags,
+                    const struct netdev_tx_meta *meta) {
+    if (!dev || !dev->ops || !dev->ops->xmit || nfrags <= 0 || nfrags > NETDEV_MAX_FRAGS) {
+        return false;
+    }
+
+    uint32_t length = 0;
+    for (int i = 0; i < nfrags; i++) {
+        length += frags[i].length;
+    }
+    if (length > NETDEV_GSO_MAX_FRAME || !netdev_tx_offload(dev, frags, nfrags, &meta)) {
+        if (capture_enabled) {
+            capture_mark(capture_frame(CAPTURE_DIR_TX, frags, nfrags, length), CAPTURE_DROP_TX_OFFLOAD);
+        }
+        return netdev_tx_account(dev, false, length);
+    }
+
+    // 在交给驱动之前记录，回环设备可能在 xmit 中同步投递接收
+    uint32_t capture_id = capture_enabled ? capture_frame(CAPTURE_DIR_TX, frags, nfrags, length) : 0;
+    TRACE(TRACE_TX_ENQUEUE, length, nfrags, 0);
+    uint64_t netlat_start = netlat_tx_begin();
+    REGION_BEGIN(commit);
+    bool sent = dev->ops->xmit(dev, frags, nfrags, (uint16_t)length, meta);
+    REGION_END(REGION_TX_COMMIT, commit);
+    if (sent) {
+        netlat_tx_end(netlat_start);
+    } else {
+        capture_mark(capture_id, CAPTURE_DROP_TX_DEVICE);
+    }
+    return netdev_tx_account(dev, sent, length);
+}
+
+// 预留发送缓冲区; 驱动不支持时退回到中转缓冲区，提交时再走普通发送
+uint8_t *netdev_tx_reserve(struct netdev *dev, uint16_t length) {
+    if (!dev || !dev->ops || dev->tx_reserved || length > NETDEV_TX_RESERVE_MAX) {
+        return NULL;
+    }
+
+    uint8_t *buffer;
+    if (dev->ops->tx_reserve && dev->ops->tx_commit) {
+        buffer = dev->ops->tx_reserve(dev, length);
+    } else {
+        if (!dev->tx_bounce) {
+            dev->tx_bounce = (uint8_t *)kmalloc(NETDEV_TX_RESERVE_MAX);
+        }
+        buffer = dev->tx_bounce;
+    }
+
+    if (!buffer) {
+        dev->tx_dropped++;
+        NETSTATS_INC(link, tx_dropped);
+        return NULL;
+    }
+    dev->tx_reserved = buffer;
+    return buffer;
+}
+
+bool netdev_tx_commit(struct netdev *dev, uint16_t length, const struct netdev_tx_meta *meta) {
+    if (!dev || !dev->tx_reserved) {
+        return false;
+    }
+
+    struct netdev_frag frag = { dev->tx_reserved, length };
+    dev->tx_reserved = NULL;
+
+    if (length > NETDEV_TX_RESERVE_MAX || !netdev_tx_offload(dev, &frag, 1, &meta)) {
+        if (capture_enabled && length <= NETDEV_TX_RESERVE_MAX) {
+            capture_mark(capture_frame(CAPTURE_DIR_TX, &frag, 1, length), CAPTURE_DROP_TX_OFFLOAD);
+        }
+        return netdev_tx_account(dev, false, length);
+    }
+
+    uint32_t capture_id = capture_enabled ? capture_frame(CAPTURE_DIR_TX, &frag, 1, length) : 0;
+    TRACE(TRACE_TX_ENQUEUE, length, 1, 0);
+    uint64_t netlat_start = netlat_tx_begin();
+    REGION_BEGIN(commit);
+    bool sent;
+    if (frag.data == dev->tx_bounce) {
+        sent = dev->ops->xmit && dev->ops->xmit(dev, &frag, 1, length, meta);
+    } else {
+        sent = dev->ops->tx_commit(dev, length, meta);
+    }
+    REGION_END(REGION_TX_COMMIT, commit);
+    if (sent) {
+        netlat_tx_end(netlat_start);
+    } else {
+        capture_mark(capture_id, CAPTURE_DROP_TX_DEVICE);
+    }
+    return netdev_tx_account(dev, sent, length);
+}
+
+// 放弃预留; 驱动只在提交时推进发送队列，这里无需通知驱动
+void netdev_tx_abort(struct netdev *dev) {
+    if (dev) {
+        dev->tx_reserved = NULL;
+    }
+}
+
+void netdev_tx_drain(struct netdev *dev) {
+    if (dev && dev->ops && dev->ops->tx_drain) {
+        dev->ops->tx_drain(dev);
+    }
+}
+
+// 轮询所有设备的接收，返回本轮交给协议栈的帧数
+uint32_t netdev_poll_all(void) {
+    volatile uint32_t *rx_frames = &netstats_percpu[smp_processor_id()].s.link.rx_frames;
+    uint32_t before = *rx_frames;
+
+    for (struct netdev *dev = netdev_list; dev; dev = dev->next) {
+        if (dev->ops && dev->ops->poll) {
+            dev->ops->poll(dev);
+        }
+    }
+    return *rx_frames - before;
+}
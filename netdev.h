@@ -0,0 +1,118 @@
+#ifndef NETDEV_H
+#define NETDEV_H
+
+#include "types.h"
+
+// 网络设备标志
+#define NETDEV_FLAG_LOOPBACK 0x0001  // 回环设备
+
+// 设备卸载能力
+#define NETDEV_F_TX_CSUM 0x0001  // 设备按 csum_start/csum_offset 补全L4校验和
+#define NETDEV_F_RX_CSUM 0x0002  // 设备已验证接收帧的L4校验和
+#define NETDEV_F_TSO4    0x0004  // TCPv4 分段卸载
+#define NETDEV_F_SG      0x0008  // 聚集DMA: 负载分片按引用发送，不复制
+
+// 发送元数据标志
+#define NETDEV_TX_CSUM_PARTIAL 0x01  // 校验和字段只含伪首部和，需要补全
+#define NETDEV_TX_GSO_TCPV4    0x02  // 超长TCP段，需要按 gso_size 分段
+
+// 单个超长段的最大帧长 (以太网头 + 64KB IP数据报)
+#define NETDEV_GSO_MAX_FRAME 65535
+
+// 预留发送缓冲区的最大帧长
+#define NETDEV_TX_RESERVE_MAX 1536
+
+// 一帧最多的分片数
+#define NETDEV_MAX_FRAGS 8
+
+// 发送分片; 第一个分片通常是协议头，驱动总是立即复制它
+// 其余分片在支持 NETDEV_F_SG 的设备上按引用交给DMA，调用者在 netdev_tx_drain 之前不能修改
+struct netdev_frag {
+    const void *data;
+    uint16_t length;
+};
+
+// 随帧传给驱动的卸载信息
+struct netdev_tx_meta {
+    uint8_t flags;
+    uint16_t csum_start;   // 从帧起始算起的校验范围起点
+    uint16_t csum_offset;  // 校验和字段相对 csum_start 的偏移
+    uint16_t gso_size;     // 每段负载长度 (MSS)
+    uint16_t hdr_len;      // 以太网 + IP + TCP 头总长
+};
+
+struct netdev;
+
+// 驱动操作表
+struct netdev_ops {
+    // 发送一个由分片组成的以太网帧; length 为分片总长
+    // meta 为 NULL 或只包含设备支持的卸载
+    bool (*xmit)(struct netdev *dev, const struct netdev_frag *frags, int nfrags,
+                 uint16_t length, const struct netdev_tx_meta *meta);
+    // 可选: 等待按引用发送的分片全部被设备读取
+    void (*tx_drain)(struct netdev *dev);
+    // 可选: 返回下一个空闲发送缓冲区 (DMA可见)，没有时返回 NULL
+    uint8_t *(*tx_reserve)(struct netdev *dev, uint16_t length);
+    // 与 tx_reserve 成对提供: 发送预留缓冲区中已构造好的 length 字节
+    bool (*tx_commit)(struct netdev *dev, uint16_t length, const struct netdev_tx_meta *meta);
+    // 轮询接收，把收到的帧交给 handle_network_packet
+    void (*poll)(struct netdev *dev);
+};
+
+// 网络设备 (驱动层)，IP配置仍在 net_dev 中
+struct netdev {
+    const char *name;
+    uint8_t mac_addr[6];
+    uint16_t mtu;
+    uint32_t flags;
+    uint32_t features;
+    const struct netdev_ops *ops;
+    void *priv;
+
+    // 基本计数
+    uint32_t tx_packets;
+    uint32_t tx_bytes;
+    uint32_t tx_dropped;
+    uint32_t tx_sw_csum;      // 由软件补全校验和的帧
+
+    // 两阶段发送状态
+    uint8_t *tx_reserved;     // 已预留尚未提交的缓冲区
+    uint8_t *tx_bounce;       // 驱动不支持预留时使用的中转缓冲区
+
+    struct netdev *next;
+};
+
+// 设备注册与查找
+void netdev_register(struct netdev *dev);
+struct netdev *netdev_find(const char *name);
+struct netdev *netdev_get_default(void);
+struct netdev *netdev_get_loopback(void);
+struct netdev *netdev_first(void);
+
+// 按目标IP选择出口设备 (主机字节序)
+struct netdev *netdev_route(uint32_t dst_ip);
+bool ip_is_loopback(uint32_t ip);
+bool ip_is_local(uint32_t ip);
+
+// 发送与轮询
+bool netdev_xmit(struct netdev *dev, uint8_t *frame, uint16_t length);
+// 带卸载信息发送; 设备不支持校验和卸载时在软件中补全
+bool netdev_xmit_meta(struct netdev *dev, uint8_t *frame, uint16_t length,
+                      const struct netdev_tx_meta *meta);
+// 分片发送; 部分校验和字段必须位于可写的第一个分片内
+bool netdev_xmit_sg(struct netdev *dev, const struct netdev_frag *frags, int nfrags,
+                    const struct netdev_tx_meta *meta);
+// 等待引用发送完成，之后调用者可以重用负载缓冲区
+void netdev_tx_drain(struct netdev *dev);
+// 两阶段发送: 预留设备发送缓冲区，在其中构造帧后提交，省去最后一次复制
+// 每个设备同时只能有一个预留; 放弃时调用 netdev_tx_abort
+uint8_t *netdev_tx_reserve(struct netdev *dev, uint16_t length);
+bool netdev_tx_commit(struct netdev *dev, uint16_t length, const struct netdev_tx_meta *meta);
+void netdev_tx_abort(struct netdev *dev);
+uint32_t netdev_poll_all(void);
+
+static inline bool netdev_has_feature(const struct netdev *dev, uint32_t feature) {
+    return dev && (dev->features & feature) == feature;
+}
+
+#endif // NETDEV_H
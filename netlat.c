@@ -0,0 +1,117 @@
+#include "netlat.h"
+#include "tsc.h"
+#include "memory.h"
+#include "kprintf.h"
+#include "serial.h"
+
+struct netlat_cpu netlat_percpu[NR_CPUS];
+
+static const char *const netlat_stage_names[NETLAT_STAGE_COUNT] = {
+    "driver", "demux", "proto", "tx", "total",
+};
+
+const char *netlat_stage_name(uint32_t stage) {
+    return stage < NETLAT_STAGE_COUNT ? netlat_stage_names[stage] : "?";
+}
+
+void netlat_init(void) {
+    memset(netlat_percpu, 0, sizeof(netlat_percpu));
+}
+
+// 只清直方图，不影响正在处理的帧
+void netlat_reset(void) {
+    for (int cpu = 0; cpu < NR_CPUS; cpu++) {
+        for (int i = 0; i < NETLAT_STAGE_COUNT; i++) {
+            hist_reset(&netlat_percpu[cpu].stages[i]);
+        }
+    }
+}
+
+static inline void netlat_record(struct netlat_cpu *c, uint32_t stage, uint64_t cycles) {
+    hist_record(&c->stages[stage], cycles > 0xFFFFFFFF ? 0xFFFFFFFF : (uint32_t)cycles);
+}
+
+void netlat_rx_begin(struct netlat_ctx *outer) {
+    struct netlat_cpu *c = &netlat_percpu[smp_processor_id()];
+    uint64_t now = tsc_read();
+
+    *outer = c->cur;
+    // 没有驱动时间戳的帧从这里开始计时，驱动阶段不记录
+    c->cur.arrival = now;
+    if (c->pending_arrival) {
+        c->cur.arrival = c->pending_arrival;
+        netlat_record(c, NETLAT_DRIVER, now - c->pending_arrival);
+        c->pending_arrival = 0;
+    }
+    c->cur.stage_start = now;
+    c->cur.replied = false;
+}
+
+void netlat_rx_end(const struct netlat_ctx *outer) {
+    netlat_percpu[smp_processor_id()].cur = *outer;
+}
+
+void netlat_rx_deliver(void) {
+    struct netlat_cpu *c = &netlat_percpu[smp_processor_id()];
+    if (!c->cur.arrival) {
+        return;
+    }
+    uint64_t now = tsc_read();
+    netlat_record(c, NETLAT_DEMUX, now - c->cur.stage_start);
+    c->cur.stage_start = now;
+}
+
+uint64_t netlat_tx_begin(void) {
+    struct netlat_cpu *c = &netlat_percpu[smp_processor_id()];
+    if (!c->cur.arrival || c->cur.replied) {
+        return 0;
+    }
+    uint64_t now = tsc_read();
+    netlat_record(c, NETLAT_PROTO, now - c->cur.stage_start);
+    c->cur.replied = true;
+    return now;
+}
+
+void netlat_tx_end(uint64_t start) {
+    if (!start) {
+        return;
+    }
+    struct netlat_cpu *c = &netlat_percpu[smp_processor_id()];
+    uint64_t now = tsc_read();
+    netlat_record(c, NETLAT_TX, now - start);
+    netlat_record(c, NETLAT_TOTAL, now - c->cur.arrival);
+}
+
+void netlat_get_hist(uint32_t stage, struct hist *out) {
+    hist_reset(out);
+    if (stage >= NETLAT_STAGE_COUNT) {
+        return;
+    }
+    for (int cpu = 0; cpu < NR_CPUS; cpu++) {
+        hist_merge(out, &netlat_percpu[cpu].stages[stage]);
+    }
+}
+
+static uint32_t netlat_cycles_to_ns(uint32_t cycles) {
+    uint32_t khz = tsc_khz();
+    return khz ? (uint32_t)div64_u32((uint64_t)cycles * 1000000, khz, NULL) : 0;
+}
+
+void netlat_dump(void) {
+    static struct hist merged;   // 约1KB，不放在栈上
+    char line[96];
+
+    ksnprintf(line, sizeof(line), "%-8s %10s %10s %10s %10s %10s\n",
+              "stage", "count", "p50_ns", "p99_ns", "p999_ns", "max_ns");
+    serial_write_string(line);
+    for (uint32_t i = 0; i < NETLAT_STAGE_COUNT; i++) {
+        netlat_get_hist(i, &merged);
+        ksnprintf(line, sizeof(line), "%-8s %10u %10u %10u %10u %10u\n",
+                  netlat_stage_names[i], merged.count,
+                  netlat_cycles_to_ns(hist_percentile(&merged, 500)),
+                  netlat_cycles_to_ns(hist_percentile(&merged, 990)),
+                  netlat_cycles_to_ns(hist_percentile(&merged, 999)),
+                  netlat_cycles_to_ns(merged.max));
+        serial_write_string(line);
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef NETLAT_H
+#define NETLAT_H
+
+#include "types.h"
+#include "cpu.h"
+#include "hist.h"
+
+// 收包到应答的分段延迟
+// 驱动在发现帧时 (中断或轮询) 记下TSC，随接收处理传到发送提交，
+// 每段的周期数记入本CPU的直方图; 输出时合并各CPU并换算为纳秒
+
+// 阶段编号 (与 netlat_stage_names 对应)
+#define NETLAT_DRIVER 0   // 驱动发现帧 → 进入 handle_network_packet
+#define NETLAT_DEMUX  1   // handle_network_packet → 协议处理入口 (ARP/ICMP/TCP)
+#define NETLAT_PROTO  2   // 协议处理入口 → 应答提交发送
+#define NETLAT_TX     3   // 提交发送 → 驱动接受 (交给网卡)
+#define NETLAT_TOTAL  4   // 驱动发现帧 → 应答交给网卡
+#define NETLAT_STAGE_COUNT 5
+
+// 正在处理的接收帧
+struct netlat_ctx {
+    uint64_t arrival;       // 驱动发现帧的时间，0 表示不在接收处理中
+    uint64_t stage_start;   // 当前阶段的开始时间
+    bool replied;           // 每个接收帧只统计第一个应答
+};
+
+struct netlat_cpu {
+    struct netlat_ctx cur;
+    uint64_t pending_arrival;   // 驱动记下、尚未进入协议栈的帧
+    struct hist stages[NETLAT_STAGE_COUNT];
+} __cacheline_aligned;
+
+extern struct netlat_cpu netlat_percpu[NR_CPUS];
+
+void netlat_init(void);
+void netlat_reset(void);
+
+// 驱动: 下一个交给 handle_network_packet 的帧在 tsc 时被发现
+static inline void netlat_rx_arrival(uint64_t tsc) {
+    netlat_percpu[smp_processor_id()].pending_arrival = tsc;
+}
+
+// handle_network_packet 的入口和出口; 回环投递可能嵌套，外层状态保存在 outer 中
+void netlat_rx_begin(struct netlat_ctx *outer);
+void netlat_rx_end(const struct netlat_ctx *outer);
+// 分发完成，进入协议处理
+void netlat_rx_deliver(void);
+
+// 发送提交的入口 (返回开始时间，不在接收处理中时为 0) 和驱动接受之后
+uint64_t netlat_tx_begin(void);
+void netlat_tx_end(uint64_t start);
+
+const char *netlat_stage_name(uint32_t stage);
+// 合并所有CPU的某一阶段
+void netlat_get_hist(uint32_t stage, struct hist *out);
+// 每阶段一行: 名称、样本数、p50/p99/p999/max (纳秒)
+void netlat_dump(void);
+
+#endif // NETLAT_H
@@ -0,0 +1,120 @@
+#include "netstats.h"
+#include "memory.h"
+#include "kprintf.h"
+#include "serial.h"
+
+struct netstats_cpu netstats_percpu[NR_CPUS];
+
+// 输出用的字段表: 组名、SNMP风格的字段名、在结构中的偏移
+struct netstats_field {
+    const char *group;
+    const char *name;
+    uint16_t offset;
+};
+
+#define NETSTATS_FIELD(group, label, name, field) \
+    { group, name, __builtin_offsetof(struct netstats, label.field) }
+
+static const struct netstats_field netstats_fields[] = {
+    NETSTATS_FIELD("Link", link, "RxFrames", rx_frames),
+    NETSTATS_FIELD("Link", link, "RxBytes", rx_bytes),
+    NETSTATS_FIELD("Link", link, "RxErrors", rx_errors),
+    NETSTATS_FIELD("Link", link, "RxUnknownType", rx_unknown_type),
+    NETSTATS_FIELD("Link", link, "TxFrames", tx_frames),
+    NETSTATS_FIELD("Link", link, "TxBytes", tx_bytes),
+    NETSTATS_FIELD("Link", link, "TxDropped", tx_dropped),
+    NETSTATS_FIELD("Link", link, "TxTimeouts", tx_timeouts),
+    NETSTATS_FIELD("Link", link, "TxAborts", tx_aborts),
+    NETSTATS_FIELD("Arp", arp, "InPackets", in_packets),
+    NETSTATS_FIELD("Arp", arp, "InErrors", in_errors),
+    NETSTATS_FIELD("Arp", arp, "InRequests", in_requests),
+    NETSTATS_FIELD("Arp", arp, "InReplies", in_replies),
+    NETSTATS_FIELD("Arp", arp, "OutRequests", out_requests),
+    NETSTATS_FIELD("Arp", arp, "OutReplies", out_replies),
+    NETSTATS_FIELD("Arp", arp, "CacheHits", cache_hits),
+    NETSTATS_FIELD("Arp", arp, "CacheMisses", cache_misses),
+    NETSTATS_FIELD("Ip", ip, "InReceives", in_receives),
+    NETSTATS_FIELD("Ip", ip, "InHdrErrors", in_hdr_errors),
+    NETSTATS_FIELD("Ip", ip, "InAddrErrors", in_addr_errors),
+    NETSTATS_FIELD("Ip", ip, "InUnknownProtos", in_unknown_protos),
+    NETSTATS_FIELD("Ip", ip, "InDelivers", in_delivers),
+    NETSTATS_FIELD("Ip", ip, "OutRequests", out_requests),
+    NETSTATS_FIELD("Icmp", icmp, "InMsgs", in_msgs),
+    NETSTATS_FIELD("Icmp", icmp, "InEchos", in_echos),
+    NETSTATS_FIELD("Icmp", icmp, "InEchoReps", in_echo_reps),
+    NETSTATS_FIELD("Icmp", icmp, "OutMsgs", out_msgs),
+    NETSTATS_FIELD("Icmp", icmp, "OutErrors", out_errors),
+    NETSTATS_FIELD("Icmp", icmp, "OutEchos", out_echos),
+    NETSTATS_FIELD("Icmp", icmp, "OutEchoReps", out_echo_reps),
+    NETSTATS_FIELD("Udp", udp, "InDatagrams", in_datagrams),
+    NETSTATS_FIELD("Udp", udp, "NoPorts", no_ports),
+    NETSTATS_FIELD("Tcp", tcp, "InSegs", in_segs),
+    NETSTATS_FIELD("Tcp", tcp, "OutSegs", out_segs),
+    NETSTATS_FIELD("Tcp", tcp, "OutErrors", out_errors),
+};
+
+#define NETSTATS_NUM_FIELDS (sizeof(netstats_fields) / sizeof(netstats_fields[0]))
+
+void netstats_init(void) {
+    memset(netstats_percpu, 0, sizeof(netstats_percpu));
+}
+
+// 结构中全是 uint32_t 计数器，按字逐个求和
+void netstats_snapshot(struct netstats *out) {
+    uint32_t *dst = (uint32_t *)out;
+    const uint32_t words = sizeof(struct netstats) / sizeof(uint32_t);
+
+    for (uint32_t i = 0; i < words; i++) {
+        uint32_t sum = 0;
+        for (int cpu = 0; cpu < NR_CPUS; cpu++) {
+            sum += ((volatile const uint32_t *)&netstats_percpu[cpu].s)[i];
+        }
+        dst[i] = sum;
+    }
+}
+
+static bool netstats_same_group(const char *a, const char *b) {
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+static uint32_t netstats_get(const struct netstats *s, const struct netstats_field *f) {
+    return *(const uint32_t *)((const uint8_t *)s + f->offset);
+}
+
+// 每组两行: 字段名和数值
+void netstats_dump(void) {
+    struct netstats s;
+    char buf[24];
+    netstats_snapshot(&s);
+
+    uint32_t start = 0;
+    while (start < NETSTATS_NUM_FIELDS) {
+        const char *group = netstats_fields[start].group;
+        uint32_t end = start;
+        while (end < NETSTATS_NUM_FIELDS && netstats_same_group(netstats_fields[end].group, group)) {
+            end++;
+        }
+
+        serial_write_string(group);
+        serial_write_string(":");
+        for (uint32_t i = start; i < end; i++) {
+            serial_write_string(" ");
+            serial_write_string(netstats_fields[i].name);
+        }
+        serial_write_string("\r\n");
+
+        serial_write_string(group);
+        serial_write_string(":");
+        for (uint32_t i = start; i < end; i++) {
+            ksnprintf(buf, sizeof(buf), " %u", netstats_get(&s, &netstats_fields[i]));
+            serial_write_string(buf);
+        }
+        serial_write_string("\r\n");
+
+        start = end;
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef NETSTATS_H
+#define NETSTATS_H
+
+#include "types.h"
+#include "cpu.h"
+
+// 协议栈计数器，分组和命名参照 /proc/net/snmp
+// 每个CPU一份，只由本CPU (及其中断) 递增; 读取时对所有CPU求和，不加锁
+struct netstats {
+    struct {
+        uint32_t rx_frames;
+        uint32_t rx_bytes;
+        uint32_t rx_errors;         // 网卡报告的坏帧
+        uint32_t rx_unknown_type;   // 不支持的以太网类型
+        uint32_t tx_frames;
+        uint32_t tx_bytes;
+        uint32_t tx_dropped;
+        uint32_t tx_timeouts;       // 发送槽位等待超时
+        uint32_t tx_aborts;         // 硬件中止发送
+    } link;
+    struct {
+        uint32_t in_packets;
+        uint32_t in_errors;         // 过短或格式不对
+        uint32_t in_requests;
+        uint32_t in_replies;
+        uint32_t out_requests;
+        uint32_t out_replies;
+        uint32_t cache_hits;
+        uint32_t cache_misses;
+    } arp;
+    struct {
+        uint32_t in_receives;
+        uint32_t in_hdr_errors;
+        uint32_t in_addr_errors;    // 不是发给本机的
+        uint32_t in_unknown_protos;
+        uint32_t in_delivers;
+        uint32_t out_requests;
+    } ip;
+    struct {
+        uint32_t in_msgs;
+        uint32_t in_echos;
+        uint32_t in_echo_reps;
+        uint32_t out_msgs;
+        uint32_t out_errors;
+        uint32_t out_echos;
+        uint32_t out_echo_reps;
+    } icmp;
+    struct {
+        uint32_t in_datagrams;
+        uint32_t no_ports;
+    } udp;
+    struct {
+        uint32_t in_segs;
+        uint32_t out_segs;
+        uint32_t out_errors;
+    } tcp;
+};
+
+struct netstats_cpu {
+    struct netstats s;
+} __cacheline_aligned;
+
+extern struct netstats_cpu netstats_percpu[NR_CPUS];
+
+// 递增本CPU的计数器，例如 NETSTATS_INC(ip, in_receives)
+#define NETSTATS_ADD(group, field, n) (netstats_percpu[smp_processor_id()].s.group.field += (n))
+#define NETSTATS_INC(group, field) NETSTATS_ADD(group, field, 1)
+
+void netstats_init(void);
+// 所有CPU之和; 各计数器分别读取，整体不是原子快照
+void netstats_snapshot(struct netstats *out);
+// 以 "Ip: InReceives ..." / "Ip: 12 ..." 的格式输出到串口
+void netstats_dump(void);
+
+#endif // NETSTATS_H
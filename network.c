@@ -6,12 +6,24 @@
 #include "memory.h"
 #include "byteorder.h"
 #include "serial.h"
+#include "log.h"
+#include "trace.h"
+#include "netstats.h"
+#include "ping.h"
+#include "tsc.h"
 #include "ipv4.h"
+#include "netdev.h"
+#include "capture.h"
+#include "netlat.h"
+#include "region.h"
 
 // ICMP类型常量
 #define ICMP_TYPE_ECHO_REQUEST  8
 #define ICMP_TYPE_ECHO_REPLY    0
 
+// 演示程序的回显请求标识符
+#define ICMP_DEMO_IDENTIFIER    0x1234
+
 // IP协议类型 (与tcp.h保持一致)
 #define IP_PROTO_ICMP 1
 #define IP_PROTO_UDP  17
@@ -20,8 +32,8 @@
 struct net_device net_dev;
 // 广播MAC地址
 const uint8_t broadcast_mac[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
-// RTL调试输出控制变量，默认禁用调试输出
-bool disable_rtl_debug = true;
+// 演示请求的发送时间，收到应答后清零
+static uint64_t icmp_demo_sent_tsc = 0;
 
 // 函数声明
 void handle_ip_packet(uint8_t *packet, uint16_t length);
@@ -45,6 +57,13 @@ void network_init(void) {
     net_dev.mac_addr[4] = 0x34;
     net_dev.mac_addr[5] = 0x56;
 
+    // 优先使用网卡报告的MAC地址
+    struct netdev *dev = netdev_get_default();
+    if (dev && (dev->mac_addr[0] | dev->mac_addr[1] | dev->mac_addr[2] |
+                dev->mac_addr[3] | dev->mac_addr[4] | dev->mac_addr[5])) {
+        memcpy(net_dev.mac_addr, dev->mac_addr, 6);
+    }
+
     terminal_writestring("Network initialized: IP ");
     print_ip(net_dev.ip_addr);
     terminal_writestring("\n");
@@ -57,24 +76,54 @@ void network_init(void) {
     tcp_init();
 }
 
+// 根据帧内容选择出口设备: IPv4按目标地址路由，其余走默认设备
+static struct netdev *network_select_device(const uint8_t *data, uint16_t length) {
+    const struct eth_header *eth = (const struct eth_header *)data;
+    if (length >= sizeof(struct eth_header) + sizeof(struct ipv4_header) &&
+        ntohs(eth->type) == ETH_TYPE_IP) {
+        const struct ipv4_header *ip = (const struct ipv4_header *)(data + sizeof(struct eth_header));
+        return netdev_route(ntohl(ip->dst_ip));
+    }
+    return netdev_get_default();
+}
+
 // 发送网络数据包
 bool network_send_packet(uint8_t *data, uint16_t length) {
-    // 通过RTL8139驱动发送数据包
-    rtl8139_send_packet(data, length);
-    return true;
+    return network_send_frame(data, length, NULL);
+}
+
+// 带卸载信息发送 (部分校验和等)
+bool network_send_frame(uint8_t *data, uint16_t length, const struct netdev_tx_meta *meta) {
+    return netdev_xmit_meta(network_select_device(data, length), data, length, meta);
+}
+
+// IP标识字段
+static uint16_t ip_next_id = 0;
+
+uint16_t network_next_ip_id(void) {
+    return ip_next_id++;
 }
 
 // 处理接收到的网络数据包
 void handle_network_packet(uint8_t *packet, uint16_t length) {
     struct eth_header *eth = (struct eth_header *)packet;
 
+    TRACE(TRACE_RX_FRAME, length, ntohs(eth->type), 0);
+    NETSTATS_INC(link, rx_frames);
+    NETSTATS_ADD(link, rx_bytes, length);
+
+    uint32_t capture_outer = 0;
+    if (capture_enabled) {
+        capture_outer = capture_rx_begin(packet, length);
+    }
+    struct netlat_ctx netlat_outer;
+    netlat_rx_begin(&netlat_outer);
+
     // 根据以太网帧类型分发到相应的处理函数
     switch (ntohs(eth->type)) {
         case ETH_TYPE_ARP:
-            if (!disable_rtl_debug) {
-                terminal_writestring("Received ARP packet\n");
-                serial_write_string("Received ARP packet\r\n");
-            }
+            LOG_DEBUG(ARP, "packet %u bytes", length);
+            netlat_rx_deliver();
             handle_arp_packet(packet, length);
             break;
         case ETH_TYPE_IP:
@@ -82,110 +131,134 @@ void handle_network_packet(uint8_t *packet, uint16_t length) {
             handle_ip_packet(packet, length);
             break;
         default:
-            if (!disable_rtl_debug) {
-                terminal_writestring("Unsupported ethernet type: 0x");
-                terminal_writehex16(ntohs(eth->type));
-                terminal_writestring("\n");
-                
-                serial_write_string("Unsupported ethernet type: 0x");
-                serial_write_hex16(ntohs(eth->type));
-                serial_write_string("\r\n");
-            }
+            NETSTATS_INC(link, rx_unknown_type);
+            CAPTURE_DROP(CAPTURE_DROP_UNKNOWN_TYPE);
+            LOG_DEBUG(IP, "unsupported ethernet type 0x%04x", ntohs(eth->type));
             break;
     }
+
+    netlat_rx_end(&netlat_outer);
+    if (capture_enabled) {
+        capture_rx_end(capture_outer);
+    }
 }
 
 // 处理IP数据包
 void handle_ip_packet(uint8_t *packet, uint16_t length) {
+    REGION_BEGIN(demux);
+    NETSTATS_INC(ip, in_receives);
     if (length < sizeof(struct eth_header) + sizeof(struct ipv4_header)) {
-        if (!disable_rtl_debug) {
-            terminal_writestring("Packet too short for IP\n");
-        }
+        NETSTATS_INC(ip, in_hdr_errors);
+        CAPTURE_DROP(CAPTURE_DROP_IP_HDR);
+        LOG_DEBUG(IP, "packet too short (%u bytes)", length);
         return;
     }
 
     struct ipv4_header *ip = (struct ipv4_header *)(packet + sizeof(struct eth_header));
     
-    // IP地址字节序检查和调试输出
-    serial_write_string("IP packet - SRC: ");
-    serial_print_ip(ntohl(ip->src_ip));
-    serial_write_string(" DST: ");
-    serial_print_ip(ntohl(ip->dst_ip));
-    serial_write_string("\r\n");
-    
+    LOG_DEBUG(IP, "src " IP_FMT " dst " IP_FMT " proto %u",
+              IP_ARGS(ntohl(ip->src_ip)), IP_ARGS(ntohl(ip->dst_ip)), ip->protocol);
+
     // 比较前转换字节序 - 将网络字节序的ip->dst_ip转换为主机字节序后再比较
     // 或者将主机字节序的net_dev.ip_addr转换为网络字节序后再比较
-    if (ntohl(ip->dst_ip) != net_dev.ip_addr) {
-        if (!disable_rtl_debug) {
-            terminal_writestring("IP packet not for us: ");
-            print_ip(ntohl(ip->dst_ip));
-            terminal_writestring(" vs our IP ");
-            print_ip(net_dev.ip_addr);
-            terminal_writestring("\n");
-        }
-        serial_write_string("IP packet not for us\r\n");
+    if (!ip_is_local(ntohl(ip->dst_ip))) {
+        NETSTATS_INC(ip, in_addr_errors);
+        CAPTURE_DROP(CAPTURE_DROP_IP_ADDR);
+        LOG_DEBUG(IP, "not for us: " IP_FMT " vs " IP_FMT,
+                  IP_ARGS(ntohl(ip->dst_ip)), IP_ARGS(net_dev.ip_addr));
         return;
     }
-    
-    // 数据包是发给我们的，输出确认信息
-    serial_write_string("IP packet is for us, processing...\r\n");
 
     uint8_t protocol = ip->protocol;
-    
-    if (!disable_rtl_debug) {
-        terminal_writestring("IP Protocol: ");
-        terminal_writehex8(protocol);
-        terminal_writestring("\n");
-    }
+    REGION_END(REGION_IP_DEMUX, demux);
 
     switch (protocol) {
         case IP_PROTO_ICMP:
-            // ICMP消息始终处理，无论debug模式如何
-            serial_write_string("Received ICMP packet\r\n");
+            NETSTATS_INC(ip, in_delivers);
+            netlat_rx_deliver();
             handle_icmp_packet(packet, length);
             break;
         case IP_PROTO_TCP:
-            if (!disable_rtl_debug) {
-                terminal_writestring("Received TCP packet\n");
-            }
+            NETSTATS_INC(ip, in_delivers);
+            netlat_rx_deliver();
             handle_tcp_packet(packet, length);
             break;
         case IP_PROTO_UDP:
-            if (!disable_rtl_debug) {
-                terminal_writestring("Received UDP packet (not handled)\n");
-            }
-            // 未实现UDP处理
+            // 未实现UDP处理，没有端口在监听
+            NETSTATS_INC(ip, in_delivers);
+            NETSTATS_INC(udp, no_ports);
+            CAPTURE_DROP(CAPTURE_DROP_NO_PORT);
+            LOG_DEBUG(IP, "UDP packet not handled");
             break;
         default:
-            if (!disable_rtl_debug) {
-                terminal_writestring("Unsupported IP protocol\n");
-            }
+            NETSTATS_INC(ip, in_unknown_protos);
+            CAPTURE_DROP(CAPTURE_DROP_IP_PROTO);
+            LOG_DEBUG(IP, "unsupported protocol %u", protocol);
             break;
     }
 }
 
-// 计算校验和
-uint16_t network_checksum(const uint8_t *data, size_t length) {
-    uint32_t sum = 0;
-
+// 累加校验和 (不折叠、不取反)，用于分段计算
+uint32_t network_checksum_add(const uint8_t *data, size_t length, uint32_t sum) {
+    REGION_BEGIN(csum);
     // 按照2字节为单位进行累加
     const uint16_t *ptr = (const uint16_t *)data;
     while (length > 1) {
         sum += *ptr++;
         length -= 2;
+        // 防止32位累加溢出 (超长段可达64KB)
+        if (sum & 0x80000000) {
+            sum = (sum & 0xffff) + (sum >> 16);
+        }
     }
 
     // 如果长度为奇数，处理最后一个字节
     if (length > 0) {
         sum += *(const uint8_t *)ptr;
     }
+    REGION_END(REGION_CHECKSUM, csum);
+    return sum;
+}
 
-    // 处理进位
+// 处理进位，得到16位的反码和
+uint16_t network_checksum_fold(uint32_t sum) {
     while (sum >> 16) {
         sum = (sum & 0xffff) + (sum >> 16);
     }
+    return sum;
+}
 
-    return ~sum;
+// 计算校验和
+uint16_t network_checksum(const uint8_t *data, size_t length) {
+    return ~network_checksum_fold(network_checksum_add(data, length, 0));
+}
+
+// TCP/UDP伪首部的累加和，地址为网络字节序，length为主机字节序
+uint32_t network_pseudo_header_sum(uint32_t src_ip, uint32_t dst_ip, uint8_t protocol, uint16_t length) {
+    uint32_t sum = 0;
+    sum += src_ip & 0xFFFF;
+    sum += src_ip >> 16;
+    sum += dst_ip & 0xFFFF;
+    sum += dst_ip >> 16;
+    sum += htons(protocol);
+    sum += htons(length);
+    return sum;
+}
+
+// 填写20字节的IPv4头并计算头部校验和; 地址为主机字节序
+void ipv4_build_header(struct ipv4_header *ip, uint8_t protocol, uint32_t src_ip, uint32_t dst_ip,
+                       uint16_t payload_length, uint16_t id, uint16_t flags_fragment) {
+    ip->version_ihl = 0x45;  // 版本4，头部长度5个双字
+    ip->dscp_ecn = 0;
+    ip->total_length = htons(sizeof(struct ipv4_header) + payload_length);
+    ip->identification = htons(id);
+    ip->flags_fragment_offset = htons(flags_fragment);
+    ip->ttl = 64;
+    ip->protocol = protocol;
+    ip->src_ip = htonl(src_ip);
+    ip->dst_ip = htonl(dst_ip);
+    ip->checksum = 0;
+    ip->checksum = network_checksum((uint8_t *)ip, sizeof(struct ipv4_header));
 }
 
 // 获取目标MAC地址
@@ -220,160 +293,73 @@ void handle_icmp_packet(uint8_t *packet, uint16_t length) {
     struct ipv4_header *ip_header = (struct ipv4_header *)(packet + sizeof(struct eth_header));
     struct icmp_header *icmp_header = (struct icmp_header *)(packet + sizeof(struct eth_header) + sizeof(struct ipv4_header));
 
-    // Force debug message for all ICMP packets - critical to debug output
-    serial_write_string("\r\n!!! ICMP PACKET !!!\r\n");
-    serial_write_string("Type: ");
-    serial_write_dec(icmp_header->type);
-    if (icmp_header->type == ICMP_TYPE_ECHO_REQUEST) {
-        serial_write_string(" (ECHO REQUEST)");
-    } else if (icmp_header->type == ICMP_TYPE_ECHO_REPLY) {
-        serial_write_string(" (ECHO REPLY)");
+    // Truncated ICMP header: the reply path copies all three headers from the request
+    if (length < sizeof(struct eth_header) + sizeof(struct ipv4_header) + sizeof(struct icmp_header)) {
+        NETSTATS_INC(ip, in_hdr_errors);
+        LOG_DEBUG(ICMP, "packet too short (%u bytes)", length);
+        return;
     }
-    
-    serial_write_string(" Code: ");
-    serial_write_dec(icmp_header->code);
-    serial_write_string("\r\nFrom IP: ");
-    serial_print_ip(ntohl(ip_header->src_ip));
-    serial_write_string("\r\n");
-    
+
+    TRACE(TRACE_ICMP_RX, icmp_header->type, ntohl(ip_header->src_ip), 0);
+    NETSTATS_INC(icmp, in_msgs);
+    LOG_DEBUG(ICMP, "type %u code %u from " IP_FMT, icmp_header->type, icmp_header->code,
+              IP_ARGS(ntohl(ip_header->src_ip)));
+
     // Dump the ICMP payload
     uint8_t *data = packet + sizeof(struct eth_header) + sizeof(struct ipv4_header) + sizeof(struct icmp_header);
     uint16_t data_length = length - sizeof(struct eth_header) - sizeof(struct ipv4_header) - sizeof(struct icmp_header);
-    
-    serial_write_string("Data (");
-    serial_write_dec(data_length);
-    serial_write_string(" bytes): ");
-    
-    for (uint16_t i = 0; i < data_length && i < 16; i++) {
-        serial_write_hex8(data[i]);
-        serial_write_string(" ");
-    }
-    
-    serial_write_string("\r\nASCII: ");
-    for (uint16_t i = 0; i < data_length && i < 16; i++) {
-        if (data[i] >= 32 && data[i] <= 126) {
-            char c = data[i];
-            serial_write_string(&c);
-        } else {
-            serial_write_string(".");
-        }
-    }
-    serial_write_string("\r\n");
+    LOG_HEX(ICMP, KLOG_DEBUG, "data", data, data_length < 16 ? data_length : 16);
 
     // Check for echo request
     if (icmp_header->type == ICMP_TYPE_ECHO_REQUEST && icmp_header->code == 0) {
-        terminal_clear();  // Clear screen for better message display
-        terminal_writestring("\n\n");
-        terminal_writestring("=== PING RECEIVED ===\n");
-        terminal_writestring("Received PING request from IP: ");
-        print_ip(ntohl(ip_header->src_ip));
-        terminal_writestring("\n\n");
-        terminal_writestring("Preparing to send ICMP reply with 'hello,world'...\n");
-
-        // Also output to serial port
-        serial_write_string("\r\n=== PING RECEIVED ===\r\n");
-        serial_write_string("Received PING request from IP: ");
-        serial_print_ip(ntohl(ip_header->src_ip));
-        serial_write_string("\r\n");
-        
+        NETSTATS_INC(icmp, in_echos);
+        LOG_INFO(ICMP, "echo request from " IP_FMT, IP_ARGS(ntohl(ip_header->src_ip)));
+
         // Send ICMP Echo reply
         send_icmp_echo_reply(icmp_header, packet, length, ip_header);
     } 
     // Check for echo reply - display content of received ping reply
     else if (icmp_header->type == ICMP_TYPE_ECHO_REPLY && icmp_header->code == 0) {
-        // Get the data portion of the ICMP packet
-        
-        // 总是输出这个关键信息，无论debug模式是否开启
-        serial_write_string("\r\n!!! ICMP ECHO REPLY RECEIVED !!!\r\n");
-        serial_write_string("From IP: ");
-        serial_print_ip(ntohl(ip_header->src_ip));
-        serial_write_string("\r\n");
-        
-        // Clear part of the screen but leave the ping history
-        terminal_writestring("\n");
-        terminal_writestring("=======================================\n");
-        terminal_writestring("🔔 PING REPLY RECEIVED FROM HOST 🔔\n");
-        terminal_writestring("=======================================\n");
-        terminal_writestring("From IP: ");
-        print_ip(ntohl(ip_header->src_ip));
-        terminal_writestring("\n\n");
-        
-        // 强调这是收到的回复
-        terminal_writestring("✓ Successfully received ICMP echo reply!\n\n");
-        
-        terminal_writestring("Message content: \"");
-        // Display the data content (assuming printable ASCII)
-        for (uint16_t i = 0; i < data_length; i++) {
-            if (data[i] >= 32 && data[i] <= 126) { // Printable ASCII
-                terminal_putchar(data[i]);
-                // 发送到串口也显示
-                char c = data[i];
-                serial_write_string(&c);
-            } else if (data[i] == 0) {
-                // End of string
-                break;
-            } else {
-                terminal_writestring(".");
-                serial_write_string(".");
-            }
+        NETSTATS_INC(icmp, in_echo_reps);
+
+        // Replies to console pings are matched by identifier and not shown on screen
+        if (ping_handle_reply(ntohl(ip_header->src_ip), ntohs(icmp_header->identifier),
+                              ntohs(icmp_header->sequence))) {
+            return;
         }
-        terminal_writestring("\"\n\n");
-        serial_write_string("\"\r\n");
-        
-        terminal_writestring("Hex representation: ");
-        serial_write_string("Hex data: ");
-        for (uint16_t i = 0; i < data_length && i < 32; i++) {
-            terminal_writehex8(data[i]);
-            terminal_writestring(" ");
-            serial_write_hex8(data[i]);
-            serial_write_string(" ");
-            if (i % 8 == 7) {
-                terminal_writestring("\n                    ");
-                serial_write_string("\r\n                    ");
-            }
+        // Replies to the demo request feed the RTT histogram shown on the dashboard
+        if (ntohs(icmp_header->identifier) == ICMP_DEMO_IDENTIFIER && icmp_demo_sent_tsc) {
+            ping_record_rtt((uint32_t)tsc_to_us(tsc_read() - icmp_demo_sent_tsc));
+            icmp_demo_sent_tsc = 0;
         }
-        
-        terminal_writestring("\n\n");
-        terminal_writestring("Waiting for next ping reply...\n");
-        terminal_writestring("=======================================\n");
-
-        // Serial logging for ICMP echo reply
-        serial_write_string("\r\n=== PING REPLY RECEIVED ===\r\n");
-        serial_write_string("From IP: ");
-        serial_print_ip(ntohl(ip_header->src_ip));
-        serial_write_string("\r\nData: \"");
-        for (uint16_t i = 0; i < data_length; i++) {
-            if (data[i] >= 32 && data[i] <= 126) { // Printable ASCII
-                char c = data[i];
-                serial_write_string(&c);
-            } else if (data[i] == 0) {
+
+        // Serial logging for ICMP echo reply (printable part of the payload)
+        char text[33];
+        uint16_t text_len = 0;
+        for (uint16_t i = 0; i < data_length && text_len < sizeof(text) - 1; i++) {
+            if (data[i] == 0) {
                 break;
-            } else {
-                serial_write_string(".");
             }
+            text[text_len++] = (data[i] >= 32 && data[i] <= 126) ? data[i] : '.';
         }
-        serial_write_string("\"\r\n=========================\r\n");
+        text[text_len] = '\0';
+        LOG_INFO(ICMP, "echo reply from " IP_FMT " data \"%s\"",
+                 IP_ARGS(ntohl(ip_header->src_ip)), text);
     }
 }
 
-// Send ICMP Echo reply
-void send_icmp_echo_reply(struct icmp_header *request, uint8_t *packet, uint16_t length, struct ipv4_header *ip_header) {
-    // Allocate send buffer
-    uint8_t buffer[ETH_MTU];
-    memcpy(buffer, packet, length);
+// Build an Echo reply to the request frame in buffer; only the headers are taken from the request.
+// The ICMP checksum is left zero for the device (or netdev) to complete. Returns the frame length.
+uint16_t icmp_build_echo_reply(uint8_t *buffer, const uint8_t *request) {
+    uint16_t data_offset = sizeof(struct eth_header) + sizeof(struct ipv4_header) + sizeof(struct icmp_header);
+    uint16_t hello_len = ICMP_REPLY_DATA_LEN;
+    memcpy(buffer, request, data_offset);
 
     // Get ethernet header and IP header pointers
     struct eth_header *eth = (struct eth_header *)buffer;
     struct ipv4_header *ip = (struct ipv4_header *)(buffer + sizeof(struct eth_header));
     struct icmp_header *icmp = (struct icmp_header *)(buffer + sizeof(struct eth_header) + sizeof(struct ipv4_header));
 
-    // Log the original IPs for debugging
-    serial_write_string("Original IPs - Src: ");
-    serial_print_ip(ntohl(ip->src_ip));
-    serial_write_string(" Dst: ");
-    serial_print_ip(ntohl(ip->dst_ip));
-    serial_write_string("\r\n");
-
     // Swap MAC addresses
     uint8_t temp_mac[6];
     memcpy(temp_mac, eth->dest_mac, 6);
@@ -385,13 +371,6 @@ void send_icmp_echo_reply(struct icmp_header *request, uint8_t *packet, uint16_t
     ip->dst_ip = ip->src_ip;
     ip->src_ip = temp_ip;
 
-    // Log the swapped IPs for debugging
-    serial_write_string("Swapped IPs - Src: ");
-    serial_print_ip(ntohl(ip->src_ip));
-    serial_write_string(" Dst: ");
-    serial_print_ip(ntohl(ip->dst_ip));
-    serial_write_string("\r\n");
-
     // Modify ICMP packet to Echo reply
     icmp->type = ICMP_TYPE_ECHO_REPLY;
     icmp->code = 0;
@@ -399,73 +378,79 @@ void send_icmp_echo_reply(struct icmp_header *request, uint8_t *packet, uint16_t
     
     // Add "hello,world" to ICMP reply data
     char *hello_msg = "hello,world";
-    uint16_t hello_len = 12; // Including null terminator
-    uint16_t data_offset = sizeof(struct eth_header) + sizeof(struct ipv4_header) + sizeof(struct icmp_header);
-    
     memcpy(buffer + data_offset, hello_msg, hello_len);
     
     // Update IP total length
     uint16_t total_length = sizeof(struct ipv4_header) + sizeof(struct icmp_header) + hello_len;
     ip->total_length = htons(total_length);
-    
-    // Calculate ICMP length and recompute checksum
-    uint16_t icmp_len = sizeof(struct icmp_header) + hello_len;
-    icmp->checksum = network_checksum((uint8_t *)icmp, icmp_len);
 
     // Recompute IP header checksum
     ip->checksum = 0;
     ip->checksum = network_checksum((uint8_t *)ip, sizeof(struct ipv4_header));
+    return data_offset + hello_len;
+}
+
+// Send ICMP Echo reply
+void send_icmp_echo_reply(struct icmp_header *request, uint8_t *packet, uint16_t length, struct ipv4_header *ip_header) {
+    uint16_t packet_length = ICMP_REPLY_FRAME_LEN;
+    (void)request;
+    (void)length;
+
+    // Build the reply directly in the device TX buffer
+    struct netdev *dev = netdev_route(ntohl(ip_header->src_ip));
+    uint8_t *buffer = netdev_tx_reserve(dev, packet_length);
+    if (!buffer) {
+        NETSTATS_INC(icmp, out_errors);
+        LOG_WARN(ICMP, "no TX buffer available for reply");
+        return;
+    }
+    icmp_build_echo_reply(buffer, packet);
+    struct ipv4_header *ip = (struct ipv4_header *)(buffer + sizeof(struct eth_header));
+
+    // ICMP checksum is left to the device (or completed in software by netdev)
+    struct netdev_tx_meta meta = {
+        .flags = NETDEV_TX_CSUM_PARTIAL,
+        .csum_start = sizeof(struct eth_header) + sizeof(struct ipv4_header),
+        .csum_offset = 2,
+    };
 
-    uint16_t packet_length = sizeof(struct eth_header) + ntohs(ip->total_length);
-    
-    // Log to serial
-    serial_write_string("\r\n=== SENDING ICMP ECHO REPLY ===\r\n");
-    serial_write_string("To IP: ");
-    serial_print_ip(ntohl(ip->dst_ip));
-    serial_write_string("\r\nWith data: \"hello,world\"\r\n");
-    
     // Send Echo reply
-    network_send_packet(buffer, packet_length);
-    
-    // Display success message
-    terminal_writestring("\n✓ Successfully sent ICMP reply with 'hello,world'\n");
-    terminal_writestring("\nTo IP address: ");
-    print_ip(ntohl(ip->dst_ip));
-    terminal_writestring("\n\n");
-    terminal_writestring("=== Waiting for next PING request ===\n");
-    
-    serial_write_string("\r\n✓ Successfully sent ICMP reply with 'hello,world'\r\n");
-    serial_write_string("\r\nTo IP address: ");
-    serial_print_ip(ntohl(ip->dst_ip));
-    serial_write_string("\r\n\r\n");
+    NETSTATS_INC(ip, out_requests);
+    NETSTATS_INC(icmp, out_msgs);
+    if (!netdev_tx_commit(dev, packet_length, &meta)) {
+        NETSTATS_INC(icmp, out_errors);
+        LOG_WARN(ICMP, "echo reply to " IP_FMT " dropped", IP_ARGS(ntohl(ip->dst_ip)));
+        return;
+    }
+    TRACE(TRACE_ICMP_TX, ICMP_TYPE_ECHO_REPLY, ntohl(ip->dst_ip), 0);
+    NETSTATS_INC(icmp, out_echo_reps);
+    LOG_INFO(ICMP, "echo reply sent to " IP_FMT, IP_ARGS(ntohl(ip->dst_ip)));
 }
 
-// Send ICMP Echo request with "hello,world" data
-void send_icmp_echo_request(uint32_t target_ip) {
-    // Log to serial port
-    serial_write_string("\r\n=== SENDING ICMP ECHO REQUEST ===\r\n");
-    serial_write_string("Target IP: ");
-    serial_print_ip(target_ip);  // 正确：直接使用主机字节序打印
-    serial_write_string("\r\n");
-
+// Send an ICMP Echo request carrying "hello,world"; no screen output
+bool icmp_send_echo(uint32_t target_ip, uint16_t identifier, uint16_t sequence) {
     // First make sure we have the MAC address for the target IP
     uint8_t target_mac[6];
     if (!get_destination_mac(target_ip, target_mac)) {
-        terminal_writestring("Failed to get MAC address for target IP\n");
-        serial_write_string("Failed to get MAC address for target IP\r\n");
-        return;
+        NETSTATS_INC(icmp, out_errors);
+        LOG_WARN(ICMP, "no MAC address for " IP_FMT, IP_ARGS(target_ip));
+        return false;
     }
     
-    serial_write_string("Target MAC: ");
-    for (int i = 0; i < 6; i++) {
-        serial_write_hex8(target_mac[i]);
-        if (i < 5) serial_write_string(":");
+    // Build the request directly in the device TX buffer
+    char *hello_msg = "hello,world";
+    uint16_t hello_len = 12;  // Including null terminator
+    uint16_t data_offset = sizeof(struct eth_header) + sizeof(struct ipv4_header) + sizeof(struct icmp_header);
+    uint16_t packet_length = data_offset + hello_len;
+
+    struct netdev *dev = netdev_route(target_ip);
+    uint8_t *buffer = netdev_tx_reserve(dev, packet_length);
+    if (!buffer) {
+        NETSTATS_INC(icmp, out_errors);
+        LOG_WARN(ICMP, "no TX buffer available");
+        return false;
     }
-    serial_write_string("\r\n");
-    
-    // Create a buffer for the ICMP echo request packet
-    uint8_t buffer[ETH_MTU];
-    memset(buffer, 0, ETH_MTU);
+    memset(buffer, 0, packet_length);
     
     // Set up ethernet header
     struct eth_header *eth = (struct eth_header *)buffer;
@@ -475,66 +460,49 @@ void send_icmp_echo_request(uint32_t target_ip) {
     
     // Set up IP header
     struct ipv4_header *ip = (struct ipv4_header *)(buffer + sizeof(struct eth_header));
-    ip->version_ihl = 0x45;  // Version 4, header length 5 DWORDs
-    ip->dscp_ecn = 0;
-    ip->identification = 0;
-    ip->flags_fragment_offset = 0;
-    ip->ttl = 64;
-    ip->protocol = IP_PROTO_ICMP;
-    ip->src_ip = htonl(net_dev.ip_addr);  // 必须转换为网络字节序
-    ip->dst_ip = htonl(target_ip);        // 必须转换为网络字节序
     
     // Set up ICMP header
     struct icmp_header *icmp = (struct icmp_header *)(buffer + sizeof(struct eth_header) + sizeof(struct ipv4_header));
     icmp->type = ICMP_TYPE_ECHO_REQUEST;
     icmp->code = 0;
-    icmp->identifier = htons(0x1234);  // Some identifier
-    icmp->sequence = htons(0x0001);    // Sequence number
+    icmp->identifier = htons(identifier);
+    icmp->sequence = htons(sequence);
     
     // Add "hello,world" data
-    char *hello_msg = "hello,world";
-    uint16_t hello_len = 12;  // Including null terminator
-    uint16_t data_offset = sizeof(struct eth_header) + sizeof(struct ipv4_header) + sizeof(struct icmp_header);
     memcpy(buffer + data_offset, hello_msg, hello_len);
     
-    // Calculate total length for IP header
-    uint16_t total_length = sizeof(struct ipv4_header) + sizeof(struct icmp_header) + hello_len;
-    ip->total_length = htons(total_length);
-    
-    // Calculate checksums
-    ip->checksum = 0;
-    ip->checksum = network_checksum((uint8_t *)ip, sizeof(struct ipv4_header));
+    // IP header with its checksum
+    ipv4_build_header(ip, IP_PROTO_ICMP, net_dev.ip_addr, target_ip,
+                      sizeof(struct icmp_header) + hello_len, 0, 0);
     
+    // ICMP has no pseudo header, so the partial checksum seed is zero
     icmp->checksum = 0;
-    icmp->checksum = network_checksum((uint8_t *)icmp, sizeof(struct icmp_header) + hello_len);
-    
-    // Total packet length
-    uint16_t packet_length = sizeof(struct eth_header) + total_length;
-    
-    // Log packet details to serial
-    serial_write_string("Packet length: ");
-    serial_write_dec(packet_length);
-    serial_write_string(" bytes\r\n");
-    serial_write_string("Data: \"hello,world\"\r\n");
-    
-    // Clear screen and display status
-    terminal_clear();
-    terminal_writestring("\n\n");
-    terminal_writestring("======================================\n");
-    terminal_writestring("     MiniOS Hello World Network Demo     \n");
-    terminal_writestring("======================================\n\n");
-    
-    terminal_writestring("Sending PING with 'hello,world' to: ");
-    print_ip(target_ip);  // 使用更新后的print_ip函数，显示正确的字节序
-    terminal_writestring("\n\n");
+    struct netdev_tx_meta meta = {
+        .flags = NETDEV_TX_CSUM_PARTIAL,
+        .csum_start = sizeof(struct eth_header) + sizeof(struct ipv4_header),
+        .csum_offset = 2,
+    };
     
     // Send the packet
-    network_send_packet(buffer, packet_length);
-    
-    serial_write_string("ICMP Echo Request sent!\r\n");
+    NETSTATS_INC(ip, out_requests);
+    NETSTATS_INC(icmp, out_msgs);
+    if (!netdev_tx_commit(dev, packet_length, &meta)) {
+        NETSTATS_INC(icmp, out_errors);
+        return false;
+    }
+    NETSTATS_INC(icmp, out_echos);
+    TRACE(TRACE_ICMP_TX, ICMP_TYPE_ECHO_REQUEST, target_ip, 0);
     
-    terminal_writestring("✓ PING sent successfully!\n");
-    terminal_writestring("Waiting for replies...\n\n");
-    terminal_writestring("Any received replies will be shown below:\n");
-    terminal_writestring("======================================\n");
+    LOG_INFO(ICMP, "echo request to " IP_FMT " (" MAC_FMT ") id %u seq %u",
+             IP_ARGS(target_ip), MAC_ARGS(target_mac), identifier, sequence);
+    return true;
+}
+
+// Send the demo ICMP Echo request with "hello,world" data; the reply's RTT is recorded
+void send_icmp_echo_request(uint32_t target_ip) {
+    icmp_demo_sent_tsc = tsc_read();
+    if (!icmp_send_echo(target_ip, ICMP_DEMO_IDENTIFIER, 1)) {
+        icmp_demo_sent_tsc = 0;
+        LOG_WARN(ICMP, "demo echo request to " IP_FMT " failed", IP_ARGS(target_ip));
+    }
 }
@@ -28,22 +28,43 @@ struct net_device {
 };
 
 extern struct net_device net_dev;
+
+// 日志中打印地址 (主机字节序IP)
+#define IP_FMT "%u.%u.%u.%u"
+#define IP_ARGS(ip) (uint32_t)(((ip) >> 24) & 0xFF), (uint32_t)(((ip) >> 16) & 0xFF), \
+                    (uint32_t)(((ip) >> 8) & 0xFF), (uint32_t)((ip) & 0xFF)
+#define MAC_FMT "%02x:%02x:%02x:%02x:%02x:%02x"
+#define MAC_ARGS(mac) (mac)[0], (mac)[1], (mac)[2], (mac)[3], (mac)[4], (mac)[5]
 extern const uint8_t broadcast_mac[6];
 
 // 函数声明
 void network_init(void);
 bool network_send_packet(uint8_t *data, uint16_t length);
+struct netdev_tx_meta;
+bool network_send_frame(uint8_t *data, uint16_t length, const struct netdev_tx_meta *meta);
 void handle_network_packet(uint8_t *packet, uint16_t length);
 void handle_ip_packet(uint8_t *packet, uint16_t length);
 void handle_icmp_packet(uint8_t *packet, uint16_t length);
+// 回显应答: 以太网/IP/ICMP头 + "hello,world\0"
+#define ICMP_REPLY_DATA_LEN  12
+#define ICMP_REPLY_FRAME_LEN (sizeof(struct eth_header) + sizeof(struct ipv4_header) + \
+                              sizeof(struct icmp_header) + ICMP_REPLY_DATA_LEN)
+// 在 buffer 中按请求帧构造应答 (ICMP校验和留给设备)，返回帧长
+uint16_t icmp_build_echo_reply(uint8_t *buffer, const uint8_t *request);
 void send_icmp_echo_reply(struct icmp_header *request, uint8_t *packet, uint16_t length, struct ipv4_header *ip_header);
 void send_icmp_echo_request(uint32_t target_ip);
+// 发送一个回显请求 (无屏幕输出)，identifier/sequence 为主机字节序
+bool icmp_send_echo(uint32_t target_ip, uint16_t identifier, uint16_t sequence);
 void print_ip(uint32_t ip);
 void print_mac(uint8_t *mac);
 uint16_t network_checksum(const uint8_t *data, size_t length);
+uint32_t network_checksum_add(const uint8_t *data, size_t length, uint32_t sum);
+uint16_t network_checksum_fold(uint32_t sum);
+uint32_t network_pseudo_header_sum(uint32_t src_ip, uint32_t dst_ip, uint8_t protocol, uint16_t length);
+uint16_t network_next_ip_id(void);
+// 填写IPv4头 (无选项) 和头部校验和; 地址、长度、标识和标志/分片偏移均为主机字节序
+void ipv4_build_header(struct ipv4_header *ip, uint8_t protocol, uint32_t src_ip, uint32_t dst_ip,
+                       uint16_t payload_length, uint16_t id, uint16_t flags_fragment);
 bool get_destination_mac(uint32_t ip_addr, uint8_t *mac_out);
 
-// 网络调试开关
-extern bool disable_rtl_debug;
-
 #endif // NETWORK_H
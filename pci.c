@@ -1,11 +1,19 @@
 #include "pci.h"
 #include "io.h"
 #include "terminal.h"
-#include "rtl8139.h"
+#include "kprintf.h"
+#include "serial.h"
 
 #define PCI_CONFIG_ADDRESS 0xCF8
 #define PCI_CONFIG_DATA    0xCFC
 
+// 能力链表最多跟随的项数 (防止损坏的链表成环)
+#define PCI_CAP_WALK_LIMIT 48
+
+static struct pci_dev pci_devices[PCI_MAX_DEVICES];
+static uint32_t pci_num_devices;
+static struct pci_driver *pci_drivers;
+
 // 生成PCI配置地址
 static uint32_t pci_get_address(uint8_t bus, uint8_t slot, uint8_t func, uint8_t offset) {
     return (uint32_t)((bus << 16) | (slot << 11) | (func << 8) | (offset & 0xFC) | 0x80000000);
@@ -39,46 +47,105 @@ void pci_config_write_dword(uint8_t bus, uint8_t slot, uint8_t func, uint8_t off
     outl(PCI_CONFIG_DATA, value);
 }
 
-// 检查设备是否存在
-static bool pci_device_exists(uint8_t bus, uint8_t slot, uint8_t func) {
-    uint16_t vendor = pci_config_read_word(bus, slot, func, PCI_VENDOR_ID);
-    return vendor != 0xFFFF;
+// 确定一个BAR的类型、基址和大小，返回占用的BAR寄存器数 (64位BAR为2)
+// 调用者已关闭I/O和内存译码，写全1探测大小期间设备不会响应错误的地址
+static uint8_t pci_probe_bar(struct pci_dev *dev, uint8_t index) {
+    uint8_t offset = PCI_BAR0 + index * 4;
+    struct pci_bar *bar = &dev->bars[index];
+    uint32_t orig = pci_read_dword(dev, offset);
+
+    pci_write_dword(dev, offset, 0xFFFFFFFF);
+    uint32_t mask = pci_read_dword(dev, offset);
+    pci_write_dword(dev, offset, orig);
+
+    if (orig & 1) {
+        bar->flags = PCI_BAR_IO;
+        bar->base = orig & ~3u;
+        // 有的设备高16位读回0，大小只看低16位
+        bar->size = mask ? (uint16_t)(~(mask & ~3u) + 1) : 0;
+        return 1;
+    }
+
+    bar->flags = (orig & 0x08) ? PCI_BAR_PREFETCH : 0;
+    bar->base = orig & ~0xFu;
+    uint64_t size_mask = 0xFFFFFFFF00000000ULL | (mask & ~0xFu);
+    uint8_t used = 1;
+    if ((orig & 0x06) == 0x04 && index + 1 < PCI_MAX_BARS) {
+        uint32_t orig_hi = pci_read_dword(dev, offset + 4);
+        pci_write_dword(dev, offset + 4, 0xFFFFFFFF);
+        uint32_t mask_hi = pci_read_dword(dev, offset + 4);
+        pci_write_dword(dev, offset + 4, orig_hi);
+        bar->flags |= PCI_BAR_MEM64;
+        bar->base |= (uint64_t)orig_hi << 32;
+        size_mask = ((uint64_t)mask_hi << 32) | (mask & ~0xFu);
+        used = 2;
+    }
+    bar->size = (mask & ~0xFu) || used == 2 ? ~size_mask + 1 : 0;
+    return used;
 }
 
-// 获取设备类型信息
-static void pci_get_device_info(uint8_t bus, uint8_t slot, uint8_t func) {
-    uint16_t vendor = pci_config_read_word(bus, slot, func, PCI_VENDOR_ID);
-    uint16_t device = pci_config_read_word(bus, slot, func, PCI_DEVICE_ID);
-    uint8_t class_code = pci_config_read_word(bus, slot, func, PCI_CLASS) & 0xFF;
-    uint8_t subclass = pci_config_read_word(bus, slot, func, PCI_SUBCLASS) & 0xFF;
-    
-    terminal_writestring("Found device at ");
-    terminal_writestring("Bus: ");
-    print_hex(bus);
-    terminal_writestring(" Slot: ");
-    print_hex(slot);
-    terminal_writestring(" Function: ");
-    print_hex(func);
-    terminal_writestring("\n");
-    
-    terminal_writestring("Vendor ID: ");
-    print_hex(vendor);
-    terminal_writestring(" Device ID: ");
-    print_hex(device);
-    terminal_writestring("\n");
-    
-    terminal_writestring("Class: ");
-    print_hex(class_code);
-    terminal_writestring(" Subclass: ");
-    print_hex(subclass);
-    terminal_writestring("\n");
-    
-    if(vendor == RTL8139_VENDOR_ID && device == RTL8139_DEVICE_ID) {
-        terminal_writestring("*** RTL8139 Network Card Found! ***\n");
+static void pci_probe_bars(struct pci_dev *dev) {
+    uint8_t count = dev->header_type == 0 ? 6 : dev->header_type == 1 ? 2 : 0;
+    if (!count) {
+        return;
+    }
+    uint16_t command = pci_read_word(dev, PCI_COMMAND);
+    pci_write_word(dev, PCI_COMMAND, command & ~(PCI_COMMAND_IO | PCI_COMMAND_MEMORY));
+    for (uint8_t i = 0; i < count; ) {
+        i += pci_probe_bar(dev, i);
     }
+    pci_write_word(dev, PCI_COMMAND, command);
 }
 
-// 初始化PCI总线
+// 能力项按双字对齐，一次读出ID和下一项指针
+static void pci_probe_caps(struct pci_dev *dev) {
+    if (dev->header_type > 1 || !(pci_read_word(dev, PCI_STATUS) & PCI_STATUS_CAP_LIST)) {
+        return;
+    }
+    uint8_t ptr = pci_read_word(dev, PCI_CAPABILITIES) & 0xFC;
+    for (uint32_t n = 0; ptr >= 0x40 && n < PCI_CAP_WALK_LIMIT; n++) {
+        uint32_t header = pci_read_dword(dev, ptr);
+        if (dev->num_caps < PCI_MAX_CAPS) {
+            dev->caps[dev->num_caps].id = header & 0xFF;
+            dev->caps[dev->num_caps].offset = ptr;
+            dev->num_caps++;
+        }
+        ptr = (header >> 8) & 0xFC;
+    }
+}
+
+// 把一个功能加入设备表 (每个设备一行输出; 屏幕输出在启动时间中占比不小)
+static void pci_add_device(uint8_t bus, uint8_t slot, uint8_t func, uint32_t id) {
+    if (pci_num_devices == PCI_MAX_DEVICES) {
+        terminal_writestring("PCI: device table full\n");
+        return;
+    }
+    struct pci_dev *dev = &pci_devices[pci_num_devices++];
+    dev->bus = bus;
+    dev->slot = slot;
+    dev->func = func;
+    dev->vendor_id = id & 0xFFFF;
+    dev->device_id = id >> 16;
+
+    uint32_t class_rev = pci_read_dword(dev, PCI_REVISION_ID);
+    dev->class_code = class_rev >> 24;
+    dev->subclass = (class_rev >> 16) & 0xFF;
+    dev->prog_if = (class_rev >> 8) & 0xFF;
+    dev->revision = class_rev & 0xFF;
+    dev->header_type = (pci_read_dword(dev, PCI_CACHE_LINE) >> 16) & 0x7F;
+    uint16_t irq = pci_read_word(dev, PCI_INTERRUPT_LINE);
+    dev->irq_line = irq & 0xFF;
+    dev->irq_pin = irq >> 8;
+    pci_probe_bars(dev);
+    pci_probe_caps(dev);
+
+    char line[64];
+    ksnprintf(line, sizeof(line), "PCI %02x:%02x.%u %04x:%04x class %02x/%02x\n",
+              bus, slot, func, dev->vendor_id, dev->device_id, dev->class_code, dev->subclass);
+    terminal_writestring(line);
+}
+
+// 扫描PCI总线，建立设备表
 void pci_init(void) {
     terminal_writestring("\n=== PCI Bus Initialization ===\n");
     
@@ -89,73 +156,153 @@ void pci_init(void) {
         return;
     }
     
-    terminal_writestring("PCI bus detected\n");
-    terminal_writestring("Scanning PCI devices...\n");
-    
-    // 扫描所有PCI设备
+    // 扫描PCI设备: 功能0不存在的槽位整体跳过，只有多功能设备 (头类型bit7) 才检查功能1-7
+    // 每次配置空间访问都是两次端口操作，在虚拟机中各是一次VM退出
+    pci_num_devices = 0;
     for(uint8_t bus = 0; bus < 8; bus++) {
         for(uint8_t slot = 0; slot < 32; slot++) {
-            for(uint8_t func = 0; func < 8; func++) {
-                if(pci_device_exists(bus, slot, func)) {
-                    pci_get_device_info(bus, slot, func);
+            uint32_t id = pci_config_read_dword(bus, slot, 0, PCI_VENDOR_ID);
+            if((id & 0xFFFF) == 0xFFFF) {
+                continue;
+            }
+            uint8_t funcs = (pci_config_read_word(bus, slot, 0, PCI_HEADER_TYPE) & 0x80) ? 8 : 1;
+            for(uint8_t func = 0; func < funcs; func++) {
+                if(func > 0) {
+                    id = pci_config_read_dword(bus, slot, func, PCI_VENDOR_ID);
+                    if((id & 0xFFFF) == 0xFFFF) {
+                        continue;
+                    }
                 }
+                pci_add_device(bus, slot, func, id);
             }
         }
     }
     
-    terminal_writestring("=== PCI Bus Initialization Complete ===\n\n");
-}
-
-// 查找指定的PCI设备
-int pci_find_device(uint16_t vendor_id, uint16_t device_id, uint16_t* bus, uint16_t* slot) {
-    for(uint8_t b = 0; b < 8; b++) {
-        for(uint8_t s = 0; s < 32; s++) {
-            uint16_t v = pci_config_read_word(b, s, 0, PCI_VENDOR_ID);
-            if(v == vendor_id) {
-                uint16_t d = pci_config_read_word(b, s, 0, PCI_DEVICE_ID);
-                if(d == device_id) {
-                    *bus = b;
-                    *slot = s;
-                    return 1;
-                }
-            }
+    char line[48];
+    ksnprintf(line, sizeof(line), "=== PCI: %u functions ===\n\n", pci_num_devices);
+    terminal_writestring(line);
+}
+
+static const struct pci_device_id *pci_match(const struct pci_driver *drv, const struct pci_dev *dev) {
+    uint32_t class = ((uint32_t)dev->class_code << 16) | ((uint32_t)dev->subclass << 8) | dev->prog_if;
+    for (const struct pci_device_id *id = drv->id_table; id->vendor_id || id->class_mask; id++) {
+        if ((id->vendor_id == PCI_ANY_ID || id->vendor_id == dev->vendor_id) &&
+            (id->device_id == PCI_ANY_ID || id->device_id == dev->device_id) &&
+            ((class ^ id->class_code) & id->class_mask) == 0) {
+            return id;
+        }
+    }
+    return NULL;
+}
+
+uint32_t pci_register_driver(struct pci_driver *drv) {
+    struct pci_driver **pp = &pci_drivers;
+    while (*pp) {
+        pp = &(*pp)->next;
+    }
+    drv->next = NULL;
+    *pp = drv;
+
+    uint32_t bound = 0;
+    for (uint32_t i = 0; i < pci_num_devices; i++) {
+        struct pci_dev *dev = &pci_devices[i];
+        const struct pci_device_id *id;
+        if (dev->driver || !(id = pci_match(drv, dev))) {
+            continue;
+        }
+        dev->driver = drv;
+        if (!drv->probe(dev, id)) {
+            dev->driver = NULL;
+            continue;
+        }
+        bound++;
+    }
+    return bound;
+}
+
+uint32_t pci_device_count(void) {
+    return pci_num_devices;
+}
+
+struct pci_dev *pci_get_device(uint32_t index) {
+    return index < pci_num_devices ? &pci_devices[index] : NULL;
+}
+
+// 在设备表中查找指定的PCI设备
+struct pci_dev *pci_find_device(uint16_t vendor_id, uint16_t device_id) {
+    for (uint32_t i = 0; i < pci_num_devices; i++) {
+        if (pci_devices[i].vendor_id == vendor_id && pci_devices[i].device_id == device_id) {
+            return &pci_devices[i];
+        }
+    }
+    return NULL;
+}
+
+uint8_t pci_find_capability(const struct pci_dev *dev, uint8_t cap_id) {
+    for (uint8_t i = 0; i < dev->num_caps; i++) {
+        if (dev->caps[i].id == cap_id) {
+            return dev->caps[i].offset;
         }
     }
     return 0;
 }
 
-// 获取设备的I/O基地址
-uint16_t pci_get_iobase(uint16_t bus, uint16_t slot) {
-    uint32_t bar0 = pci_config_read_dword(bus, slot, 0, PCI_BAR0);
-    if(bar0 & 1) {  // 检查是否是I/O空间
-        // 启用设备的总线主控和I/O空间访问
-        uint16_t command = pci_config_read_word(bus, slot, 0, PCI_COMMAND);
-        command |= (PCI_COMMAND_IO | PCI_COMMAND_MASTER | PCI_COMMAND_PERR);
-        pci_config_write_word(bus, slot, 0, PCI_COMMAND, command);
-        
-        // 获取并显示中断线路
-        uint8_t interrupt_line = pci_config_read_word(bus, slot, 0, PCI_INTERRUPT_LINE) & 0xFF;
-        terminal_writestring("Device interrupt line: ");
-        print_hex(interrupt_line);
-        terminal_writestring("\n");
-        
-        // 验证命令寄存器设置
-        command = pci_config_read_word(bus, slot, 0, PCI_COMMAND);
-        terminal_writestring("PCI Command register: ");
-        print_hex(command);
-        terminal_writestring("\n");
-        
-        return (uint16_t)(bar0 & ~3);
+uint16_t pci_iobase(const struct pci_dev *dev) {
+    for (uint8_t i = 0; i < PCI_MAX_BARS; i++) {
+        if ((dev->bars[i].flags & PCI_BAR_IO) && dev->bars[i].size) {
+            return (uint16_t)dev->bars[i].base;
+        }
     }
     return 0;
 }
 
-// 配置设备的中断
-void pci_configure_interrupt(uint16_t bus, uint16_t slot, uint8_t interrupt_line) {
-    // 设置中断线路
-    pci_config_write_word(bus, slot, 0, PCI_INTERRUPT_LINE, interrupt_line);
-    
-    terminal_writestring("Configured interrupt line: ");
-    print_hex(interrupt_line);
-    terminal_writestring("\n");
-} 
\ No newline at end of file
+void pci_enable_device(struct pci_dev *dev, uint16_t command_bits) {
+    uint16_t command = pci_read_word(dev, PCI_COMMAND);
+    if ((command & command_bits) != command_bits) {
+        pci_write_word(dev, PCI_COMMAND, command | command_bits);
+    }
+}
+
+void pci_set_irq_line(struct pci_dev *dev, uint8_t irq_line) {
+    // 中断线寄存器只是给软件看的记录，与中断引脚共享一个字
+    pci_write_word(dev, PCI_INTERRUPT_LINE, ((uint16_t)dev->irq_pin << 8) | irq_line);
+    dev->irq_line = irq_line;
+}
+
+static const char *pci_cap_name(uint8_t id) {
+    switch (id) {
+    case PCI_CAP_ID_PM:   return "pm";
+    case PCI_CAP_ID_MSI:  return "msi";
+    case PCI_CAP_ID_VNDR: return "vendor";
+    case PCI_CAP_ID_EXP:  return "pcie";
+    case PCI_CAP_ID_MSIX: return "msix";
+    default:              return "?";
+    }
+}
+
+void pci_dump(void) {
+    char line[96];
+    for (uint32_t i = 0; i < pci_num_devices; i++) {
+        const struct pci_dev *dev = &pci_devices[i];
+        ksnprintf(line, sizeof(line), "%02x:%02x.%u %04x:%04x class %02x%02x%02x rev %02x irq %u pin %u %s\n",
+                  dev->bus, dev->slot, dev->func, dev->vendor_id, dev->device_id,
+                  dev->class_code, dev->subclass, dev->prog_if, dev->revision,
+                  dev->irq_line, dev->irq_pin, dev->driver ? dev->driver->name : "-");
+        serial_write_string(line);
+        for (uint8_t b = 0; b < PCI_MAX_BARS; b++) {
+            const struct pci_bar *bar = &dev->bars[b];
+            if (!bar->size) {
+                continue;
+            }
+            ksnprintf(line, sizeof(line), "  bar%u %s 0x%llx size 0x%llx%s\n", b,
+                      (bar->flags & PCI_BAR_IO) ? "io " : (bar->flags & PCI_BAR_MEM64) ? "m64" : "m32",
+                      bar->base, bar->size, (bar->flags & PCI_BAR_PREFETCH) ? " prefetch" : "");
+            serial_write_string(line);
+        }
+        for (uint8_t c = 0; c < dev->num_caps; c++) {
+            ksnprintf(line, sizeof(line), "  cap 0x%02x %s at 0x%02x\n", dev->caps[c].id,
+                      pci_cap_name(dev->caps[c].id), dev->caps[c].offset);
+            serial_write_string(line);
+        }
+    }
+}
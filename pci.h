@@ -42,6 +42,7 @@
 #define PCI_COMMAND_PARITY  0x0040    // 奇偶校验错误响应
 #define PCI_COMMAND_WAIT    0x0080    // SERR#使能
 #define PCI_COMMAND_PERR    0x0100   // 奇偶校验错误响应
+#define PCI_COMMAND_INTX_DISABLE 0x0400 // 禁止INTx (使用MSI/MSI-X时)
 
 // PCI状态寄存器位
 #define PCI_STATUS_CAP_LIST  0x0010    // 支持能力列表
@@ -56,14 +57,118 @@
 #define PCI_STATUS_SIG_SYSTEM_ERROR 0x4000 // 发出系统错误
 #define PCI_STATUS_DETECTED_PARITY  0x8000 // 检测到奇偶校验错误
 
+// BAR标志
+#define PCI_BAR_IO        0x01    // I/O端口空间 (否则为内存空间)
+#define PCI_BAR_MEM64     0x02    // 64位内存BAR，占用两个BAR寄存器
+#define PCI_BAR_PREFETCH  0x04    // 可预取
+
+// 能力ID
+#define PCI_CAP_ID_PM     0x01    // 电源管理
+#define PCI_CAP_ID_MSI    0x05
+#define PCI_CAP_ID_VNDR   0x09    // 厂商自定义 (virtio 1.0 的配置结构)
+#define PCI_CAP_ID_EXP    0x10    // PCI Express
+#define PCI_CAP_ID_MSIX   0x11
+
+#define PCI_MAX_DEVICES   32
+#define PCI_MAX_BARS      6
+#define PCI_MAX_CAPS      16
+#define PCI_ANY_ID        0xFFFF
+
+struct pci_bar {
+    uint64_t base;
+    uint64_t size;          // 0 表示未实现
+    uint8_t flags;
+};
+
+struct pci_cap {
+    uint8_t id;
+    uint8_t offset;         // 在配置空间中的位置
+};
+
+struct pci_driver;
+
+// 启动时扫描一次建立的设备表; 驱动从这里取资源，运行时不再访问配置空间
+struct pci_dev {
+    uint8_t bus;
+    uint8_t slot;
+    uint8_t func;
+    uint8_t header_type;    // 去掉多功能位
+    uint16_t vendor_id;
+    uint16_t device_id;
+    uint8_t class_code;
+    uint8_t subclass;
+    uint8_t prog_if;
+    uint8_t revision;
+    uint8_t irq_line;
+    uint8_t irq_pin;
+    uint8_t num_caps;
+    struct pci_bar bars[PCI_MAX_BARS];
+    struct pci_cap caps[PCI_MAX_CAPS];
+    volatile uint32_t *msix_table;  // 启用MSI-X后映射的向量表 (msi.c)
+    uint16_t msix_entries;
+    struct pci_driver *driver;   // 已绑定的驱动
+    void *driver_data;
+};
+
+// 匹配表项: 厂商/设备为 PCI_ANY_ID 时不比较，class_mask 为0时不比较类别
+// 类别按 (class << 16) | (subclass << 8) | prog_if 排列
+struct pci_device_id {
+    uint16_t vendor_id;
+    uint16_t device_id;
+    uint32_t class_code;
+    uint32_t class_mask;
+};
+
+#define PCI_DEVICE(vendor, device) \
+    { .vendor_id = (vendor), .device_id = (device) }
+#define PCI_DEVICE_CLASS(class, mask) \
+    { .vendor_id = PCI_ANY_ID, .device_id = PCI_ANY_ID, .class_code = (class), .class_mask = (mask) }
+
+// id_table 以全零项结尾; probe 返回 false 表示不接管该设备
+struct pci_driver {
+    const char *name;
+    const struct pci_device_id *id_table;
+    bool (*probe)(struct pci_dev *dev, const struct pci_device_id *id);
+    struct pci_driver *next;
+};
+
 // 函数声明
 void pci_init(void);
 uint16_t pci_config_read_word(uint8_t bus, uint8_t slot, uint8_t func, uint8_t offset);
 void pci_config_write_word(uint8_t bus, uint8_t slot, uint8_t func, uint8_t offset, uint16_t value);
 uint32_t pci_config_read_dword(uint8_t bus, uint8_t slot, uint8_t func, uint8_t offset);
 void pci_config_write_dword(uint8_t bus, uint8_t slot, uint8_t func, uint8_t offset, uint32_t value);
-int pci_find_device(uint16_t vendor_id, uint16_t device_id, uint16_t* bus, uint16_t* slot);
-uint16_t pci_get_iobase(uint16_t bus, uint16_t slot);
-void pci_configure_interrupt(uint16_t bus, uint16_t slot, uint8_t interrupt_line);
 
-#endif // PCI_H 
\ No newline at end of file
+// 注册驱动并立即探测设备表中尚未绑定的匹配设备，返回绑定的设备数
+// 探测按注册顺序进行，先注册的驱动优先
+uint32_t pci_register_driver(struct pci_driver *drv);
+uint32_t pci_device_count(void);
+struct pci_dev *pci_get_device(uint32_t index);
+struct pci_dev *pci_find_device(uint16_t vendor_id, uint16_t device_id);
+// 能力在配置空间中的偏移，没有时返回0
+uint8_t pci_find_capability(const struct pci_dev *dev, uint8_t cap_id);
+// 第一个I/O BAR的端口基址，没有时返回0
+uint16_t pci_iobase(const struct pci_dev *dev);
+// 在命令寄存器中置位 (I/O、内存译码、总线主控等)
+void pci_enable_device(struct pci_dev *dev, uint16_t command_bits);
+void pci_set_irq_line(struct pci_dev *dev, uint8_t irq_line);
+// 设备表、BAR和能力列表 (控制台 pci 命令)
+void pci_dump(void);
+
+static inline uint16_t pci_read_word(const struct pci_dev *dev, uint8_t offset) {
+    return pci_config_read_word(dev->bus, dev->slot, dev->func, offset);
+}
+
+static inline uint32_t pci_read_dword(const struct pci_dev *dev, uint8_t offset) {
+    return pci_config_read_dword(dev->bus, dev->slot, dev->func, offset);
+}
+
+static inline void pci_write_word(const struct pci_dev *dev, uint8_t offset, uint16_t value) {
+    pci_config_write_word(dev->bus, dev->slot, dev->func, offset, value);
+}
+
+static inline void pci_write_dword(const struct pci_dev *dev, uint8_t offset, uint32_t value) {
+    pci_config_write_dword(dev->bus, dev->slot, dev->func, offset, value);
+}
+
+#endif // PCI_H
@@ -0,0 +1,169 @@
+#include "ping.h"
+#include "network.h"
+#include "tsc.h"
+#include "kprintf.h"
+#include "serial.h"
+#include "memory.h"
+#include "hist.h"
+
+// 收到的应答，等待 ping_poll 输出
+struct ping_report {
+    uint16_t sequence;
+    uint32_t rtt_us;
+};
+
+#define PING_REPORT_RING 16
+
+static struct ping_stats ping;
+static uint64_t ping_sent_tsc[PING_SEQ_WINDOW];
+static uint16_t ping_next_seq = 0;
+static uint64_t ping_interval_cycles = 0;
+static uint64_t ping_next_tsc = 0;
+static uint64_t ping_last_sent_tsc = 0;
+
+// 启动以来所有回显应答的RTT (微秒)，供仪表盘计算分位数
+static struct hist ping_rtt_hist;
+
+static struct ping_report ping_reports[PING_REPORT_RING];
+static volatile uint32_t ping_report_head = 0;   // 收包路径写
+static uint32_t ping_report_tail = 0;            // ping_poll 读
+
+static uint64_t ms_to_cycles(uint32_t ms) {
+    return (uint64_t)tsc_khz() * ms;
+}
+
+void ping_start(uint32_t target, uint32_t count, uint32_t interval_ms) {
+    if (ping.active) {
+        ping_stop();
+    }
+    memset(&ping, 0, sizeof(ping));
+    ping.target = target;
+    ping.count = count;
+    ping.rtt_min_us = 0xFFFFFFFF;
+    ping.active = true;
+    ping_next_seq = 0;
+    memset(ping_sent_tsc, 0, sizeof(ping_sent_tsc));
+    ping_interval_cycles = ms_to_cycles(interval_ms);
+    ping_next_tsc = tsc_read();
+    ping_report_tail = ping_report_head;
+
+    char line[64];
+    ksnprintf(line, sizeof(line), "PING " IP_FMT ": %u data bytes\n", IP_ARGS(target), 12u);
+    serial_write_string(line);
+}
+
+static void ping_print_reports(void) {
+    char line[80];
+    while (ping_report_tail != ping_report_head) {
+        struct ping_report *r = &ping_reports[ping_report_tail % PING_REPORT_RING];
+        ksnprintf(line, sizeof(line), "reply from " IP_FMT ": seq=%u time=%u.%03u ms\n",
+                  IP_ARGS(ping.target), r->sequence, r->rtt_us / 1000, r->rtt_us % 1000);
+        serial_write_string(line);
+        ping_report_tail++;
+    }
+}
+
+void ping_stop(void) {
+    if (!ping.active) {
+        return;
+    }
+    ping_print_reports();
+    ping.active = false;
+
+    char line[96];
+    uint32_t loss = ping.sent > ping.received ? (ping.sent - ping.received) * 100 / ping.sent : 0;
+    ksnprintf(line, sizeof(line), "--- " IP_FMT " ping statistics ---\n", IP_ARGS(ping.target));
+    serial_write_string(line);
+    ksnprintf(line, sizeof(line), "%u transmitted, %u received, %u%% loss, %u errors\n",
+              ping.sent, ping.received, loss, ping.errors);
+    serial_write_string(line);
+    if (ping.received) {
+        uint32_t avg = (uint32_t)div64_u32(ping.rtt_sum_us, ping.received, NULL);
+        ksnprintf(line, sizeof(line), "rtt min/avg/max = %u.%03u/%u.%03u/%u.%03u ms\n",
+                  ping.rtt_min_us / 1000, ping.rtt_min_us % 1000, avg / 1000, avg % 1000,
+                  ping.rtt_max_us / 1000, ping.rtt_max_us % 1000);
+        serial_write_string(line);
+    }
+}
+
+bool ping_active(void) {
+    return ping.active;
+}
+
+void ping_poll(void) {
+    if (!ping.active) {
+        return;
+    }
+    ping_print_reports();
+
+    uint64_t now = tsc_read();
+    bool all_sent = ping.count && ping.sent + ping.errors >= ping.count;
+    if (all_sent) {
+        // 全部应答已到，或等待超时后输出汇总
+        if (ping.received >= ping.sent || now - ping_last_sent_tsc >= ms_to_cycles(PING_TIMEOUT_MS)) {
+            ping_stop();
+        }
+        return;
+    }
+    if ((long long)(now - ping_next_tsc) < 0) {
+        return;
+    }
+
+    uint16_t seq = ping_next_seq++;
+    ping_sent_tsc[seq % PING_SEQ_WINDOW] = now;
+    if (icmp_send_echo(ping.target, PING_IDENTIFIER, seq)) {
+        ping.sent++;
+    } else {
+        ping_sent_tsc[seq % PING_SEQ_WINDOW] = 0;
+        ping.errors++;
+        serial_write_string("ping: send failed\n");
+    }
+    ping_last_sent_tsc = now;
+    ping_next_tsc = now + ping_interval_cycles;
+}
+
+bool ping_handle_reply(uint32_t src_ip, uint16_t identifier, uint16_t sequence) {
+    if (identifier != PING_IDENTIFIER) {
+        return false;
+    }
+    // 不是当前这一轮的应答 (迟到或来自其他主机) 也由本模块消费
+    uint16_t age = ping_next_seq - sequence;
+    if (!ping.active || src_ip != ping.target || age == 0 || age > PING_SEQ_WINDOW) {
+        return true;
+    }
+
+    // 发送时间在第一个应答时清零，重复的应答不再计数
+    uint64_t sent_tsc = ping_sent_tsc[sequence % PING_SEQ_WINDOW];
+    if (!sent_tsc) {
+        return true;
+    }
+    ping_sent_tsc[sequence % PING_SEQ_WINDOW] = 0;
+
+    uint32_t rtt_us = (uint32_t)tsc_to_us(tsc_read() - sent_tsc);
+    hist_record(&ping_rtt_hist, rtt_us);
+    ping.received++;
+    ping.rtt_sum_us += rtt_us;
+    if (rtt_us < ping.rtt_min_us) ping.rtt_min_us = rtt_us;
+    if (rtt_us > ping.rtt_max_us) ping.rtt_max_us = rtt_us;
+
+    // 输出队列满时只计数，不输出这一条
+    if (ping_report_head - ping_report_tail < PING_REPORT_RING) {
+        struct ping_report *r = &ping_reports[ping_report_head % PING_REPORT_RING];
+        r->sequence = sequence;
+        r->rtt_us = rtt_us;
+        ping_report_head++;
+    }
+    return true;
+}
+
+const struct ping_stats *ping_get_stats(void) {
+    return &ping;
+}
+
+void ping_record_rtt(uint32_t rtt_us) {
+    hist_record(&ping_rtt_hist, rtt_us);
+}
+
+const struct hist *ping_rtt_histogram(void) {
+    return &ping_rtt_hist;
+}
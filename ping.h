@@ -0,0 +1,43 @@
+#ifndef PING_H
+#define PING_H
+
+#include "types.h"
+
+// 控制台 ping: 按间隔发送回显请求并测量往返时间
+// 应答在收包路径上只记录时间，输出在 ping_poll 中完成
+
+// 请求使用的ICMP标识符，用来区分演示程序发出的请求
+#define PING_IDENTIFIER 0x5049
+// 记录发送时间的序号窗口 (2的幂)
+#define PING_SEQ_WINDOW 64
+// 最后一个请求发出后等待应答的时间
+#define PING_TIMEOUT_MS 1000
+
+struct ping_stats {
+    uint32_t target;        // 主机字节序
+    uint32_t count;         // 计划发送数，0 表示一直发送
+    uint32_t sent;
+    uint32_t received;
+    uint32_t errors;        // 发送失败 (无MAC、无缓冲区)
+    uint32_t rtt_min_us;
+    uint32_t rtt_max_us;
+    uint64_t rtt_sum_us;
+    bool active;
+};
+
+// 开始一轮 ping; 已有一轮在进行时先结束它
+void ping_start(uint32_t target, uint32_t count, uint32_t interval_ms);
+void ping_stop(void);
+bool ping_active(void);
+// 低优先级上下文中调用: 到时间发送下一个请求，输出应答和汇总
+void ping_poll(void);
+// 收包路径: 匹配到本模块的请求时记录RTT并返回 true
+bool ping_handle_reply(uint32_t src_ip, uint16_t identifier, uint16_t sequence);
+const struct ping_stats *ping_get_stats(void);
+
+// 全部回显应答的RTT直方图 (微秒); 演示程序的应答通过 ping_record_rtt 计入
+struct hist;
+void ping_record_rtt(uint32_t rtt_us);
+const struct hist *ping_rtt_histogram(void);
+
+#endif // PING_H
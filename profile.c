@@ -0,0 +1,152 @@
+#include "profile.h"
+#include "irq.h"
+#include "io.h"
+#include "kprintf.h"
+#include "serial.h"
+
+// PIT 通道0: 模式2 (周期性计数)，低/高字节
+#define PIT_CH0_DATA   0x40
+#define PIT_CMD        0x43
+#define PIT_CH0_RATE   0x34
+#define PIT_HZ         1193182
+
+static struct profile_cpu profile_percpu[NR_CPUS];
+static uint32_t profile_hz = PROFILE_HZ_DEFAULT;
+static bool profile_on = false;
+
+// 定时器中断: 记录被中断代码的EIP和调用链
+static void profile_tick(void) {
+    struct irq_frame *frame = irq_get_frame();
+    if (!frame) {
+        return;
+    }
+
+    struct profile_cpu *pc = &profile_percpu[smp_processor_id()];
+    struct profile_sample *s = &pc->samples[pc->head & (PROFILE_SAMPLES - 1)];
+    uint32_t depth = 0;
+    s->pc[depth++] = frame->eip;
+
+    // 被中断代码的帧都在中断现场之上; 帧指针必须对齐、单调增长且不超出栈范围
+    uint32_t low = (uint32_t)frame;
+    uint32_t high = low + PROFILE_STACK_SPAN;
+    uint32_t ebp = frame->ebp;
+    while (depth < PROFILE_MAX_DEPTH && ebp > low && ebp + 8 <= high && !(ebp & 3)) {
+        const uint32_t *fp = (const uint32_t *)ebp;
+        if (!fp[1]) {
+            break;
+        }
+        s->pc[depth++] = fp[1];
+        if (fp[0] <= ebp) {
+            break;
+        }
+        ebp = fp[0];
+    }
+    s->depth = depth;
+    pc->head++;
+}
+
+static void pit_set_rate(uint32_t hz) {
+    uint32_t divisor = PIT_HZ / hz;
+    if (divisor > 0xFFFF) divisor = 0xFFFF;
+    if (divisor < 1) divisor = 1;
+    outb(PIT_CMD, PIT_CH0_RATE);
+    outb(PIT_CH0_DATA, divisor & 0xFF);
+    outb(PIT_CH0_DATA, divisor >> 8);
+}
+
+void profile_init(void) {
+    profile_on = false;
+    profile_reset();
+    irq_register(IRQ_TIMER, profile_tick);
+}
+
+bool profile_start(uint32_t hz) {
+    if (hz == 0) {
+        hz = PROFILE_HZ_DEFAULT;
+    }
+    // PIT 最低约 19Hz; 过高的频率会让采样本身占满CPU
+    if (hz < 19 || hz > 10000) {
+        return false;
+    }
+    profile_hz = hz;
+    pit_set_rate(hz);
+    profile_on = true;
+    irq_enable(IRQ_TIMER);
+    return true;
+}
+
+void profile_stop(void) {
+    irq_disable(IRQ_TIMER);
+    profile_on = false;
+}
+
+bool profile_running(void) {
+    return profile_on;
+}
+
+uint32_t profile_get_hz(void) {
+    return profile_hz;
+}
+
+uint32_t profile_sample_count(void) {
+    uint32_t total = 0;
+    for (int cpu = 0; cpu < NR_CPUS; cpu++) {
+        total += profile_percpu[cpu].head;
+    }
+    return total;
+}
+
+void profile_reset(void) {
+    bool was_on = profile_on;
+    if (was_on) {
+        profile_stop();
+    }
+    for (int cpu = 0; cpu < NR_CPUS; cpu++) {
+        profile_percpu[cpu].head = 0;
+    }
+    if (was_on) {
+        profile_start(profile_hz);
+    }
+}
+
+// 每个样本一行: 十六进制地址，叶子在前
+static void profile_emit_sample(const struct profile_sample *s) {
+    char line[PROFILE_MAX_DEPTH * 9 + 2];
+    uint32_t pos = 0;
+    for (uint32_t i = 0; i < s->depth && i < PROFILE_MAX_DEPTH; i++) {
+        pos += ksnprintf(line + pos, sizeof(line) - pos, i ? " %08x" : "%08x", s->pc[i]);
+    }
+    line[pos++] = '\n';
+    line[pos] = '\0';
+    serial_write_string(line);
+}
+
+void profile_dump(void) {
+    char line[64];
+    bool was_on = profile_on;
+    if (was_on) {
+        profile_stop();
+    }
+
+    ksnprintf(line, sizeof(line), "\n@@PROFILE v1 hz=%u cpus=%u depth=%u\n",
+              profile_hz, (uint32_t)NR_CPUS, (uint32_t)PROFILE_MAX_DEPTH);
+    serial_write_string(line);
+    for (uint32_t cpu = 0; cpu < NR_CPUS; cpu++) {
+        struct profile_cpu *pc = &profile_percpu[cpu];
+        uint32_t head = pc->head;
+        uint32_t count = head < PROFILE_SAMPLES ? head : PROFILE_SAMPLES;
+        if (count == 0) {
+            continue;
+        }
+        ksnprintf(line, sizeof(line), "@@SAMPLES cpu=%u count=%u\n", cpu, count);
+        serial_write_string(line);
+        for (uint32_t i = head - count; i != head; i++) {
+            profile_emit_sample(&pc->samples[i & (PROFILE_SAMPLES - 1)]);
+        }
+    }
+    serial_write_string("@@END\n");
+
+    if (was_on) {
+        profile_start(profile_hz);
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "types.h"
+#include "cpu.h"
+
+// 采样分析器: PIT通道0 (IRQ0) 周期中断，记录被中断的EIP和沿帧指针链得到的返回地址
+// 内核以 -fno-omit-frame-pointer 编译，每个函数的 [ebp] 是上一帧，[ebp+4] 是返回地址
+// profile_dump 输出后在主机上用 tools/profile_fold.py 对照 kernel.bin 的符号生成折叠栈
+
+// 默认采样频率 (不选整百，避免与周期性任务同步)
+#define PROFILE_HZ_DEFAULT 499
+// 每个样本最多记录的栈深度 (含被中断的EIP)
+#define PROFILE_MAX_DEPTH  16
+// 每个CPU的样本数 (2的幂)，满时覆盖最旧的样本
+#define PROFILE_SAMPLES    512
+// 栈回溯的范围: 帧指针只能在中断现场之上这么多字节以内 (启动栈为16KB)
+#define PROFILE_STACK_SPAN 16384
+
+struct profile_sample {
+    uint32_t depth;
+    uint32_t pc[PROFILE_MAX_DEPTH];   // pc[0] 为被中断的EIP，其后为返回地址
+};
+
+struct profile_cpu {
+    uint32_t head;
+    struct profile_sample samples[PROFILE_SAMPLES];
+} __cacheline_aligned;
+
+void profile_init(void);
+// 以 hz 频率开始采样 (0 使用默认值)
+bool profile_start(uint32_t hz);
+void profile_stop(void);
+bool profile_running(void);
+uint32_t profile_get_hz(void);
+// 所有CPU已记录的样本总数 (包括已被覆盖的)
+uint32_t profile_sample_count(void);
+void profile_reset(void);
+// 以 @@PROFILE 块输出全部样本，输出期间暂停采样
+void profile_dump(void);
+
+#endif // PROFILE_H
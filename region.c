@@ -0,0 +1,91 @@
+#include "region.h"
+#include "memory.h"
+#include "kprintf.h"
+#include "serial.h"
+
+static struct region_cpu region_percpu[NR_CPUS];
+
+static const char *const region_names[REGION_COUNT] = {
+    "rx_parse", "arp_lookup", "ip_demux", "checksum", "tx_commit",
+};
+
+const char *region_name(uint32_t id) {
+    return id < REGION_COUNT ? region_names[id] : "?";
+}
+
+void region_init(void) {
+    region_reset();
+}
+
+void region_reset(void) {
+    memset(region_percpu, 0, sizeof(region_percpu));
+    for (int cpu = 0; cpu < NR_CPUS; cpu++) {
+        for (int i = 0; i < REGION_COUNT; i++) {
+            region_percpu[cpu].regions[i].min = 0xFFFFFFFF;
+        }
+    }
+}
+
+void region_record(uint32_t id, uint64_t cycles) {
+    struct region_stats *r = &region_percpu[smp_processor_id()].regions[id];
+    uint32_t c = cycles > 0xFFFFFFFF ? 0xFFFFFFFF : (uint32_t)cycles;
+
+    r->count++;
+    r->sum += c;
+    if (c < r->min) r->min = c;
+    if (c > r->max) r->max = c;
+    r->hist[c ? 32 - __builtin_clz(c) : 0]++;
+}
+
+void region_get_stats(uint32_t id, struct region_stats *out) {
+    memset(out, 0, sizeof(*out));
+    out->min = 0xFFFFFFFF;
+    if (id >= REGION_COUNT) {
+        return;
+    }
+    for (int cpu = 0; cpu < NR_CPUS; cpu++) {
+        const struct region_stats *r = &region_percpu[cpu].regions[id];
+        out->count += r->count;
+        out->sum += r->sum;
+        if (r->min < out->min) out->min = r->min;
+        if (r->max > out->max) out->max = r->max;
+        for (int b = 0; b < REGION_HIST_BUCKETS; b++) {
+            out->hist[b] += r->hist[b];
+        }
+    }
+}
+
+static void region_dump_hist(const struct region_stats *r) {
+    char line[64];
+    for (uint32_t b = 0; b < REGION_HIST_BUCKETS; b++) {
+        if (!r->hist[b]) {
+            continue;
+        }
+        uint32_t low = b ? 1u << (b - 1) : 0;
+        ksnprintf(line, sizeof(line), "  >= %10u cycles %10u\n", low, r->hist[b]);
+        serial_write_string(line);
+    }
+}
+
+void region_dump(bool hist) {
+    struct region_stats r;
+    char line[96];
+
+    if (!REGION_ENABLED) {
+        serial_write_string("region instrumentation is compiled out (NO_REGION build)\n");
+        return;
+    }
+    ksnprintf(line, sizeof(line), "%-10s %10s %10s %10s %10s\n",
+              "region", "count", "min_cyc", "avg_cyc", "max_cyc");
+    serial_write_string(line);
+    for (uint32_t i = 0; i < REGION_COUNT; i++) {
+        region_get_stats(i, &r);
+        uint32_t avg = r.count ? (uint32_t)div64_u32(r.sum, r.count, NULL) : 0;
+        ksnprintf(line, sizeof(line), "%-10s %10u %10u %10u %10u\n",
+                  region_names[i], r.count, r.count ? r.min : 0, avg, r.max);
+        serial_write_string(line);
+        if (hist) {
+            region_dump_hist(&r);
+        }
+    }
+}
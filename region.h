@@ -0,0 +1,57 @@
+#ifndef REGION_H
+#define REGION_H
+
+#include "types.h"
+#include "cpu.h"
+#include "tsc.h"
+
+// 代码段周期计数: REGION_BEGIN/REGION_END 之间用有序的TSC读数计时，
+// 结果记入本CPU表中该段的次数/最小/最大/总和和以2为底的对数直方图
+// 定义 NO_REGION 时 (发布构建) 宏为空; 调试和 profile 构建都保留
+
+// 代码段编号 (与 region_names 对应)
+#define REGION_RX_PARSE   0   // 驱动: 读取接收描述符/帧头，到交给协议栈之前
+#define REGION_ARP_LOOKUP 1   // ARP缓存查找
+#define REGION_IP_DEMUX   2   // IP头检查和目的地址判断，到按协议分发之前
+#define REGION_CHECKSUM   3   // 校验和累加
+#define REGION_TX_COMMIT  4   // 驱动发送 (xmit/tx_commit)
+#define REGION_COUNT      5
+
+// 桶 0 为 0 个周期，桶 i 为 [2^(i-1), 2^i)
+#define REGION_HIST_BUCKETS 33
+
+struct region_stats {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t hist[REGION_HIST_BUCKETS];
+};
+
+struct region_cpu {
+    struct region_stats regions[REGION_COUNT];
+} __cacheline_aligned;
+
+#ifndef NO_REGION
+#define REGION_ENABLED 1
+#define REGION_BEGIN(var)   uint64_t var = tsc_read_fenced()
+// 在循环中重新开始计时 (变量已由 REGION_BEGIN 定义)
+#define REGION_RESTART(var) ((var) = tsc_read_fenced())
+#define REGION_END(id, var) region_record((id), tsc_read_fenced() - (var))
+#else
+#define REGION_ENABLED 0
+#define REGION_BEGIN(var)   do { } while (0)
+#define REGION_RESTART(var) do { } while (0)
+#define REGION_END(id, var) do { } while (0)
+#endif
+
+void region_init(void);
+void region_record(uint32_t id, uint64_t cycles);
+void region_reset(void);
+const char *region_name(uint32_t id);
+// 合并所有CPU的某一段
+void region_get_stats(uint32_t id, struct region_stats *out);
+// 每段一行: 次数、最小/平均/最大周期数; hist 为真时再输出非空的直方图桶
+void region_dump(bool hist);
+
+#endif // REGION_H
@@ -0,0 +1,78 @@
+#include "rss.h"
+#include "cpu.h"
+#include "network.h"
+#include "byteorder.h"
+
+// 微软RSS规范中的默认密钥，virtio/多数网卡也使用它
+static const uint8_t rss_key[RSS_KEY_SIZE] = {
+    0x6d, 0x5a, 0x56, 0xda, 0x25, 0x5b, 0x0e, 0xc2,
+    0x41, 0x67, 0x25, 0x3d, 0x43, 0xa3, 0x8f, 0xb0,
+    0xd0, 0xca, 0x2b, 0xcb, 0xae, 0x7b, 0x30, 0xb4,
+    0x77, 0xcb, 0x2d, 0xa3, 0x80, 0x30, 0xf2, 0x0c,
+    0x6a, 0x42, 0xb7, 0x3b, 0xbe, 0xac, 0x01, 0xfa,
+};
+
+// 哈希值低位 -> CPU
+static uint8_t rss_indir[RSS_INDIR_SIZE];
+
+void rss_init(void) {
+    uint32_t ncpus = num_online_cpus();
+    for (int i = 0; i < RSS_INDIR_SIZE; i++) {
+        rss_indir[i] = i % ncpus;
+    }
+}
+
+// 对输入的每一位，如果为1则异或上密钥中对应位置开始的32位窗口
+uint32_t toeplitz_hash(const uint8_t *key, const uint8_t *data, int length) {
+    uint32_t result = 0;
+    uint32_t window = ((uint32_t)key[0] << 24) | ((uint32_t)key[1] << 16) |
+                      ((uint32_t)key[2] << 8) | key[3];
+
+    for (int i = 0; i < length; i++) {
+        for (int bit = 7; bit >= 0; bit--) {
+            if (data[i] & (1 << bit)) {
+                result ^= window;
+            }
+            window <<= 1;
+            if (key[i + 4] & (1 << bit)) {
+                window |= 1;
+            }
+        }
+    }
+    return result;
+}
+
+uint32_t rss_frame_hash(const uint8_t *frame, uint16_t length) {
+    const struct eth_header *eth = (const struct eth_header *)frame;
+    if (length < sizeof(struct eth_header) + sizeof(struct ipv4_header) ||
+        ntohs(eth->type) != ETH_TYPE_IP) {
+        return 0;
+    }
+
+    const struct ipv4_header *ip = (const struct ipv4_header *)(frame + sizeof(struct eth_header));
+    uint16_t ihl = (ip->version_ihl & 0x0F) * 4;
+
+    // 输入顺序: 源地址, 目的地址, 源端口, 目的端口
+    uint8_t input[12];
+    const uint8_t *addrs = (const uint8_t *)&ip->src_ip;
+    for (int i = 0; i < 8; i++) {
+        input[i] = addrs[i];
+    }
+
+    // 分片 (MF 或片偏移非零) 只使用地址，保证同一数据报的分片落在同一CPU
+    bool fragment = (ntohs(ip->flags_fragment_offset) & 0x3FFF) != 0;
+    uint16_t l4 = sizeof(struct eth_header) + ihl;
+    if (!fragment && (ip->protocol == IP_PROTO_TCP || ip->protocol == IP_PROTO_UDP) &&
+        length >= l4 + 4) {
+        for (int i = 0; i < 4; i++) {
+            input[8 + i] = frame[l4 + i];
+        }
+        return toeplitz_hash(rss_key, input, 12);
+    }
+
+    return toeplitz_hash(rss_key, input, 8);
+}
+
+uint32_t rss_select_cpu(uint32_t hash) {
+    return rss_indir[hash % RSS_INDIR_SIZE];
+}
@@ -0,0 +1,23 @@
+#ifndef RSS_H
+#define RSS_H
+
+#include "types.h"
+
+// RSS 哈希密钥长度和间接表大小
+#define RSS_KEY_SIZE    40
+#define RSS_INDIR_SIZE  128
+
+// 初始化间接表，把条目均匀分配到在线CPU
+void rss_init(void);
+
+// Toeplitz 哈希 (data 为网络字节序)
+uint32_t toeplitz_hash(const uint8_t *key, const uint8_t *data, int length);
+
+// 计算以太网帧的流哈希: TCP/UDP 使用四元组，其他IPv4使用源/目的地址
+// 非IPv4帧返回0
+uint32_t rss_frame_hash(const uint8_t *frame, uint16_t length);
+
+// 根据哈希选择处理该流的CPU
+uint32_t rss_select_cpu(uint32_t hash);
+
+#endif // RSS_H
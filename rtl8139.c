@@ -5,37 +5,96 @@
 #include "memory.h"
 #include "network.h"
 #include "serial.h"
-
-// Global variables
-uint16_t rtl8139_bus = 0;
-uint16_t rtl8139_slot = 0;
+#include "netdev.h"
+#include "log.h"
+#include "trace.h"
+#include "netstats.h"
+#include "tsc.h"
+#include "netlat.h"
+#include "region.h"
+#include "cpu.h"
+
+// I/O基地址在探测时从PCI设备表取得，中断处理程序直接使用
 static uint16_t iobase = 0;
 static uint8_t *rx_buffer;
 static uint8_t tx_buffer[4][TX_BUFFER_SIZE] __attribute__((aligned(16)));
 static uint8_t current_tx_buffer = 0;
+static bool tx_pending[4];   // 槽位已交给硬件，尚未确认读取完成
 static uint32_t current_rx_ptr = 0;
 
-// 从network.c引入全局变量，控制调试输出
-extern bool disable_rtl_debug;
-
-// 等待函数
-static void rtl8139_delay(void) {
-    for(volatile int i = 0; i < 10000; i++) {}
+static bool rtl8139_netdev_xmit(struct netdev *dev, const struct netdev_frag *frags, int nfrags,
+                                uint16_t length, const struct netdev_tx_meta *meta);
+static void rtl8139_netdev_poll(struct netdev *dev);
+static uint8_t *rtl8139_netdev_tx_reserve(struct netdev *dev, uint16_t length);
+static bool rtl8139_netdev_tx_commit(struct netdev *dev, uint16_t length,
+                                     const struct netdev_tx_meta *meta);
+static bool rtl8139_tx_slot_ready(uint8_t index);
+static void rtl8139_tx_kick(uint16_t length);
+
+static const struct netdev_ops rtl8139_netdev_ops = {
+    .xmit = rtl8139_netdev_xmit,
+    .tx_reserve = rtl8139_netdev_tx_reserve,
+    .tx_commit = rtl8139_netdev_tx_commit,
+    .poll = rtl8139_netdev_poll,
+};
+
+// 网卡对应的网络设备
+static struct netdev rtl8139_netdev = {
+    .name = "eth0",
+    .mtu = 1500,
+    .ops = &rtl8139_netdev_ops,
+};
+
+// 轮询的截止时间: 软件复位 (芯片通常几微秒内完成)、收发使能、发送槽位释放
+#define RTL8139_RESET_TIMEOUT_US  10000
+#define RTL8139_ENABLE_TIMEOUT_US 1000
+#define RTL8139_TX_TIMEOUT_US     2000
+
+// 轮询命令寄存器直到 mask 位等于 value，超过 timeout_us 返回 false
+static bool rtl8139_wait_cmd(uint8_t mask, uint8_t value, uint32_t timeout_us) {
+    uint64_t deadline = tsc_read() + tsc_from_us(timeout_us);
+    while ((inb(iobase + RTL8139_REG_CMD) & mask) != value) {
+        if (tsc_read() > deadline) {
+            return false;
+        }
+        cpu_relax();
+    }
+    return true;
 }
 
+static const struct pci_device_id rtl8139_ids[] = {
+    PCI_DEVICE(RTL8139_VENDOR_ID, RTL8139_DEVICE_ID),
+    { 0 },
+};
+
+static bool rtl8139_probe(struct pci_dev *dev, const struct pci_device_id *id);
+
+struct pci_driver rtl8139_pci_driver = {
+    .name = "rtl8139",
+    .id_table = rtl8139_ids,
+    .probe = rtl8139_probe,
+};
+
 // 初始化RTL8139网卡
-void rtl8139_init(uint16_t bus, uint16_t slot) {
-    // Store bus and slot numbers
-    rtl8139_bus = bus;
-    rtl8139_slot = slot;
-    
+static bool rtl8139_probe(struct pci_dev *dev, const struct pci_device_id *id) {
+    (void)id;
+    // 协议栈只使用一块网卡
+    if (netdev_get_default()) {
+        return false;
+    }
+
     terminal_writestring("\n=== RTL8139 Initialization ===\n");
     serial_write_string("\r\n=== RTL8139 Initialization ===\r\n");
-    serial_write_string("RTL8139: Debug output enabled status: ");
-    serial_write_string(disable_rtl_debug ? "OFF (disable_rtl_debug=true)\r\n" : "ON (disable_rtl_debug=false)\r\n");
-    
-    // 获取RTL8139的I/O基地址
-    iobase = get_rtl8139_iobase(bus, slot);
+    serial_write_string("RTL8139: Debug output: ");
+    serial_write_string(LOG_ENABLED(RTL, KLOG_DEBUG) ? "ON\r\n" : "OFF\r\n");
+    
+    // 获取RTL8139的I/O基地址，启用I/O译码和总线主控 (接收DMA)
+    iobase = pci_iobase(dev);
+    if (!iobase) {
+        terminal_writestring("RTL8139: no I/O BAR\n");
+        return false;
+    }
+    pci_enable_device(dev, PCI_COMMAND_IO | PCI_COMMAND_MASTER | PCI_COMMAND_PERR);
     
     terminal_writestring("RTL8139 I/O Base: 0x");
     terminal_writehex16(iobase);
@@ -46,39 +105,18 @@ void rtl8139_init(uint16_t bus, uint16_t slot) {
     serial_write_string("\r\n");
     
     // 配置中断
-    pci_configure_interrupt(bus, slot, 11);  // IRQ 11 是常用的网卡中断
-
-    // 分配接收缓冲区
-    rx_buffer = (uint8_t *)kmalloc(RX_BUFFER_SIZE + 16);
-    if (!rx_buffer) {
-        terminal_writestring("Failed to allocate RX buffer\n");
-        return;
-    }
-
-    terminal_writestring("RX buffer allocated at: ");
-    terminal_writehex((uint32_t)rx_buffer);
-    terminal_writestring("\n");
+    pci_set_irq_line(dev, 11);  // IRQ 11 是常用的网卡中断
 
     // 电源管理唤醒
     terminal_writestring("Power management wake up...\n");
     outb(iobase + 0x52, 0x00);  // 修正为写入0x00
-    rtl8139_delay();
 
-    // 软件复位
+    // 软件复位，轮询复位位清零 (端口写是非投递的，写后不需要延时)
     terminal_writestring("Performing software reset...\n");
     outb(iobase + RTL8139_REG_CMD, RTL8139_CMD_RESET);
-    rtl8139_delay();
-
-    // 等待复位完成
-    terminal_writestring("Waiting for reset completion...\n");
-    int timeout = 1000;
-    while ((inb(iobase + RTL8139_REG_CMD) & RTL8139_CMD_RESET) != 0) {
-        rtl8139_delay();
-        timeout--;
-        if (timeout <= 0) {
-            terminal_writestring("RTL8139 reset timeout!\n");
-            return;
-        }
+    if (!rtl8139_wait_cmd(RTL8139_CMD_RESET, 0, RTL8139_RESET_TIMEOUT_US)) {
+        terminal_writestring("RTL8139 reset timeout!\n");
+        return false;
     }
 
     terminal_writestring("RTL8139 reset completed successfully\n");
@@ -88,7 +126,7 @@ void rtl8139_init(uint16_t bus, uint16_t slot) {
     rx_buffer = (uint8_t *)kmalloc(RX_BUFFER_SIZE + 16);
     if (!rx_buffer) {
         terminal_writestring("Failed to allocate RX buffer\n");
-        return;
+        return false;
     }
     
     // 确保16字节对齐
@@ -98,7 +136,6 @@ void rtl8139_init(uint16_t bus, uint16_t slot) {
     }
     
     outl(iobase + RTL8139_REG_RBSTART, rx_buffer_phys);
-    rtl8139_delay();
 
     // 设置IMR和ISR
     terminal_writestring("Setting up interrupts...\n");
@@ -110,7 +147,6 @@ void rtl8139_init(uint16_t bus, uint16_t slot) {
     outw(iobase + RTL8139_REG_IMR, RTL8139_ISR_ROK | RTL8139_ISR_TOK | 
                                    RTL8139_ISR_RER | RTL8139_ISR_TER);
     outw(iobase + RTL8139_REG_ISR, 0xFFFF);  // 清除所有中断
-    rtl8139_delay();
 
     terminal_writestring("IMR set to: ");
     terminal_writehex16(inw(iobase + RTL8139_REG_IMR));
@@ -129,7 +165,6 @@ void rtl8139_init(uint16_t bus, uint16_t slot) {
                          RTL8139_RCR_MXDMA_UNLIMITED;  // 无限制 DMA 突发
     
     outl(iobase + RTL8139_REG_RCR, rcr_config);
-    rtl8139_delay();
     
     // 验证RCR配置
     uint32_t rcr_verify = inl(iobase + RTL8139_REG_RCR);
@@ -143,7 +178,6 @@ void rtl8139_init(uint16_t bus, uint16_t slot) {
                          RTL8139_TCR_CRC;            // 追加 CRC
     
     outl(iobase + RTL8139_REG_TCR, tcr_config);
-    rtl8139_delay();
     
     // 验证TCR配置
     uint32_t tcr_verify = inl(iobase + RTL8139_REG_TCR);
@@ -154,21 +188,28 @@ void rtl8139_init(uint16_t bus, uint16_t slot) {
     // 启用发送和接收
     terminal_writestring("Enabling RX/TX...\n");
     outb(iobase + RTL8139_REG_CMD, RTL8139_CMD_RX_ENABLE | RTL8139_CMD_TX_ENABLE);
-    rtl8139_delay();
 
     // 验证网卡状态
-    uint8_t cmd = inb(iobase + RTL8139_REG_CMD);
+    bool enabled = rtl8139_wait_cmd(RTL8139_CMD_RX_ENABLE | RTL8139_CMD_TX_ENABLE,
+                                    RTL8139_CMD_RX_ENABLE | RTL8139_CMD_TX_ENABLE,
+                                    RTL8139_ENABLE_TIMEOUT_US);
     terminal_writestring("Command register after enable: ");
-    terminal_writehex8(cmd);
+    terminal_writehex8(inb(iobase + RTL8139_REG_CMD));
     terminal_writestring("\n");
     
-    if ((cmd & (RTL8139_CMD_RX_ENABLE | RTL8139_CMD_TX_ENABLE)) != 
-        (RTL8139_CMD_RX_ENABLE | RTL8139_CMD_TX_ENABLE)) {
+    if (!enabled) {
         terminal_writestring("RTL8139 failed to enable RX/TX!\n");
-        return;
+        return false;
     }
 
     terminal_writestring("RTL8139 initialized successfully\n");
+
+    // 读取MAC地址并注册网络设备
+    for (int i = 0; i < 6; i++) {
+        rtl8139_netdev.mac_addr[i] = inb(iobase + RTL8139_REG_IDR0 + i);
+    }
+    netdev_register(&rtl8139_netdev);
+
     terminal_writestring("=== Final Register State ===\n");
     rtl8139_dump_registers();
     terminal_writestring("===========================\n\n");
@@ -210,372 +251,202 @@ void rtl8139_init(uint16_t bus, uint16_t slot) {
 
     rtl8139_send_packet(test_data, sizeof(test_data));
     terminal_writestring("Test packet sent\n");
+    return true;
+}
+
+// netdev 发送回调 (RTL8139 没有卸载能力，meta 总是 NULL)
+static bool rtl8139_netdev_xmit(struct netdev *dev, const struct netdev_frag *frags, int nfrags,
+                                uint16_t length, const struct netdev_tx_meta *meta) {
+    (void)dev;
+    (void)meta;
+    return rtl8139_send_frags(frags, nfrags, length);
+}
+
+// netdev 预留回调: 直接返回下一个发送槽位，协议层在其中构造帧
+static uint8_t *rtl8139_netdev_tx_reserve(struct netdev *dev, uint16_t length) {
+    (void)dev;
+    if (length > TX_BUFFER_SIZE || !rtl8139_tx_slot_ready(current_tx_buffer)) {
+        return NULL;
+    }
+    return tx_buffer[current_tx_buffer];
+}
+
+// netdev 提交回调: 槽位中的帧已就绪，启动发送
+static bool rtl8139_netdev_tx_commit(struct netdev *dev, uint16_t length,
+                                     const struct netdev_tx_meta *meta) {
+    (void)dev;
+    (void)meta;
+    rtl8139_tx_kick(length);
+    return true;
+}
+
+// netdev 轮询回调
+static void rtl8139_netdev_poll(struct netdev *dev) {
+    (void)dev;
+    check_rx_buffer();
 }
 
 // 获取RTL8139的I/O基地址
-uint16_t get_rtl8139_iobase(uint16_t bus, uint16_t slot) {
-    return pci_get_iobase(bus, slot);
+uint16_t get_rtl8139_iobase(void) {
+    return iobase;
 }
 
 // 发送数据包
 void rtl8139_send_packet(const void* data, uint16_t length) {
-    if (!disable_rtl_debug) {
-        terminal_writestring("RTL8139: Sending packet, length = ");
-        terminal_writedec(length);
-        terminal_writestring("\n");
-        
-        serial_write_string("RTL8139: Sending packet, length = ");
-        serial_write_dec(length);
-        serial_write_string("\r\n");
-    }
-
-    // 检查是否禁用调试输出
-    if (!disable_rtl_debug) {
-        terminal_writestring("\n=== Sending Packet [DEBUG] ===\n");
-        terminal_writestring("Length: ");
-        terminal_writehex16(length);
-        terminal_writestring("\nPacket Data (First 64 bytes): ");
-        
-        // 打印数据包内容
-        const uint8_t* packet = (const uint8_t*)data;
-        for(int i = 0; i < length && i < 64; i++) {
-            if(i % 16 == 0) terminal_writestring("\n");
-            terminal_writehex8(packet[i]);
-            terminal_writestring(" ");
-        }
-        terminal_writestring("\n");
-
-        // 解析以太网头部
-        if (length >= 14) {
-            terminal_writestring("\nEthernet Header:\n");
-            terminal_writestring("  Dest MAC: ");
-            for (int i = 0; i < 6; i++) {
-                terminal_writehex8(packet[i]);
-                if (i < 5) terminal_writestring(":");
-            }
-            terminal_writestring("\n  Src MAC: ");
-            for (int i = 0; i < 6; i++) {
-                terminal_writehex8(packet[i+6]);
-                if (i < 5) terminal_writestring(":");
-            }
-            terminal_writestring("\n  Type: ");
-            terminal_writehex8(packet[12]);
-            terminal_writehex8(packet[13]);
-            terminal_writestring("\n");
-        }
+    struct netdev_frag frag = { data, length };
+    rtl8139_send_frags(&frag, 1, length);
+}
 
-        // 解析IP头部
-        if (length >= 34 && packet[12] == 0x08 && packet[13] == 0x00) {
-            terminal_writestring("\nIP Header:\n");
-            terminal_writestring("  Version/IHL: ");
-            terminal_writehex8(packet[14]);
-            terminal_writestring("\n  Total Length: ");
-            terminal_writehex8(packet[16]);
-            terminal_writehex8(packet[17]);
-            terminal_writestring("\n  Protocol: ");
-            terminal_writehex8(packet[23]);
-            terminal_writestring("\n  Checksum: ");
-            terminal_writehex8(packet[24]);
-            terminal_writehex8(packet[25]);
-            terminal_writestring("\n  Src IP: ");
-            for (int i = 0; i < 4; i++) {
-                terminal_writehex8(packet[26+i]);
-                if (i < 3) terminal_writestring(".");
-            }
-            terminal_writestring("\n  Dest IP: ");
-            for (int i = 0; i < 4; i++) {
-                terminal_writehex8(packet[30+i]);
-                if (i < 3) terminal_writestring(".");
+// 等待发送槽位可用: 硬件读完缓冲区后置 OWN 位 (发送中止时置 TABT)
+static bool rtl8139_tx_slot_ready(uint8_t index) {
+    if (!tx_pending[index]) {
+        return true;
+    }
+    uint64_t deadline = tsc_read() + tsc_from_us(RTL8139_TX_TIMEOUT_US);
+    do {
+        uint32_t tsd = inl(iobase + RTL8139_REG_TSD0 + index * 4);
+        if (tsd & (RTL8139_TSD_OWN | RTL8139_TSD_TABT)) {
+            if (tsd & RTL8139_TSD_TABT) {
+                NETSTATS_INC(link, tx_aborts);
             }
-            terminal_writestring("\n");
+            tx_pending[index] = false;
+            TRACE(TRACE_TX_COMPLETE, index, 0, 0);
+            return true;
         }
-    }
+        cpu_relax();
+    } while (tsc_read() < deadline);
+    NETSTATS_INC(link, tx_timeouts);
+    return false;
+}
 
+// 发送分片组成的数据包: 芯片没有聚集DMA，分片依次复制到发送槽位
+bool rtl8139_send_frags(const struct netdev_frag *frags, int nfrags, uint16_t length) {
     // 处理发送包太大的情况
     if (length > TX_BUFFER_SIZE) {
-        if (!disable_rtl_debug) {
-            terminal_writestring("ERROR: Packet too large!\n");
-        }
-        return;
+        LOG_WARN(RTL, "packet too large (%u bytes)", length);
+        return false;
+    }
+    if (!rtl8139_tx_slot_ready(current_tx_buffer)) {
+        LOG_WARN(RTL, "TX slot %u still owned by hardware", current_tx_buffer);
+        return false;
     }
 
     // 复制数据到发送缓冲区
-    if (!disable_rtl_debug) {
-        terminal_writestring("Copying data to TX buffer ");
-        terminal_writehex8(current_tx_buffer);
-        terminal_writestring("...\n");
-    }
-    
-    const uint8_t* packet = (const uint8_t*)data;
-    for (int i = 0; i < length; i++) {
-        tx_buffer[current_tx_buffer][i] = packet[i];
+    uint8_t *slot = tx_buffer[current_tx_buffer];
+    uint16_t offset = 0;
+    for (int i = 0; i < nfrags; i++) {
+        memcpy(slot + offset, frags[i].data, frags[i].length);
+        offset += frags[i].length;
     }
 
-    // 设置发送描述符 - 使用缓冲区的物理地址
-    if (!disable_rtl_debug) {
-        terminal_writestring("Setting TSAD: ");
-        terminal_writehex8(current_tx_buffer);
-        terminal_writestring(" to address: ");
-        terminal_writehex32((uint32_t)tx_buffer[current_tx_buffer]);
-        terminal_writestring("\n");
+    rtl8139_tx_kick(length);
+    return true;
+}
+
+// 调试模式下同步等待槽位发送完成，便于观察发送状态
+static void rtl8139_tx_debug_wait(uint8_t index) {
+    uint64_t deadline = tsc_read() + tsc_from_us(RTL8139_TX_TIMEOUT_US);
+    uint32_t tsd = inl(iobase + RTL8139_REG_TSD0 + index * 4);
+    while (!(tsd & (RTL8139_TSD_TOK | RTL8139_TSD_TABT)) && tsc_read() < deadline) {
+        cpu_relax();
+        tsd = inl(iobase + RTL8139_REG_TSD0 + index * 4);
     }
-    
-    // 设置发送描述符地址寄存器
-    outl(iobase + RTL8139_REG_TSAD0 + (current_tx_buffer * 4), (uint32_t)tx_buffer[current_tx_buffer]);
-    
-    // 验证TSAD设置
-    if (!disable_rtl_debug) {
-        uint32_t tsad_verify = inl(iobase + RTL8139_REG_TSAD0 + (current_tx_buffer * 4));
-        terminal_writestring("Verified TSAD");
-        terminal_writehex8(current_tx_buffer);
-        terminal_writestring(": ");
-        terminal_writehex32(tsad_verify);
-        terminal_writestring("\n");
-        
-        terminal_writestring("Setting TSD: ");
-        terminal_writehex8(current_tx_buffer);
-        terminal_writestring(" with length: ");
-        terminal_writehex16(length);
-        terminal_writestring("\n");
+
+    if (tsd & RTL8139_TSD_TABT) {
+        LOG_WARN(RTL, "TSD%u: transmission aborted", index);
     }
-    
-    // 设置发送状态描述符寄存器，启动传输
-    // 确保使用正确的配置位：长度字段应该是前16位
-    uint32_t tsd_value = length;  // 长度在低16位，其他配置位
-    
-    if (!disable_rtl_debug) {
-        terminal_writestring("TSD raw value to set: ");
-        terminal_writehex32(tsd_value);
-        terminal_writestring("\n");
+    if (tsd & RTL8139_TSD_TUN) {
+        LOG_WARN(RTL, "TSD%u: transmit underrun", index);
     }
-    
-    outl(iobase + RTL8139_REG_TSD0 + (current_tx_buffer * 4), tsd_value);
-
-    // 立即验证TSD设置
-    if (!disable_rtl_debug) {
-        uint32_t tsd_verify = inl(iobase + RTL8139_REG_TSD0 + (current_tx_buffer * 4));
-        terminal_writestring("Verified TSD raw value: ");
-        terminal_writehex32(tsd_verify);
-        terminal_writestring("\n");
-        
-        terminal_writestring("Packet queued for transmission\n");
-        terminal_writestring("TSD");
-        terminal_writehex8(current_tx_buffer);
-        terminal_writestring(" after setting: ");
-        terminal_writehex32(inl(iobase + RTL8139_REG_TSD0 + (current_tx_buffer * 4)));
-        terminal_writestring("\n");
+    if (!(tsd & (RTL8139_TSD_TOK | RTL8139_TSD_TABT))) {
+        LOG_WARN(RTL, "TSD%u: transmission timeout (0x%08x)", index, tsd);
+    } else {
+        LOG_DEBUG(RTL, "TSD%u: completed 0x%08x%s%s%s", index, tsd,
+                  (tsd & RTL8139_TSD_TOK) ? " TOK" : "",
+                  (tsd & RTL8139_TSD_TUN) ? " TUN" : "",
+                  (tsd & RTL8139_TSD_TABT) ? " TABT" : "");
     }
 
-    // 更新发送缓冲区索引
-    current_tx_buffer = (current_tx_buffer + 1) % 4;
+    // 打印最终的寄存器状态
+    rtl8139_dump_registers();
+}
 
-    // 等待发送完成
-    if (!disable_rtl_debug) {
-        terminal_writestring("Waiting for transmission to complete...\n");
-    }
-    
-    uint32_t tsd = inl(iobase + RTL8139_REG_TSD0 + ((current_tx_buffer - 1) % 4) * 4);
-    int timeout = 1000;
-    while (!(tsd & RTL8139_TSD_TOK) && timeout > 0) {
-        rtl8139_delay();
-        tsd = inl(iobase + RTL8139_REG_TSD0 + ((current_tx_buffer - 1) % 4) * 4);
-        
-        if (!disable_rtl_debug && timeout % 100 == 0) {
-            terminal_writestring("TSD during wait: ");
-            terminal_writehex32(tsd);
-            terminal_writestring(" [");
-            if (tsd & RTL8139_TSD_TOK) terminal_writestring(" TOK");
-            if (tsd & RTL8139_TSD_TUN) terminal_writestring(" TUN");
-            if (tsd & RTL8139_TSD_TABT) terminal_writestring(" TABT");
-            terminal_writestring(" ]\n");
-        }
-        
-        timeout--;
-        
-        // 检查是否有发送错误
-        if (tsd & RTL8139_TSD_TABT) {
-            if (!disable_rtl_debug) {
-                terminal_writestring("ERROR: Transmission aborted!\n");
-            }
-            break;
-        }
-        if (tsd & RTL8139_TSD_TUN) {
-            if (!disable_rtl_debug) {
-                terminal_writestring("ERROR: Transmit underrun!\n");
-            }
-            break;
-        }
+// 把当前槽位中已构造好的帧交给硬件，不等待发送完成
+static void rtl8139_tx_kick(uint16_t length) {
+    uint8_t index = current_tx_buffer;
+    const uint8_t *packet = tx_buffer[index];
+
+    LOG_DEBUG(RTL, "tx slot %u len %u", index, length);
+    LOG_HEX(RTL, KLOG_DEBUG, "tx", packet, length < 32 ? length : 32);
+    if (length >= 14) {
+        LOG_DEBUG(RTL, "tx eth " MAC_FMT " -> " MAC_FMT " type 0x%02x%02x",
+                  MAC_ARGS(packet + 6), MAC_ARGS(packet), packet[12], packet[13]);
     }
 
-    if (!disable_rtl_debug) {
-        if (timeout == 0) {
-            terminal_writestring("ERROR: Transmission timeout!\n");
-        } else {
-            terminal_writestring("Transmission completed\n");
-            terminal_writestring("Final TSD value: ");
-            terminal_writehex32(tsd);
-            terminal_writestring(" [");
-            if (tsd & RTL8139_TSD_TOK) terminal_writestring(" TOK");
-            if (tsd & RTL8139_TSD_TUN) terminal_writestring(" TUN");
-            if (tsd & RTL8139_TSD_TABT) terminal_writestring(" TABT");
-            terminal_writestring(" ]\n");
-        }
+    // 设置发送描述符地址寄存器 - 使用缓冲区的物理地址
+    outl(iobase + RTL8139_REG_TSAD0 + (index * 4), (uint32_t)tx_buffer[index]);
+
+    // 设置发送状态描述符寄存器，启动传输
+    // 确保使用正确的配置位：长度字段应该是前16位
+    uint32_t tsd_value = length;  // 长度在低16位，其他配置位
+    outl(iobase + RTL8139_REG_TSD0 + (index * 4), tsd_value);
+
+    LOG_DEBUG(RTL, "TSAD%u 0x%08x TSD%u 0x%08x", index,
+              inl(iobase + RTL8139_REG_TSAD0 + (index * 4)), index,
+              inl(iobase + RTL8139_REG_TSD0 + (index * 4)));
+
+    // 更新发送缓冲区索引; 槽位在下次使用前才检查是否完成
+    tx_pending[index] = true;
+    current_tx_buffer = (current_tx_buffer + 1) % 4;
 
-        // 打印最终的寄存器状态
-        rtl8139_dump_registers();
-        terminal_writestring("=== Sending Packet End ===\n");
+    if (LOG_ENABLED(RTL, KLOG_DEBUG)) {
+        rtl8139_tx_debug_wait(index);
     }
 }
 
 // 处理中断
 void rtl8139_handle_interrupt(void) {
-    terminal_writestring("\n=== RTL8139 Interrupt [DEBUG] ===\n");
-    
     // 读取中断状态寄存器
     uint16_t status = inw(iobase + RTL8139_REG_ISR);
-    
-    if (!disable_rtl_debug) {
-        terminal_writestring("RTL8139: Interrupt, status = 0x");
-        terminal_writehex16(status);
-        terminal_writestring("\n");
-        
-        serial_write_string("RTL8139: Interrupt, status = 0x");
-        serial_write_hex16(status);
-        serial_write_string("\r\n");
-    }
 
-    terminal_writestring("ISR Status: ");
-    terminal_writehex16(status);
-    terminal_writestring(" [");
-    if (status & RTL8139_ISR_ROK) terminal_writestring(" ROK");
-    if (status & RTL8139_ISR_TOK) terminal_writestring(" TOK");
-    if (status & RTL8139_ISR_RER) terminal_writestring(" RER");
-    if (status & RTL8139_ISR_TER) terminal_writestring(" TER");
-    terminal_writestring(" ]\n");
-
-    // 读取命令寄存器状态
-    uint8_t cmd = inb(iobase + RTL8139_REG_CMD);
-    terminal_writestring("CMD Status: ");
-    terminal_writehex8(cmd);
-    terminal_writestring(" [");
-    if (cmd & RTL8139_CMD_RX_ENABLE) terminal_writestring(" RX_EN");
-    if (cmd & RTL8139_CMD_TX_ENABLE) terminal_writestring(" TX_EN");
-    terminal_writestring(" ]\n");
+    LOG_DEBUG(RTL, "interrupt ISR 0x%04x%s%s%s%s CMD 0x%02x", status,
+              (status & RTL8139_ISR_ROK) ? " ROK" : "",
+              (status & RTL8139_ISR_TOK) ? " TOK" : "",
+              (status & RTL8139_ISR_RER) ? " RER" : "",
+              (status & RTL8139_ISR_TER) ? " TER" : "",
+              inb(iobase + RTL8139_REG_CMD));
 
     if (status & RTL8139_ISR_ROK) {
-        if (!disable_rtl_debug) {
-            terminal_writestring("RTL8139: Packet received\n");
-            serial_write_string("RTL8139: Packet received\r\n");
-        }
         check_rx_buffer();
-    } else {
-        terminal_writestring("No packet received (ROK not set)\n");
     }
 
-    if (status & RTL8139_ISR_TOK) {
-        if (!disable_rtl_debug) {
-            terminal_writestring("RTL8139: Packet transmitted\n");
-            serial_write_string("RTL8139: Packet transmitted\r\n");
-        }
-        
+    if ((status & RTL8139_ISR_TOK) && LOG_ENABLED(RTL, KLOG_DEBUG)) {
         // 检查所有发送描述符的状态
         for (int i = 0; i < 4; i++) {
-            uint32_t tsd = inl(iobase + RTL8139_REG_TSD0 + (i * 4));
-            terminal_writestring("TSD");
-            terminal_writehex8(i);
-            terminal_writestring(": ");
-            terminal_writehex32(tsd);
-            terminal_writestring(" [");
-            if (tsd & RTL8139_TSD_TOK) terminal_writestring(" TOK");
-            if (tsd & RTL8139_TSD_TUN) terminal_writestring(" TUN");
-            if (tsd & RTL8139_TSD_TABT) terminal_writestring(" TABT");
-            terminal_writestring(" ]\n");
+            LOG_DEBUG(RTL, "TSD%d 0x%08x", i, inl(iobase + RTL8139_REG_TSD0 + (i * 4)));
         }
-    } else {
-        terminal_writestring("No packet transmitted (TOK not set)\n");
     }
 
     if (status & RTL8139_ISR_RER) {
-        terminal_writestring("Receive error detected (RER set)\n");
+        LOG_WARN(RTL, "receive error (ISR 0x%04x)", status);
     }
-
     if (status & RTL8139_ISR_TER) {
-        terminal_writestring("Transmit error detected (TER set)\n");
+        LOG_WARN(RTL, "transmit error (ISR 0x%04x)", status);
     }
 
     // 清除中断状态
-    terminal_writestring("Clearing interrupt status: ");
-    terminal_writehex16(status);
-    terminal_writestring("\n");
     outw(iobase + RTL8139_REG_ISR, status);
-    
-    // 验证中断已清除
-    uint16_t new_status = inw(iobase + RTL8139_REG_ISR);
-    terminal_writestring("New ISR Status: ");
-    terminal_writehex16(new_status);
-    terminal_writestring("\n");
-    
-    terminal_writestring("Interrupt handled\n");
-    terminal_writestring("=== RTL8139 Interrupt End ===\n");
 }
 
 // 检查接收缓冲区
 void check_rx_buffer(void) {
-    if (disable_rtl_debug) {
-        // 仍然检查接收缓冲区，但不输出调试信息
-        uint16_t capr = inw(iobase + RTL8139_REG_CAPR);
-        uint16_t cbr = inw(iobase + RTL8139_REG_CBR);
-        
-        // 计算可用数据量
-        uint16_t bytes_avail = 0;
-        if (cbr >= capr) {
-            bytes_avail = cbr - capr;
-        } else {
-            bytes_avail = RX_BUFFER_SIZE + cbr - capr;
-        }
-        
-        // 只有当有数据可用时继续
-        if (bytes_avail > 0) {
-            uint16_t rx_offset = capr + 16;  // 当前CAPR加上帧头大小
-            if (rx_offset >= RX_BUFFER_SIZE) rx_offset -= RX_BUFFER_SIZE;
-            
-            // 读取帧状态和大小
-            uint16_t rx_status = *(uint16_t *)(rx_buffer + rx_offset);
-            uint16_t rx_size = *(uint16_t *)(rx_buffer + rx_offset + 2);
-            
-            // 如果有数据 (ROK 位被设置)，处理数据
-            if ((rx_status & 0x1) == 0x1) {
-                uint8_t *packet = rx_buffer + rx_offset + 4;  // 指向数据部分
-                
-                // 简单调试信息输出到串口
-                serial_write_string("RX packet detected, processing...\r\n");
-                
-                // 处理数据包
-                handle_network_packet(packet, rx_size - 4);
-                
-                // 更新CAPR
-                rx_offset = (rx_offset + rx_size + 4 + 3) & ~3;  // 对齐到4字节边界
-                if (rx_offset >= RX_BUFFER_SIZE) rx_offset = rx_offset - RX_BUFFER_SIZE + 16;
-                outw(iobase + RTL8139_REG_CAPR, rx_offset - 16);  // 更新CAPR
-            }
-        }
-        return;
-    }
-    
-    // 显示调试信息
-    terminal_writestring("\n=== Checking RX Buffer [DEBUG] ===\n");
-    
+    uint64_t found_tsc = tsc_read();
+    REGION_BEGIN(rx_parse);
+
     // 读取CAPR和CBR寄存器
     uint16_t capr = inw(iobase + RTL8139_REG_CAPR);
     uint16_t cbr = inw(iobase + RTL8139_REG_CBR);
-    
-    terminal_writestring("CAPR (Read Pointer): ");
-    terminal_writehex16(capr);
-    terminal_writestring("\nCBR (Write Pointer): ");
-    terminal_writehex16(cbr);
-    terminal_writestring("\nRX Buffer Physical Address: ");
-    terminal_writehex32((uint32_t)rx_buffer);
-    
+
     // 计算可用数据量
     uint16_t bytes_avail = 0;
     if (cbr >= capr) {
@@ -583,133 +454,78 @@ void check_rx_buffer(void) {
     } else {
         bytes_avail = RX_BUFFER_SIZE + cbr - capr;
     }
-    
-    terminal_writestring("\nAvailable data in buffer: ");
-    terminal_writehex16(bytes_avail);
-    terminal_writestring(" bytes\n");
-    
-    // 检查是否有数据
-    if (bytes_avail > 0) {
-        // 有数据，处理它
-        uint16_t rx_offset = capr + 16;  // 当前CAPR加上帧头大小
-        if (rx_offset >= RX_BUFFER_SIZE) rx_offset -= RX_BUFFER_SIZE;
-        
-        // 读取帧状态和大小
-        uint16_t rx_status = *(uint16_t *)(rx_buffer + rx_offset);
-        uint16_t rx_size = *(uint16_t *)(rx_buffer + rx_offset + 2);
-        
-        terminal_writestring("Received packet: Status=0x");
-        terminal_writehex16(rx_status);
-        terminal_writestring(", Size=");
-        terminal_writehex16(rx_size);
-        terminal_writestring("\n");
-        
-        // 检查状态
-        if ((rx_status & 0x1) == 0x1) {  // ROK 位被设置
-            terminal_writestring("Valid packet received\n");
-            uint8_t *packet = rx_buffer + rx_offset + 4;  // 指向数据部分
-            
-            // 显示前几个字节
-            terminal_writestring("Packet data (first 16 bytes): ");
-            for (int i = 0; i < 16 && i < rx_size; i++) {
-                terminal_writehex8(packet[i]);
-                terminal_writestring(" ");
-            }
-            terminal_writestring("\n");
-            
-            // 处理数据包
-            handle_network_packet(packet, rx_size - 4);
-            
-            // 更新CAPR
-            rx_offset = (rx_offset + rx_size + 4 + 3) & ~3;  // 对齐到4字节边界
-            if (rx_offset >= RX_BUFFER_SIZE) rx_offset = rx_offset - RX_BUFFER_SIZE + 16;
-            outw(iobase + RTL8139_REG_CAPR, rx_offset - 16);  // 更新CAPR
-        } else {
-            terminal_writestring("Invalid packet received\n");
-        }
-    } else {
-        terminal_writestring("No new data in RX buffer\n");
+
+    LOG_DEBUG(RTL, "rx CAPR 0x%04x CBR 0x%04x avail %u", capr, cbr, bytes_avail);
+
+    // 只有当有数据可用时继续
+    if (bytes_avail == 0) {
+        return;
     }
-    
-    terminal_writestring("=== Checking RX Buffer End ===\n");
+
+    uint16_t rx_offset = capr + 16;  // 当前CAPR加上帧头大小
+    if (rx_offset >= RX_BUFFER_SIZE) rx_offset -= RX_BUFFER_SIZE;
+
+    // 读取帧状态和大小
+    uint16_t rx_status = *(uint16_t *)(rx_buffer + rx_offset);
+    uint16_t rx_size = *(uint16_t *)(rx_buffer + rx_offset + 2);
+
+    // 如果有数据 (ROK 位被设置)，处理数据
+    if ((rx_status & 0x1) != 0x1) {
+        NETSTATS_INC(link, rx_errors);
+        LOG_WARN(RTL, "invalid rx frame status 0x%04x size %u", rx_status, rx_size);
+        return;
+    }
+
+    uint8_t *packet = rx_buffer + rx_offset + 4;  // 指向数据部分
+    LOG_DEBUG(RTL, "rx %u bytes", (uint32_t)(rx_size - 4));
+    LOG_HEX(RTL, KLOG_DEBUG, "rx", packet, rx_size < 16 ? rx_size : 16);
+
+    // 处理数据包
+    REGION_END(REGION_RX_PARSE, rx_parse);
+    netlat_rx_arrival(found_tsc);
+    handle_network_packet(packet, rx_size - 4);
+
+    // 更新CAPR
+    rx_offset = (rx_offset + rx_size + 4 + 3) & ~3;  // 对齐到4字节边界
+    if (rx_offset >= RX_BUFFER_SIZE) rx_offset = rx_offset - RX_BUFFER_SIZE + 16;
+    outw(iobase + RTL8139_REG_CAPR, rx_offset - 16);  // 更新CAPR
 }
 
-// 打印RTL8139寄存器状态
+// 打印RTL8139寄存器状态 (仅RTL调试级别)
 void rtl8139_dump_registers(void) {
-    if (disable_rtl_debug) return;  // 如果禁用调试，直接返回
-    
-    terminal_writestring("\n=== RTL8139 Register Dump ===\n");
-    terminal_writestring("CMD: 0x");
-    terminal_writehex8(inb(iobase + RTL8139_REG_CMD));
-    terminal_writestring(" [ ");
-    if (inb(iobase + RTL8139_REG_CMD) & 0x08) terminal_writestring("TX_EN ");
-    if (inb(iobase + RTL8139_REG_CMD) & 0x04) terminal_writestring("RX_EN ");
-    terminal_writestring("]\n");
-    
-    // 显示ISR和IMR状态
+    if (!LOG_ENABLED(RTL, KLOG_DEBUG)) {
+        return;
+    }
+
+    uint8_t cmd = inb(iobase + RTL8139_REG_CMD);
     uint16_t isr = inw(iobase + RTL8139_REG_ISR);
-    terminal_writestring("ISR: 0x");
-    terminal_writehex16(isr);
-    terminal_writestring(" [ ");
-    if (isr & RTL8139_ISR_ROK) terminal_writestring("ROK ");
-    if (isr & RTL8139_ISR_TOK) terminal_writestring("TOK ");
-    terminal_writestring("]\n");
-    
     uint16_t imr = inw(iobase + RTL8139_REG_IMR);
-    terminal_writestring("IMR: 0x");
-    terminal_writehex16(imr);
-    terminal_writestring(" [ ");
-    if (imr & RTL8139_ISR_ROK) terminal_writestring("ROK ");
-    if (imr & RTL8139_ISR_TOK) terminal_writestring("TOK ");
-    terminal_writestring("]\n");
-    
-    // 显示RCR状态
     uint32_t rcr = inl(iobase + RTL8139_REG_RCR);
-    terminal_writestring("RCR: 0x");
-    terminal_writehex32(rcr);
-    terminal_writestring(" [ ");
-    if (rcr & RTL8139_RCR_AAP) terminal_writestring("AAP ");
-    if (rcr & RTL8139_RCR_APM) terminal_writestring("APM ");
-    if (rcr & RTL8139_RCR_AM) terminal_writestring("AM ");
-    if (rcr & RTL8139_RCR_AB) terminal_writestring("AB ");
-    if (rcr & RTL8139_RCR_WRAP) terminal_writestring("WRAP ");
-    terminal_writestring("]\n");
-    
+    LOG_DEBUG(RTL, "CMD 0x%02x%s%s ISR 0x%04x IMR 0x%04x", cmd,
+              (cmd & RTL8139_CMD_TX_ENABLE) ? " TX_EN" : "",
+              (cmd & RTL8139_CMD_RX_ENABLE) ? " RX_EN" : "", isr, imr);
+    LOG_DEBUG(RTL, "RCR 0x%08x%s%s%s%s%s", rcr,
+              (rcr & RTL8139_RCR_AAP) ? " AAP" : "",
+              (rcr & RTL8139_RCR_APM) ? " APM" : "",
+              (rcr & RTL8139_RCR_AM) ? " AM" : "",
+              (rcr & RTL8139_RCR_AB) ? " AB" : "",
+              (rcr & RTL8139_RCR_WRAP) ? " WRAP" : "");
+
     // 显示传输状态寄存器
     for (int i = 0; i < 4; i++) {
         uint32_t tsd = inl(iobase + RTL8139_REG_TSD0 + i * 4);
-        terminal_writestring("TSD0x0");
-        terminal_writehex8(i);
-        terminal_writestring(": 0x");
-        terminal_writehex32(tsd);
-        terminal_writestring(" [ ");
-        if (tsd & RTL8139_TSD_TOK) terminal_writestring("TOK ");
-        if (tsd & RTL8139_TSD_TABT) terminal_writestring("TABT ");
-        terminal_writestring("] Size: 0x");
-        terminal_writehex16((tsd >> 16) & 0x1FFF);
-        terminal_writestring("\n");
+        LOG_DEBUG(RTL, "TSD%d 0x%08x%s%s size %u", i, tsd,
+                  (tsd & RTL8139_TSD_TOK) ? " TOK" : "",
+                  (tsd & RTL8139_TSD_TABT) ? " TABT" : "",
+                  (tsd >> 16) & 0x1FFF);
     }
-    
-    // 显示CAPR和CBR值
-    terminal_writestring("CAPR: 0x");
-    terminal_writehex16(inw(iobase + RTL8139_REG_CAPR));
-    terminal_writestring(" CBR: 0x");
-    terminal_writehex16(inw(iobase + RTL8139_REG_CBR));
-    terminal_writestring("\n");
-    
-    // 显示RBSTART值
-    terminal_writestring("RBSTART: 0x");
-    terminal_writehex32(inl(iobase + RTL8139_REG_RBSTART));
-    terminal_writestring("\n");
-    
-    // 显示MAC地址
-    terminal_writestring("MAC Address: ");
+
+    // 显示CAPR、CBR、RBSTART 和 MAC地址
+    uint8_t mac[6];
     for (int i = 0; i < 6; i++) {
-        terminal_writestring("0x");
-        terminal_writehex8(inb(iobase + RTL8139_REG_IDR0 + i));
-        if (i < 5) terminal_writestring(":");
+        mac[i] = inb(iobase + RTL8139_REG_IDR0 + i);
     }
-    terminal_writestring("\n");
-    
-    terminal_writestring("============================\n");
-}
\ No newline at end of file
+    LOG_DEBUG(RTL, "CAPR 0x%04x CBR 0x%04x RBSTART 0x%08x MAC " MAC_FMT,
+              inw(iobase + RTL8139_REG_CAPR), inw(iobase + RTL8139_REG_CBR),
+              inl(iobase + RTL8139_REG_RBSTART), MAC_ARGS(mac));
+}
@@ -2,6 +2,7 @@
 #define RTL8139_H
 
 #include "types.h"
+#include "netdev.h"
 
 // PCI 配置
 #define RTL8139_VENDOR_ID 0x10EC
@@ -47,27 +48,25 @@
 #define RTL8139_TCR_CRC           0x00010000  // 追加 CRC
 
 // 发送状态寄存器位
+#define RTL8139_TSD_TABT  0x40000000  // 发送中止
 #define RTL8139_TSD_TOK   0x00008000  // 发送 OK
 #define RTL8139_TSD_TUN   0x00004000  // 发送不足
-#define RTL8139_TSD_TABT  0x00002000  // 发送中止
+#define RTL8139_TSD_OWN   0x00002000  // 硬件已把数据读入FIFO，槽位可重用
 
 // 缓冲区大小
 #define RX_BUFFER_SIZE 32768
 #define TX_BUFFER_SIZE 1536
 
-// Global variables
-extern uint16_t rtl8139_bus;
-extern uint16_t rtl8139_slot;
-
-// 禁用调试标志
-extern bool disable_rtl_debug;
+// PCI驱动，由 kernel_main 注册
+struct pci_driver;
+extern struct pci_driver rtl8139_pci_driver;
 
 // Function declarations
-void rtl8139_init(uint16_t bus, uint16_t slot);
 void rtl8139_send_packet(const void* data, uint16_t length);
+bool rtl8139_send_frags(const struct netdev_frag *frags, int nfrags, uint16_t length);
 void rtl8139_handle_interrupt(void);
 void check_rx_buffer(void);
 void rtl8139_dump_registers(void);
-uint16_t get_rtl8139_iobase(uint16_t bus, uint16_t slot);
+uint16_t get_rtl8139_iobase(void);
 
 #endif 
\ No newline at end of file
@@ -1,55 +1,251 @@
 #include "serial.h"
 #include "terminal.h"
 #include "io.h"
+#include "irq.h"
+#include "cpu.h"
 
 // COM1串行端口地址
 #define COM1 0x3F8
 
+// 16550 寄存器偏移
+#define UART_DATA 0   // THR/RBR, DLAB=1 时为除数低字节
+#define UART_IER  1   // 中断使能, DLAB=1 时为除数高字节
+#define UART_IIR  2   // 中断标识 (读) / FIFO控制 (写)
+#define UART_LCR  3
+#define UART_MCR  4
+#define UART_LSR  5
+#define UART_MSR  6
+
+#define UART_IER_RDA   0x01  // 接收数据可用
+#define UART_IER_THRE  0x02  // 发送保持寄存器空
+#define UART_IER_RLS   0x04  // 接收线路状态
+
+#define UART_LSR_DR    0x01
+#define UART_LSR_THRE  0x20
+
+#define UART_IIR_NO_INT  0x01
+#define UART_IIR_ID_MASK 0x0E
+#define UART_IIR_MSI     0x00
+#define UART_IIR_THRI    0x02
+#define UART_IIR_RDI     0x04
+#define UART_IIR_RLSI    0x06
+#define UART_IIR_TIMEOUT 0x0C
+
+// FIFO 深度: THRE 表示整个FIFO为空，一次可以写入16字节
+#define UART_FIFO_SIZE 16
+#define UART_CLOCK 115200
+
+// 软件发送/接收队列 (大小为2的幂)
+static volatile char tx_queue[SERIAL_TX_QUEUE_SIZE];
+static volatile uint32_t tx_head = 0;   // 写入位置
+static volatile uint32_t tx_tail = 0;   // 发送位置
+static volatile char rx_queue[SERIAL_RX_QUEUE_SIZE];
+static volatile uint32_t rx_head = 0;
+static volatile uint32_t rx_tail = 0;
+
+static bool serial_irq_mode = false;
+static uint8_t serial_ier = 0;
+static uint32_t serial_outputs = SERIAL_OUT_UART;
+static uint32_t serial_baud = SERIAL_DEFAULT_BAUD;
+static struct serial_stats stats;
+
+// 设置波特率 (115200 的整数分频)
+static void serial_program_baud(uint32_t baud) {
+   uint16_t divisor = UART_CLOCK / baud;
+   uint8_t lcr = inb(COM1 + UART_LCR);
+   outb(COM1 + UART_LCR, lcr | 0x80);          // 设置DLAB位
+   outb(COM1 + UART_DATA, divisor & 0xFF);     // 除数低字节
+   outb(COM1 + UART_IER, divisor >> 8);        // 除数高字节
+   outb(COM1 + UART_LCR, lcr & ~0x80);
+}
+
 // 初始化串行端口
 void serial_init(void) {
    // 禁用所有中断
-   outb(COM1 + 1, 0x00);
-   
-   // 设置波特率
-   outb(COM1 + 3, 0x80);    // 设置DLAB位
-   outb(COM1 + 0, 0x03);    // 设置除数的低位: 38400 baud
-   outb(COM1 + 1, 0x00);    // 设置除数的高位
+   outb(COM1 + UART_IER, 0x00);
    
    // 8位数据位, 无奇偶校验, 1位停止位
-   outb(COM1 + 3, 0x03);
+   outb(COM1 + UART_LCR, 0x03);
+   serial_program_baud(serial_baud);
    
    // 启用FIFO，清除接收和发送FIFO，设置14字节阈值
-   outb(COM1 + 2, 0xC7);
-   
-   // 启用IRQ，设置回环模式以进行测试
-   outb(COM1 + 4, 0x0B);
+   outb(COM1 + UART_IIR, 0xC7);
    
    // 测试串行芯片（设置回环模式）
-   outb(COM1 + 4, 0x1E);
-   outb(COM1 + 0, 0xAE);   // 发送测试字节
+   outb(COM1 + UART_MCR, 0x1E);
+   outb(COM1 + UART_DATA, 0xAE);   // 发送测试字节
    
    // 检查是否收到了测试字节
-   if(inb(COM1 + 0) != 0xAE) {
+   if(inb(COM1 + UART_DATA) != 0xAE) {
       // 串行端口测试失败
       return;
    }
    
-   // 实际使用时，关闭回环模式，启用中断
-   outb(COM1 + 4, 0x0F);
+   // 关闭回环模式; OUT2 把UART中断接到PIC
+   outb(COM1 + UART_MCR, 0x0F);
+
+   // 检测 QEMU debugcon: 读端口0xE9返回0xE9
+   if (inb(SERIAL_DEBUGCON_PORT) == SERIAL_DEBUGCON_PORT) {
+      stats.debugcon_present = true;
+   }
+}
+
+// 修改波特率，最高115200
+bool serial_set_baud(uint32_t baud) {
+   if (baud == 0 || baud > UART_CLOCK || UART_CLOCK % baud != 0) {
+      return false;
+   }
+   serial_flush();
+   serial_baud = baud;
+   serial_program_baud(baud);
+   return true;
+}
+
+uint32_t serial_get_baud(void) {
+   return serial_baud;
+}
+
+// 选择输出目标 (UART、debugcon 或两者)
+void serial_set_output(uint32_t outputs) {
+   if ((outputs & SERIAL_OUT_DEBUGCON) && !stats.debugcon_present) {
+      outputs &= ~SERIAL_OUT_DEBUGCON;
+   }
+   if (!outputs) {
+      outputs = SERIAL_OUT_UART;
+   }
+   serial_flush();
+   serial_outputs = outputs;
+}
+
+uint32_t serial_get_output(void) {
+   return serial_outputs;
 }
 
 // 检查发送缓冲区是否为空
 int serial_is_transmit_empty(void) {
-   return inb(COM1 + 5) & 0x20;
+   return inb(COM1 + UART_LSR) & UART_LSR_THRE;
+}
+
+// 发送FIFO为空时从队列中写入最多16字节
+// 中断模式下队列非空就打开THRE中断 (FIFO仍忙时也是，否则队列中的字节没有人再发送)，
+// 队列空时才关闭; THR已空时打开THRE会立即产生中断
+// 调用者需关中断
+static void serial_tx_fill(void) {
+   if (inb(COM1 + UART_LSR) & UART_LSR_THRE) {
+      int n = 0;
+      while (n < UART_FIFO_SIZE && tx_tail != tx_head) {
+         outb(COM1 + UART_DATA, tx_queue[tx_tail & (SERIAL_TX_QUEUE_SIZE - 1)]);
+         tx_tail++;
+         n++;
+      }
+      if (n) {
+         stats.tx_bursts++;
+         stats.tx_bytes += n;
+      }
+   }
+
+   uint8_t ier = tx_tail != tx_head ? (serial_ier | UART_IER_THRE) : (serial_ier & ~UART_IER_THRE);
+   if (serial_irq_mode && ier != serial_ier) {
+      serial_ier = ier;
+      outb(COM1 + UART_IER, serial_ier);
+   }
 }
 
-// 写一个字符到串行端口
+// 读出接收FIFO中的全部字节; 缓冲区满时丢弃
+static void serial_rx_drain(void) {
+   while (inb(COM1 + UART_LSR) & UART_LSR_DR) {
+      char c = inb(COM1 + UART_DATA);
+      if (rx_head - rx_tail < SERIAL_RX_QUEUE_SIZE) {
+         rx_queue[rx_head & (SERIAL_RX_QUEUE_SIZE - 1)] = c;
+         rx_head++;
+         stats.rx_bytes++;
+      } else {
+         stats.rx_overruns++;
+      }
+   }
+}
+
+// IRQ4 处理函数: 一次处理所有挂起的中断原因
+static void serial_irq_handler(void) {
+   uint8_t iir;
+   while (!((iir = inb(COM1 + UART_IIR)) & UART_IIR_NO_INT)) {
+      switch (iir & UART_IIR_ID_MASK) {
+         case UART_IIR_RDI:
+         case UART_IIR_TIMEOUT:
+            serial_rx_drain();
+            break;
+         case UART_IIR_THRI:
+            serial_tx_fill();
+            break;
+         case UART_IIR_RLSI:
+            inb(COM1 + UART_LSR);
+            break;
+         case UART_IIR_MSI:
+            inb(COM1 + UART_MSR);
+            break;
+      }
+   }
+   stats.irqs++;
+}
+
+// 切换到中断驱动: 发送进入队列，由THRE中断按FIFO大小成批写出
+void serial_enable_irq(void) {
+   irq_register(IRQ_COM1, serial_irq_handler);
+   uint32_t flags = local_irq_save();
+   serial_irq_mode = true;
+   serial_ier = UART_IER_RDA | UART_IER_RLS;
+   outb(COM1 + UART_IER, serial_ier);
+   serial_tx_fill();
+   local_irq_restore(flags);
+   irq_enable(IRQ_COM1);
+}
+
+// 等待发送队列清空 (中断关闭或队列满时由调用者轮询推进)
+void serial_flush(void) {
+   while (tx_tail != tx_head) {
+      uint32_t flags = local_irq_save();
+      serial_tx_fill();
+      local_irq_restore(flags);
+   }
+}
+
+uint32_t serial_tx_room(void) {
+   return SERIAL_TX_QUEUE_SIZE - (tx_head - tx_tail);
+}
+
+// 把一个字节放入发送队列
+static void serial_tx_enqueue(char c) {
+   // 队列满时同步推进，不丢弃输出
+   while (tx_head - tx_tail >= SERIAL_TX_QUEUE_SIZE) {
+      stats.tx_stalls++;
+      uint32_t flags = local_irq_save();
+      serial_tx_fill();
+      local_irq_restore(flags);
+   }
+
+   uint32_t flags = local_irq_save();
+   tx_queue[tx_head & (SERIAL_TX_QUEUE_SIZE - 1)] = c;
+   tx_head++;
+   // 中断模式下THRE中断会继续发送; 否则(或FIFO正空闲时)立即写出
+   if (!serial_irq_mode || !(serial_ier & UART_IER_THRE)) {
+      serial_tx_fill();
+   }
+   local_irq_restore(flags);
+
+   // 轮询模式 (启动早期) 每行结束时写完，保证输出不滞留在队列中
+   if (!serial_irq_mode && (c == '\n' || c == '\r')) {
+      serial_flush();
+   }
+}
+
+// 写一个字符到输出目标
 void serial_putc(char c) {
-   // 等待传输缓冲区为空
-   while (!(inb(COM1 + 5) & 0x20));
-   
-   // 发送字符
-   outb(COM1, c);
+   if (serial_outputs & SERIAL_OUT_DEBUGCON) {
+      outb(SERIAL_DEBUGCON_PORT, c);
+   }
+   if (serial_outputs & SERIAL_OUT_UART) {
+      serial_tx_enqueue(c);
+   }
    
    // 如果是换行，自动添加回车符
    if (c == '\n') {
@@ -65,6 +261,23 @@ void serial_write_string(const char* str) {
     }
 }
 
+// 从接收队列读取一个字符，没有时返回 -1
+int serial_getc(void) {
+   if (!serial_irq_mode) {
+      serial_rx_drain();
+   }
+   if (rx_tail == rx_head) {
+      return -1;
+   }
+   char c = rx_queue[rx_tail & (SERIAL_RX_QUEUE_SIZE - 1)];
+   rx_tail++;
+   return (uint8_t)c;
+}
+
+const struct serial_stats *serial_get_stats(void) {
+   return &stats;
+}
+
 // 简化的十六进制转换
 static const char* hex_digits = "0123456789ABCDEF";
 
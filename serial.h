@@ -6,8 +6,44 @@
 // 串口端口
 #define SERIAL_COM1_PORT 0x3F8
 
-// 串口初始化 115200 8N1
+// 默认波特率
+#define SERIAL_DEFAULT_BAUD 115200
+
+// 发送/接收队列大小 (2的幂)
+#define SERIAL_TX_QUEUE_SIZE 4096
+#define SERIAL_RX_QUEUE_SIZE 256
+
+// 输出目标
+#define SERIAL_OUT_UART     0x01
+#define SERIAL_OUT_DEBUGCON 0x02  // QEMU -debugcon，写端口即完成，适合大量输出
+#define SERIAL_DEBUGCON_PORT 0xE9
+
+struct serial_stats {
+    uint32_t tx_bytes;
+    uint32_t tx_bursts;       // 每次THRE写入FIFO算一次
+    uint32_t tx_stalls;       // 队列满时同步等待的次数
+    uint32_t rx_bytes;
+    uint32_t rx_overruns;     // 接收队列满丢弃的字节
+    uint32_t irqs;
+    bool debugcon_present;
+};
+
+// 串口初始化 115200 8N1 (轮询模式)
 void serial_init();
+// 切换到IRQ4驱动的发送/接收
+void serial_enable_irq(void);
+// 波特率: 115200 的整数分频
+bool serial_set_baud(uint32_t baud);
+uint32_t serial_get_baud(void);
+void serial_set_output(uint32_t outputs);
+uint32_t serial_get_output(void);
+// 等待发送队列清空
+void serial_flush(void);
+// 发送队列剩余空间
+uint32_t serial_tx_room(void);
+// 读取一个接收字符，没有时返回 -1
+int serial_getc(void);
+const struct serial_stats *serial_get_stats(void);
 
 // 重定向到串口
 void serial_putc(char c);
@@ -16,6 +52,7 @@ void serial_write_hex(uint32_t value);
 void serial_write_hex8(uint8_t value);
 void serial_write_hex_byte(uint8_t value);
 void serial_write_hex16(uint16_t value);
+void serial_write_hex32(uint32_t value);
 void serial_write_dec(uint32_t value);
 void serial_write_int(int value, int base);
 
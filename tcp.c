@@ -4,6 +4,16 @@
 #include "byteorder.h"
 #include "memory.h"
 #include "serial.h"
+#include "cpu.h"
+#include "netdev.h"
+#include "log.h"
+#include "netstats.h"
+
+// 每个CPU独立的连接表，RSS把同一条流始终交给同一个CPU处理，连接状态无需跨CPU共享
+static struct tcp_connection tcp_connections[NR_CPUS][MAX_TCP_CONNECTIONS] __cacheline_aligned;
+
+// 发送头部缓冲区; 负载作为单独的分片直接从调用者缓冲区发送
+static uint8_t tcp_tx_header[TCP_FRAME_HDR_LEN] __attribute__((aligned(16)));
 
 // 初始化TCP子系统
 void tcp_init(void) {
@@ -12,10 +22,10 @@ void tcp_init(void) {
 
 // 处理TCP数据包
 void handle_tcp_packet(uint8_t *packet, uint16_t length) {
-    // 简单的打印，不做实际处理
-    terminal_writestring("TCP packet received, length: ");
-    terminal_writedec(length);
-    terminal_writestring("\n");
+    // 简单的记录，不做实际处理
+    (void)packet;
+    NETSTATS_INC(tcp, in_segs);
+    LOG_DEBUG(TCP, "packet received, length %u", length);
 }
 
 // 监听指定端口
@@ -27,13 +37,40 @@ int tcp_listen(uint16_t port) {
     return 0;
 }
 
-// 创建TCP连接
+// 创建TCP连接 (从当前CPU的连接表中分配)
 struct tcp_connection* tcp_create_connection(void) {
+    struct tcp_connection *table = tcp_connections[smp_processor_id()];
+    for (int i = 0; i < MAX_TCP_CONNECTIONS; i++) {
+        if (!table[i].in_use) {
+            memset(&table[i], 0, sizeof(struct tcp_connection));
+            table[i].in_use = true;
+            table[i].state = TCP_CLOSED;
+            table[i].window = TCP_WINDOW_SIZE;
+            return &table[i];
+        }
+    }
     return NULL;
 }
 
 // 释放TCP连接
 void tcp_free_connection(struct tcp_connection* conn) {
+    if (conn) {
+        conn->in_use = false;
+        conn->state = TCP_CLOSED;
+    }
+}
+
+// 所有CPU上正在使用的连接数 (不加锁，只用于显示)
+int tcp_active_connections(void) {
+    int count = 0;
+    for (int cpu = 0; cpu < NR_CPUS; cpu++) {
+        for (int i = 0; i < MAX_TCP_CONNECTIONS; i++) {
+            if (tcp_connections[cpu][i].in_use && tcp_connections[cpu][i].state != TCP_CLOSED) {
+                count++;
+            }
+        }
+    }
+    return count;
 }
 
 // 连接到指定IP和端口
@@ -41,9 +78,91 @@ int tcp_connect_ip(uint32_t dest_ip, uint16_t dest_port) {
     return -1;
 }
 
-// 发送数据
+// 构造并发送一个TCP段; length 超过 mss 时作为超长段交给设备分段
+static bool tcp_xmit_segment(struct tcp_connection *conn, struct netdev *dev, const uint8_t *dest_mac,
+                             const uint8_t *data, uint16_t length, uint16_t mss, bool last) {
+    uint8_t *buffer = tcp_tx_header;
+
+    struct eth_header *eth = (struct eth_header *)buffer;
+    memcpy(eth->dest_mac, dest_mac, 6);
+    memcpy(eth->src_mac, net_dev.mac_addr, 6);
+    eth->type = htons(ETH_TYPE_IP);
+
+    uint16_t tcp_len = sizeof(struct tcp_header) + length;
+    struct ipv4_header *ip = (struct ipv4_header *)(buffer + sizeof(struct eth_header));
+    ipv4_build_header(ip, IP_PROTO_TCP, conn->local_ip, conn->remote_ip, tcp_len,
+                      network_next_ip_id(), 0x4000);  // DF
+
+    struct tcp_header *tcp = (struct tcp_header *)(buffer + sizeof(struct eth_header) + sizeof(struct ipv4_header));
+    tcp->src_port = htons(conn->local_port);
+    tcp->dest_port = htons(conn->remote_port);
+    tcp->seq_num = htonl(conn->seq_num);
+    tcp->ack_num = htonl(conn->ack_num);
+    tcp->data_offset = (sizeof(struct tcp_header) / 4) << 4;
+    tcp->flags = TCP_FLAG_ACK | (last ? TCP_FLAG_PSH : 0);
+    tcp->window = htons(conn->window);
+    tcp->urgent_ptr = 0;
+
+    // 校验和字段预置伪首部和，由设备或netdev补全
+    tcp->checksum = network_checksum_fold(
+        network_pseudo_header_sum(ip->src_ip, ip->dst_ip, IP_PROTO_TCP, tcp_len));
+
+    struct netdev_tx_meta meta = {
+        .flags = NETDEV_TX_CSUM_PARTIAL,
+        .csum_start = sizeof(struct eth_header) + sizeof(struct ipv4_header),
+        .csum_offset = 16,
+    };
+    if (length > mss) {
+        meta.flags |= NETDEV_TX_GSO_TCPV4;
+        meta.gso_size = mss;
+        meta.hdr_len = TCP_FRAME_HDR_LEN;
+    }
+
+    struct netdev_frag frags[2] = {
+        { buffer, TCP_FRAME_HDR_LEN },
+        { data, length },
+    };
+    NETSTATS_INC(ip, out_requests);
+    if (!netdev_xmit_sg(dev, frags, 2, &meta)) {
+        NETSTATS_INC(tcp, out_errors);
+        return false;
+    }
+    NETSTATS_INC(tcp, out_segs);
+    conn->seq_num += length;
+    return true;
+}
+
+// 发送数据: 设备支持TSO时以超长段发送，否则按MSS切分
 int tcp_send_data(struct tcp_connection* conn, uint8_t* data, uint16_t length) {
-    return -1;
+    if (!conn || conn->state != TCP_ESTABLISHED) {
+        return -1;
+    }
+
+    struct netdev *dev = netdev_route(conn->remote_ip);
+    uint8_t dest_mac[6];
+    if (!dev || !get_destination_mac(conn->remote_ip, dest_mac)) {
+        return -1;
+    }
+
+    uint16_t mss = dev->mtu - sizeof(struct ipv4_header) - sizeof(struct tcp_header);
+    uint32_t max_chunk = netdev_has_feature(dev, NETDEV_F_TSO4) ? TCP_GSO_MAX_PAYLOAD : mss;
+
+    uint32_t sent = 0;
+    while (sent < length) {
+        uint32_t chunk = length - sent;
+        if (chunk > max_chunk) {
+            chunk = max_chunk;
+        }
+        if (!tcp_xmit_segment(conn, dev, dest_mac, data + sent, chunk, mss, sent + chunk == length)) {
+            break;
+        }
+        sent += chunk;
+    }
+
+    // 负载可能仍被设备引用，返回前等待发送完成
+    netdev_tx_drain(dev);
+
+    return sent ? (int)sent : -1;
 }
 
 // 关闭连接
@@ -28,6 +28,11 @@
 #define MAX_TCP_CONNECTIONS 8
 #define TCP_WINDOW_SIZE 8192
 
+// 以太网 + IP + TCP 头 (无选项)
+#define TCP_FRAME_HDR_LEN 54
+// 一个超长段能携带的最大负载 (整帧不超过64KB)
+#define TCP_GSO_MAX_PAYLOAD (65535 - TCP_FRAME_HDR_LEN)
+
 // TCP头结构体
 struct tcp_header {
     uint16_t src_port;        // 源端口
@@ -53,6 +58,7 @@ struct tcp_pseudo_header {
 
 // TCP 连接结构
 struct tcp_connection {
+    bool in_use;            // 是否已分配
     uint8_t state;          // 连接状态
     uint32_t local_ip;      // 本地IP
     uint16_t local_port;    // 本地端口
@@ -76,6 +82,7 @@ void handle_tcp_packet(uint8_t* packet, uint16_t length);
 // TCP连接管理
 struct tcp_connection* tcp_create_connection(void);
 void tcp_free_connection(struct tcp_connection* conn);
+int tcp_active_connections(void);
 int tcp_connect_ip(uint32_t dest_ip, uint16_t dest_port);
 int tcp_send_data(struct tcp_connection* conn, uint8_t* data, uint16_t length);
 void tcp_close_conn(struct tcp_connection* conn);
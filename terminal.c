@@ -1,5 +1,7 @@
 #include "terminal.h"
 #include "types.h"
+#include "io.h"
+#include "tsc.h"
 
 // VGA文本模式的显存地址
 #define VGA_MEMORY 0xB8000
@@ -7,10 +9,25 @@
 #define VGA_WIDTH 80
 #define VGA_HEIGHT 25
 
-// 当前光标位置
+// CRT控制器端口，用于设置硬件光标
+#define VGA_CRTC_INDEX 0x3D4
+#define VGA_CRTC_DATA  0x3D5
+
+// 当前光标位置 (屏幕坐标)
 static uint16_t cursor_x = 0;
 static uint16_t cursor_y = 0;
 
+// 影子缓冲区: 按行组成的环，shadow_top 是屏幕第0行对应的缓冲区行
+// 滚屏只移动 shadow_top 并清空新的一行，不搬移数据
+static uint16_t shadow[VGA_HEIGHT][VGA_WIDTH];
+static uint16_t shadow_top = 0;
+// 自上次刷新后改动过的屏幕行 (每行一位)
+static uint32_t dirty_lines = 0;
+static uint64_t last_flush_tsc = 0;
+// 当前颜色对应的空白字符，只在改变颜色时计算
+static uint16_t blank_entry;
+static uint8_t terminal_color;
+
 // 字符颜色
 static uint8_t make_color(uint8_t fg, uint8_t bg) {
     return fg | bg << 4;
@@ -18,70 +35,136 @@ static uint8_t make_color(uint8_t fg, uint8_t bg) {
 
 // VGA字符项
 static uint16_t make_vgaentry(char c, uint8_t color) {
-    uint16_t c16 = c;
+    uint16_t c16 = (uint8_t)c;
     uint16_t color16 = color;
     return c16 | color16 << 8;
 }
 
-// 清屏
+static inline uint16_t *shadow_line(uint16_t y) {
+    uint16_t row = shadow_top + y;
+    if (row >= VGA_HEIGHT) row -= VGA_HEIGHT;
+    return shadow[row];
+}
+
+static void fill_line(uint16_t *line) {
+    // 两个字符一起写
+    uint32_t pair = blank_entry | ((uint32_t)blank_entry << 16);
+    uint32_t *p = (uint32_t *)line;
+    for (int x = 0; x < VGA_WIDTH / 2; x++) {
+        p[x] = pair;
+    }
+}
+
+void terminal_setcolor(uint8_t fg, uint8_t bg) {
+    terminal_color = make_color(fg, bg);
+    blank_entry = make_vgaentry(' ', terminal_color);
+}
+
+// 清屏: 只清影子缓冲区，下次刷新时整屏写入显存
 void terminal_clear(void) {
-    uint8_t color = make_color(15, 0); // 白字黑底
-    uint16_t* vga = (uint16_t*)VGA_MEMORY;
-    
-    for(int y = 0; y < VGA_HEIGHT; y++) {
-        for(int x = 0; x < VGA_WIDTH; x++) {
-            const size_t index = y * VGA_WIDTH + x;
-            vga[index] = make_vgaentry(' ', color);
-        }
+    for (int y = 0; y < VGA_HEIGHT; y++) {
+        fill_line(shadow[y]);
     }
+    shadow_top = 0;
+    dirty_lines = (1u << VGA_HEIGHT) - 1;
     cursor_x = 0;
     cursor_y = 0;
 }
 
-// 输出字符
+// 滚动一行: 所有屏幕行内容都变了
+static void terminal_scroll(void) {
+    fill_line(shadow[shadow_top]);
+    shadow_top = shadow_top + 1 == VGA_HEIGHT ? 0 : shadow_top + 1;
+    dirty_lines = (1u << VGA_HEIGHT) - 1;
+    cursor_y = VGA_HEIGHT - 1;
+}
+
+static void terminal_newline(void) {
+    cursor_x = 0;
+    if (++cursor_y >= VGA_HEIGHT) {
+        terminal_scroll();
+    }
+}
+
+// 输出字符 (只写影子缓冲区)
 void terminal_putchar(char c) {
-    uint8_t color = make_color(15, 0); // 白字黑底
-    uint16_t* vga = (uint16_t*)VGA_MEMORY;
-    
     if(c == '\n') {
-        cursor_x = 0;
-        cursor_y++;
-        if(cursor_y >= VGA_HEIGHT) {
-            // 滚动屏幕
-            for(int y = 0; y < VGA_HEIGHT - 1; y++) {
-                for(int x = 0; x < VGA_WIDTH; x++) {
-                    vga[y * VGA_WIDTH + x] = vga[(y + 1) * VGA_WIDTH + x];
-                }
-            }
-            // 清除最后一行
-            for(int x = 0; x < VGA_WIDTH; x++) {
-                vga[(VGA_HEIGHT - 1) * VGA_WIDTH + x] = make_vgaentry(' ', color);
-            }
-            cursor_y = VGA_HEIGHT - 1;
-        }
+        terminal_newline();
         return;
     }
-    
-    const size_t index = cursor_y * VGA_WIDTH + cursor_x;
-    vga[index] = make_vgaentry(c, color);
-    
+
+    shadow_line(cursor_y)[cursor_x] = make_vgaentry(c, terminal_color);
+    dirty_lines |= 1u << cursor_y;
+
     if(++cursor_x >= VGA_WIDTH) {
-        cursor_x = 0;
-        cursor_y++;
-        if(cursor_y >= VGA_HEIGHT) {
-            // 滚动屏幕
-            for(int y = 0; y < VGA_HEIGHT - 1; y++) {
-                for(int x = 0; x < VGA_WIDTH; x++) {
-                    vga[y * VGA_WIDTH + x] = vga[(y + 1) * VGA_WIDTH + x];
-                }
-            }
-            // 清除最后一行
-            for(int x = 0; x < VGA_WIDTH; x++) {
-                vga[(VGA_HEIGHT - 1) * VGA_WIDTH + x] = make_vgaentry(' ', color);
-            }
-            cursor_y = VGA_HEIGHT - 1;
+        terminal_newline();
+    }
+}
+
+// 用 text 替换屏幕第 y 行 (不足部分补空白，超出部分截断)，不移动光标
+// 内容没有变化时不标记脏行，固定布局的界面每次整行重写也不会产生多余的显存写入
+void terminal_write_line(uint16_t y, const char *text) {
+    if (y >= VGA_HEIGHT) {
+        return;
+    }
+    uint16_t *line = shadow_line(y);
+    bool changed = false;
+    for (int x = 0; x < VGA_WIDTH; x++) {
+        uint16_t entry = *text ? make_vgaentry(*text++, terminal_color) : blank_entry;
+        if (line[x] != entry) {
+            line[x] = entry;
+            changed = true;
+        }
+    }
+    if (changed) {
+        dirty_lines |= 1u << y;
+    }
+}
+
+// 一行160字节按双字块复制 (显存写入较慢，避免逐字节访问)
+static inline void vga_copy_line(uint16_t *dst, const uint16_t *src) {
+    uint32_t count = VGA_WIDTH / 2;
+    asm volatile ("rep movsl" : "+D"(dst), "+S"(src), "+c"(count) : : "memory");
+}
+
+static void terminal_update_cursor(void) {
+    uint16_t pos = cursor_y * VGA_WIDTH + cursor_x;
+    outb(VGA_CRTC_INDEX, 0x0F);
+    outb(VGA_CRTC_DATA, pos & 0xFF);
+    outb(VGA_CRTC_INDEX, 0x0E);
+    outb(VGA_CRTC_DATA, pos >> 8);
+}
+
+// 把改动过的行写入显存并更新硬件光标
+void terminal_flush(void) {
+    uint16_t *vga = (uint16_t *)VGA_MEMORY;
+
+    for (uint16_t y = 0; dirty_lines && y < VGA_HEIGHT; y++) {
+        if (dirty_lines & (1u << y)) {
+            vga_copy_line(vga + y * VGA_WIDTH, shadow_line(y));
+            dirty_lines &= ~(1u << y);
         }
     }
+    terminal_update_cursor();
+    last_flush_tsc = tsc_read();
+}
+
+// 距上次刷新超过 1/TERMINAL_FLUSH_HZ 秒时刷新; 主循环也调用它输出剩余的改动
+void terminal_poll(void) {
+    if (!dirty_lines) {
+        return;
+    }
+    uint64_t interval = (uint64_t)tsc_khz() * (1000 / TERMINAL_FLUSH_HZ);
+    if (tsc_read() - last_flush_tsc >= interval) {
+        terminal_flush();
+    }
+}
+
+void terminal_write(const char* data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        terminal_putchar(data[i]);
+    }
+    terminal_poll();
 }
 
 // 输出字符串
@@ -89,6 +172,7 @@ void terminal_writestring(const char* str) {
     for(size_t i = 0; str[i] != '\0'; i++) {
         terminal_putchar(str[i]);
     }
+    terminal_poll();
 }
 
 // 打印十六进制数
@@ -228,16 +312,7 @@ void terminal_writeint(int value, int base) {
 
 // 初始化终端
 void terminal_initialize(void) {
-    uint8_t color = make_color(15, 0); // 白字黑底
-    uint16_t* vga = (uint16_t*)VGA_MEMORY;
-    
-    for(int y = 0; y < VGA_HEIGHT; y++) {
-        for(int x = 0; x < VGA_WIDTH; x++) {
-            const size_t index = y * VGA_WIDTH + x;
-            vga[index] = make_vgaentry(' ', color);
-        }
-    }
-    cursor_x = 0;
-    cursor_y = 0;
+    terminal_setcolor(15, 0); // 白字黑底
+    terminal_clear();
+    terminal_flush();
 }
- 
\ No newline at end of file
@@ -3,7 +3,11 @@
 
 #include "types.h"
 
+// 屏幕内容先写入影子缓冲区，最多每秒刷新 TERMINAL_FLUSH_HZ 次到显存
+#define TERMINAL_FLUSH_HZ 30
+
 void terminal_initialize(void);
+void terminal_setcolor(uint8_t fg, uint8_t bg);
 void terminal_putchar(char c);
 void terminal_write(const char* data, size_t size);
 void terminal_writestring(const char* data);
@@ -14,6 +18,12 @@ void terminal_writehex16(uint16_t value);
 void terminal_writehex32(uint32_t value);
 void terminal_writeint(int value, int base);
 void terminal_clear(void);
+// 整行替换第 y 行，供固定布局的仪表盘使用
+void terminal_write_line(uint16_t y, const char *text);
+// 立即把改动写入显存
+void terminal_flush(void);
+// 按频率限制刷新，主循环中调用
+void terminal_poll(void);
 void debug_log(const char* message);
 void debug_log_hex(const char* prefix, uint32_t value);
 void print_hex(uint32_t num);
@@ -0,0 +1,41 @@
+"""串口日志中内核导出块的公共解析 (cap dump、prof dump、gcov dump)。
+
+每次导出以 `@@<名称> ...` 行开始、`@@END` 行结束，中间是十六进制数据行和 `@@` 子标记行。
+日志中可以有多次导出，工具的 --dump N 选择第 N 次 (从 0 开始，默认 -1 即最后一次)。
+"""
+
+import re
+import sys
+
+HEX_LINE = re.compile(r"^[0-9a-fA-F ]+$")
+
+
+def read_blocks(lines, start_marker):
+    """返回每次导出的 (起始行, 内容行列表)。
+    内容行保留 `@@` 子标记行和十六进制数据行; 与其他输出交错的行被丢弃并提示。
+    没有 @@END 的最后一块 (日志截断) 不返回。"""
+    blocks = []
+    header = None
+    body = None
+    for raw in lines:
+        line = raw.strip()
+        if line.startswith(start_marker):
+            header, body = line, []
+        elif body is None or not line:
+            continue
+        elif line == "@@END":
+            blocks.append((header, body))
+            header, body = None, None
+        elif line.startswith("@@") or HEX_LINE.match(line):
+            body.append(line)
+        else:
+            sys.stderr.write("skipping malformed line: %r\n" % line[:40])
+    return blocks
+
+
+def select_dump(dumps, index, log):
+    """按 --dump 取出一次导出，超出范围时退出。"""
+    try:
+        return dumps[index]
+    except IndexError:
+        sys.exit("only %d export(s) in %s" % (len(dumps), log))
@@ -0,0 +1,112 @@
+#!/usr/bin/env python3
+"""从串口日志中取出内核 `gcov dump` 的输出，还原成 .gcda 文件，供 PGO=use 构建的 -fprofile-use 读取。
+
+用法:
+    python3 tools/gcov_extract.py build/pgo-train.log build/pgo
+每个目标文件写成 <输出目录>/<名称>.gcda (只取文件名，去掉训练构建的目录)，
+PGO=use 构建用 -fprofile-use=<输出目录> -fprofile-prefix-path=<构建目录> 在同一位置查找。
+--merge 把计数累加到输出目录中已有的 .gcda 上 (多次训练运行)，否则覆盖。
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+from dumpblocks import read_blocks, select_dump
+
+GCOV_DATA_MAGIC = 0x67636461
+GCOV_TAG_FUNCTION = 0x01000000
+GCOV_TAG_COUNTER_BASE = 0x01A10000
+GCOV_TAG_OBJECT_SUMMARY = 0xA1000000
+
+
+def parse_dumps(lines):
+    """返回每次导出的 {文件名: 字列表}。"""
+    dumps = []
+    for _, body in read_blocks(lines, "@@GCOV"):
+        current = {}
+        name = None
+        for line in body:
+            if line.startswith("@@GCDA"):
+                fields = dict(item.split("=", 1) for item in line.split()[1:])
+                name = fields["file"]
+                current[name] = {"expected": int(fields["words"]), "words": []}
+            elif name and not line.startswith("@@"):
+                current[name]["words"].extend(int(word, 16) for word in line.split())
+        dumps.append(current)
+    return dumps
+
+
+def counters(words):
+    """按 (函数序号, 标签) 返回计数器记录在字列表中的位置，用于合并。"""
+    records = {}
+    pos, fn = 4, -1
+    while pos + 1 < len(words):
+        tag, length = words[pos], words[pos + 1]
+        if tag == 0:
+            break
+        if tag == GCOV_TAG_FUNCTION:
+            fn += 1
+        elif GCOV_TAG_COUNTER_BASE <= tag < GCOV_TAG_OBJECT_SUMMARY and not length & 0x80000000:
+            records[(fn, tag)] = (pos + 2, length // 4)
+        pos += 2 + (length // 4 if not length & 0x80000000 else 0)
+    return records
+
+
+def merge(words, old):
+    """把已有 .gcda 的计数加到 words 上; 结构不同 (源码已改) 时放弃旧数据。"""
+    if len(old) != len(words) or old[:2] != words[:2]:
+        return False
+    new_records, old_records = counters(words), counters(old)
+    if new_records.keys() != old_records.keys():
+        return False
+    for key, (pos, n) in new_records.items():
+        for i in range(pos, pos + n, 2):
+            total = (words[i] | words[i + 1] << 32) + (old[i] | old[i + 1] << 32)
+            words[i], words[i + 1] = total & 0xFFFFFFFF, (total >> 32) & 0xFFFFFFFF
+    words[6] += old[6]   # 对象摘要中的运行次数
+    words[7] = max(words[7], old[7])
+    return True
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("log", help="serial log containing a 'gcov dump'")
+    parser.add_argument("outdir", help="directory for the .gcda files")
+    parser.add_argument("--dump", type=int, default=-1, help="which dump to use (default: last)")
+    parser.add_argument("--merge", action="store_true", help="add to existing .gcda files")
+    args = parser.parse_args()
+
+    with open(args.log, errors="replace") as f:
+        dumps = parse_dumps(f)
+    if not dumps:
+        sys.exit("%s: no @@GCOV dump found (was the kernel built with PGO=gen?)" % args.log)
+    files = select_dump(dumps, args.dump, args.log)
+    if not files:
+        sys.exit("%s: dump has no objects (kernel was not instrumented)" % args.log)
+
+    os.makedirs(args.outdir, exist_ok=True)
+    written = 0
+    for name, data in sorted(files.items()):
+        words = data["words"]
+        if len(words) != data["expected"] or not words or words[0] != GCOV_DATA_MAGIC:
+            sys.stderr.write("%s: truncated or corrupt (%d of %d words), skipped\n"
+                             % (name, len(words), data["expected"]))
+            continue
+        path = os.path.join(args.outdir, os.path.basename(name))
+        if args.merge and os.path.exists(path):
+            with open(path, "rb") as f:
+                raw = f.read()
+            old = list(struct.unpack("<%dI" % (len(raw) // 4), raw))
+            if not merge(words, old):
+                sys.stderr.write("%s: layout changed since the previous run, overwriting\n" % path)
+        with open(path, "wb") as f:
+            f.write(struct.pack("<%dI" % len(words), *words))
+        written += 1
+    print("wrote %d .gcda files to %s" % (written, args.outdir), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,42 @@
+#!/usr/bin/env python3
+"""从串口日志 (或 debugcon.log) 中取出内核 `cap dump` 导出的 pcapng 文件。
+
+用法:
+    python3 tools/pcap_extract.py serial_output.log capture.pcapng
+然后用 Wireshark / tshark 打开 capture.pcapng。
+每帧的方向在 epb_flags 中 (inbound/outbound)，被协议栈丢弃的帧带有 "drop: <原因>" 注释。
+"""
+
+import argparse
+import sys
+
+from dumpblocks import read_blocks, select_dump
+
+
+def parse_dumps(lines):
+    """返回每次导出的字节串列表。"""
+    return [b"".join(bytes.fromhex(line) for line in body if not line.startswith("@@"))
+            for _, body in read_blocks(lines, "@@PCAPNG")]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("log", help="serial or debugcon log containing @@PCAPNG blocks")
+    parser.add_argument("output", help="pcapng file to write")
+    parser.add_argument("--dump", type=int, default=-1, help="which export to use (default: last)")
+    args = parser.parse_args()
+
+    with open(args.log, "r", errors="replace") as f:
+        dumps = parse_dumps(f)
+    if not dumps:
+        sys.exit("no @@PCAPNG export found in %s" % args.log)
+    data = select_dump(dumps, args.dump, args.log)
+
+    with open(args.output, "wb") as f:
+        f.write(data)
+    sys.stderr.write("wrote %d bytes to %s\n" % (len(data), args.output))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+"""把内核 `prof dump` 导出的采样转换成折叠栈，供 flamegraph.pl 或 speedscope 使用。
+
+用法:
+    python3 tools/profile_fold.py serial_output.log build/profile/kernel.bin > profile.folded
+    flamegraph.pl profile.folded > profile.svg
+每行输出 "root;...;leaf 样本数"。符号来自 `nm -n kernel.bin` (可用 --nm 指定交叉工具链的 nm)，
+返回地址按 addr-1 查找，使其落在调用指令所在的函数内。
+
+限制: 采样恰好落在函数序言 (push ebp; mov ebp, esp 之前) 或汇编入口时，
+帧指针仍指向调用者，调用者会从栈中缺失一层。
+"""
+
+import argparse
+import bisect
+import collections
+import subprocess
+import sys
+
+from dumpblocks import read_blocks, select_dump
+
+
+def parse_dumps(lines):
+    """返回每次导出的样本列表，每个样本是地址元组 (叶子在前)。"""
+    return [[tuple(int(word, 16) for word in line.split()) for line in body if not line.startswith("@@")]
+            for _, body in read_blocks(lines, "@@PROFILE")]
+
+
+def load_symbols(nm, image):
+    """返回按地址排序的 (地址列表, 名称列表)，只保留代码段符号。"""
+    out = subprocess.run([nm, "-n", "--defined-only", image], check=True,
+                         stdout=subprocess.PIPE, universal_newlines=True).stdout
+    addrs, names = [], []
+    for line in out.splitlines():
+        parts = line.split()
+        if len(parts) == 3 and parts[1] in "tTwW":
+            addrs.append(int(parts[0], 16))
+            names.append(parts[2])
+    return addrs, names
+
+
+def symbolize(addr, addrs, names):
+    i = bisect.bisect_right(addrs, addr) - 1
+    if i < 0:
+        return "0x%08x" % addr
+    return names[i]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("log", help="serial or debugcon log containing @@PROFILE blocks")
+    parser.add_argument("kernel", help="kernel image with symbols (kernel.bin)")
+    parser.add_argument("--dump", type=int, default=-1, help="which export to use (default: last)")
+    parser.add_argument("--nm", default="nm", help="nm binary to read symbols with")
+    args = parser.parse_args()
+
+    with open(args.log, "r", errors="replace") as f:
+        dumps = parse_dumps(f)
+    if not dumps:
+        sys.exit("no @@PROFILE block found in %s" % args.log)
+    samples = select_dump(dumps, args.dump, args.log)
+    addrs, names = load_symbols(args.nm, args.kernel)
+
+    folded = collections.Counter()
+    for pcs in samples:
+        frames = [symbolize(pcs[0], addrs, names)]
+        frames += [symbolize(pc - 1, addrs, names) for pc in pcs[1:]]
+        folded[";".join(reversed(frames))] += 1
+
+    for stack, count in sorted(folded.items(), key=lambda item: -item[1]):
+        print("%s %d" % (stack, count))
+    sys.stderr.write("%d samples, %d unique stacks\n" % (len(samples), len(folded)))
+
+
+if __name__ == "__main__":
+    main()
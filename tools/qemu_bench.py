@@ -0,0 +1,447 @@
+#!/usr/bin/env python3
+"""端到端网络基准: 无界面启动QEMU，主机上的负载生成器直接收发以太网帧，输出 JSON/CSV 报告。
+
+用法:
+    python3 tools/qemu_bench.py --kernel build/release/kernel.bin --json report.json --csv report.csv
+    python3 tools/qemu_bench.py --tests icmp --rate 5000 --duration 10 --label after-fix
+
+QEMU 的网卡接到 socket 后端 (UDP 模式): 每个UDP数据报就是一个以太网帧，
+本脚本扮演网关 10.0.2.2 (回答内核的ARP请求和ping)，不需要 root、tap 或外部网络。
+串口接到本地TCP端口，脚本在测试前后执行控制台命令 `stats` 和 `lat`。
+
+测试:
+    icmp  按固定速率发送回显请求，按序号匹配应答，统计主机侧往返延迟分位数
+    arp   ARP风暴: 从不断变化的源地址请求内核的MAC，内核每个请求都会更新缓存并应答
+    udp   向没有监听的端口发送UDP，只测内核接收处理速率 (Udp NoPorts 计数)
+每个测试输出: 发送/收到数、丢失率、应答速率、往返延迟 p50/p90/p99/max (微秒)、
+内核接收帧速率、内核空闲比例和内核分段延迟 (lat 命令的 total 行)。
+同一个报告中记录 kernel.bin 的 sha256 和 --label，用于比较不同构建。
+--gcov 用于PGO训练 (make pgo): 启动后清零分支计数，测试结束后执行 `gcov dump`，计数留在 --serial-log 中。
+"""
+
+import argparse
+import csv
+import datetime
+import hashlib
+import json
+import os
+import re
+import socket
+import struct
+import subprocess
+import sys
+import threading
+import time
+
+GUEST_IP = "10.0.2.15"
+GUEST_MAC = bytes.fromhex("525400123456")
+GATEWAY_IP = "10.0.2.2"
+GATEWAY_MAC = bytes.fromhex("525400000202")
+BROADCAST_MAC = b"\xff" * 6
+
+ETH_ARP = 0x0806
+ETH_IP = 0x0800
+ICMP_ECHO_REPLY = 0
+ICMP_ECHO_REQUEST = 8
+BENCH_ICMP_ID = 0x4242
+
+
+def ip_bytes(ip):
+    return socket.inet_aton(ip)
+
+
+def checksum(data):
+    if len(data) % 2:
+        data += b"\0"
+    total = sum(struct.unpack("!%dH" % (len(data) // 2), data))
+    while total >> 16:
+        total = (total & 0xFFFF) + (total >> 16)
+    return ~total & 0xFFFF
+
+
+def eth_frame(dst, src, ethertype, payload):
+    frame = dst + src + struct.pack("!H", ethertype) + payload
+    return frame + b"\0" * max(0, 60 - len(frame))
+
+
+def arp_packet(op, sender_mac, sender_ip, target_mac, target_ip):
+    return struct.pack("!HHBBH6s4s6s4s", 1, ETH_IP, 6, 4, op, sender_mac, sender_ip, target_mac, target_ip)
+
+
+def ipv4_packet(src, dst, proto, payload, ident=0):
+    header = struct.pack("!BBHHHBBH4s4s", 0x45, 0, 20 + len(payload), ident, 0, 64, proto, 0, src, dst)
+    header = header[:10] + struct.pack("!H", checksum(header)) + header[12:]
+    return header + payload
+
+
+def icmp_echo(icmp_type, ident, seq, data):
+    body = struct.pack("!BBHHH", icmp_type, 0, 0, ident, seq) + data
+    return body[:2] + struct.pack("!H", checksum(body)) + body[4:]
+
+
+def udp_datagram(src, dst, sport, dport, data):
+    length = 8 + len(data)
+    pseudo = src + dst + struct.pack("!BBH", 0, 17, length)
+    header = struct.pack("!HHHH", sport, dport, length, 0)
+    csum = checksum(pseudo + header + data) or 0xFFFF
+    return struct.pack("!HHHH", sport, dport, length, csum) + data
+
+
+def percentile(sorted_values, permille):
+    if not sorted_values:
+        return None
+    index = min(len(sorted_values) - 1, (len(sorted_values) * permille) // 1000)
+    return sorted_values[index]
+
+
+class Wire:
+    """QEMU socket 网卡的对端: 收发原始以太网帧，并扮演网关。"""
+
+    def __init__(self):
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.bind(("127.0.0.1", 0))
+        self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 4 << 20)
+        self.port = self.sock.getsockname()[1]
+        probe = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        probe.bind(("127.0.0.1", 0))
+        self.qemu_port = probe.getsockname()[1]
+        probe.close()
+        self.peer = ("127.0.0.1", self.qemu_port)
+        self.lock = threading.Lock()
+        self.pending = {}         # (kind, key) -> 发送时间
+        self.rtts = []            # 秒
+        self.replies = 0
+        self.rx_frames = 0
+        self.running = True
+        self.thread = threading.Thread(target=self._rx_loop, daemon=True)
+        self.thread.start()
+
+    def send(self, frame):
+        self.sock.sendto(frame, self.peer)
+
+    def expect(self, kind, key):
+        with self.lock:
+            self.pending[(kind, key)] = time.perf_counter()
+
+    def reset(self):
+        with self.lock:
+            self.pending.clear()
+            self.rtts = []
+            self.replies = 0
+
+    def _matched(self, kind, key):
+        now = time.perf_counter()
+        with self.lock:
+            sent = self.pending.pop((kind, key), None)
+            if sent is not None:
+                self.rtts.append(now - sent)
+                self.replies += 1
+
+    def _rx_loop(self):
+        self.sock.settimeout(0.2)
+        gw_ip = ip_bytes(GATEWAY_IP)
+        while self.running:
+            try:
+                frame, _ = self.sock.recvfrom(65536)
+            except socket.timeout:
+                continue
+            except OSError:
+                return
+            self.rx_frames += 1
+            if len(frame) < 14:
+                continue
+            ethertype = struct.unpack("!H", frame[12:14])[0]
+            if ethertype == ETH_ARP and len(frame) >= 42:
+                op, smac, sip, _, tip = struct.unpack("!6xH6s4s6s4s", frame[14:42])
+                if op == 1 and tip == gw_ip:
+                    reply = arp_packet(2, GATEWAY_MAC, gw_ip, smac, sip)
+                    self.send(eth_frame(smac, GATEWAY_MAC, ETH_ARP, reply))
+                elif op == 2:
+                    self._matched("arp", tip)
+            elif ethertype == ETH_IP and len(frame) >= 42:
+                ihl = (frame[14] & 0x0F) * 4
+                proto = frame[23]
+                src, dst = frame[26:30], frame[30:34]
+                if proto != 1:
+                    continue
+                icmp = frame[14 + ihl:]
+                icmp_type, _, _, ident, seq = struct.unpack("!BBHHH", icmp[:8])
+                if icmp_type == ICMP_ECHO_REQUEST and dst == gw_ip:
+                    reply = icmp_echo(ICMP_ECHO_REPLY, ident, seq, icmp[8:])
+                    self.send(eth_frame(frame[6:12], GATEWAY_MAC, ETH_IP, ipv4_packet(gw_ip, src, 1, reply)))
+                elif icmp_type == ICMP_ECHO_REPLY and ident == BENCH_ICMP_ID:
+                    self._matched("icmp", seq)
+
+    def close(self):
+        self.running = False
+        self.sock.close()
+
+
+class Console:
+    """内核串口控制台 (QEMU -serial tcp)。"""
+
+    def __init__(self, port, log):
+        self.log = log
+        deadline = time.time() + 10
+        while True:
+            try:
+                self.sock = socket.create_connection(("127.0.0.1", port), timeout=1)
+                break
+            except OSError:
+                if time.time() > deadline:
+                    raise
+                time.sleep(0.1)
+        self.sock.settimeout(0.2)
+        self.pending = ""
+
+    def read_until(self, pattern, timeout):
+        """返回到 pattern 第一次匹配结束为止的文本，之后收到的部分留给下一次读取。
+        提示符之后常有日志输出 (调试构建逐包打印)，不能只匹配缓冲区末尾。"""
+        text = self.pending
+        deadline = time.time() + timeout
+        while True:
+            m = re.search(pattern, text, re.DOTALL)
+            if m:
+                self.pending = text[m.end():]
+                return text[:m.end()]
+            if time.time() >= deadline:
+                break
+            try:
+                data = self.sock.recv(65536)
+            except socket.timeout:
+                data = b""
+            if data:
+                chunk = data.decode("latin-1").replace("\r", "")
+                self.log.write(chunk)
+                text += chunk
+        self.pending = text
+        raise TimeoutError("no %r from kernel within %ss" % (pattern, timeout))
+
+    def command(self, line, timeout=10):
+        # 上一条命令的提示符已经读过，下一个行首的 "> " 就是这条命令结束后的提示符
+        self.sock.sendall(line.encode() + b"\r")
+        return self.read_until(r"\n> ", timeout)
+
+    def close(self):
+        self.sock.close()
+
+
+def parse_stats(text):
+    """解析 stats 输出: SNMP 风格的成对行和 cpu: 行。"""
+    stats = {}
+    groups = {}
+    for line in text.splitlines():
+        m = re.match(r"^(\w+): (.*)$", line.strip())
+        if not m:
+            continue
+        group, rest = m.groups()
+        fields = rest.split()
+        if group == "cpu":
+            for item in fields:
+                key, _, value = item.partition("=")
+                stats["cpu." + key] = int(value)
+        elif fields and all(f.isdigit() for f in fields) and group in groups:
+            for name, value in zip(groups.pop(group), fields):
+                stats["%s.%s" % (group, name)] = int(value)
+        elif fields and not any(f.isdigit() for f in fields):
+            groups[group] = fields
+    return stats
+
+
+def parse_lat(text):
+    """解析 lat 输出，返回 {阶段: {count, p50_ns, p99_ns, p999_ns, max_ns}}。"""
+    result = {}
+    for line in text.splitlines():
+        parts = line.split()
+        if len(parts) == 6 and parts[0] in ("driver", "demux", "proto", "tx", "total") and parts[1].isdigit():
+            result[parts[0]] = dict(zip(("count", "p50_ns", "p99_ns", "p999_ns", "max_ns"), map(int, parts[1:])))
+    return result
+
+
+def paced(rate, duration, send_one):
+    """按固定速率调用 send_one(i)，每毫秒补发落后的部分。返回发送数。"""
+    start = time.perf_counter()
+    sent = 0
+    while True:
+        elapsed = time.perf_counter() - start
+        if elapsed >= duration:
+            return sent
+        due = int(elapsed * rate)
+        while sent < due:
+            send_one(sent)
+            sent += 1
+        time.sleep(0.0005)
+
+
+def test_icmp(wire, rate, duration):
+    src, dst = ip_bytes(GATEWAY_IP), ip_bytes(GUEST_IP)
+    payload = b"qemu_bench" + b"\0" * 46
+
+    def send_one(i):
+        seq = i & 0xFFFF
+        icmp = icmp_echo(ICMP_ECHO_REQUEST, BENCH_ICMP_ID, seq, payload)
+        wire.expect("icmp", seq)
+        wire.send(eth_frame(GUEST_MAC, GATEWAY_MAC, ETH_IP, ipv4_packet(src, dst, 1, icmp, i & 0xFFFF)))
+
+    return paced(rate, duration, send_one)
+
+
+def test_arp(wire, rate, duration):
+    guest = ip_bytes(GUEST_IP)
+
+    def send_one(i):
+        host = 16 + i % 200   # 10.0.2.16 - 10.0.2.215，远多于内核的16个缓存条目
+        sip = ip_bytes("10.0.2.%d" % host)
+        smac = bytes.fromhex("5254000a%04x" % host)
+        wire.expect("arp", sip)
+        wire.send(eth_frame(BROADCAST_MAC, smac, ETH_ARP, arp_packet(1, smac, sip, b"\0" * 6, guest)))
+
+    return paced(rate, duration, send_one)
+
+
+def test_udp(wire, rate, duration):
+    src, dst = ip_bytes(GATEWAY_IP), ip_bytes(GUEST_IP)
+    datagram = udp_datagram(src, dst, 40000, 9, b"\0" * 18)
+    frame = eth_frame(GUEST_MAC, GATEWAY_MAC, ETH_IP, ipv4_packet(src, dst, 17, datagram))
+    return paced(rate, duration, lambda i: wire.send(frame))
+
+
+TESTS = {"icmp": test_icmp, "arp": test_arp, "udp": test_udp}
+
+
+def run_test(name, wire, console, rate, duration):
+    console.command("lat reset")
+    before = parse_stats(console.command("stats"))
+    wire.reset()
+    sent = TESTS[name](wire, rate, duration)
+    time.sleep(0.5)   # 等最后的应答
+    after = parse_stats(console.command("stats"))
+    lat = parse_lat(console.command("lat"))
+
+    with wire.lock:
+        rtts = sorted(r * 1e6 for r in wire.rtts)
+        replies = wire.replies
+    uptime = after.get("cpu.uptime_us", 0) - before.get("cpu.uptime_us", 0)
+    idle = after.get("cpu.idle_us", 0) - before.get("cpu.idle_us", 0)
+    rx = after.get("Link.RxFrames", 0) - before.get("Link.RxFrames", 0)
+    total = lat.get("total", {})
+    expects_reply = name != "udp"
+    return {
+        "test": name,
+        "offered_pps": rate,
+        "duration_s": duration,
+        "sent": sent,
+        "replies": replies if expects_reply else None,
+        "loss_pct": round(100.0 * (sent - replies) / sent, 3) if expects_reply and sent else None,
+        "reply_pps": round(replies / duration, 1) if expects_reply else None,
+        "rtt_p50_us": percentile(rtts, 500),
+        "rtt_p90_us": percentile(rtts, 900),
+        "rtt_p99_us": percentile(rtts, 990),
+        "rtt_max_us": rtts[-1] if rtts else None,
+        "guest_rx_pps": round(rx * 1e6 / uptime, 1) if uptime else None,
+        "guest_idle_pct": round(100.0 * idle / uptime, 1) if uptime else None,
+        "guest_total_p50_ns": total.get("p50_ns"),
+        "guest_total_p99_ns": total.get("p99_ns"),
+        "guest_stats_delta": {k: after[k] - before.get(k, 0) for k in after
+                              if not k.startswith("cpu.") and after[k] != before.get(k, 0)},
+        "guest_lat": lat,
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--kernel", default="build/release/kernel.bin")
+    parser.add_argument("--qemu", default="qemu-system-i386")
+    parser.add_argument("--nic", default="rtl8139", choices=("rtl8139", "virtio"))
+    parser.add_argument("--tests", default="icmp,arp,udp", help="comma separated: icmp, arp, udp")
+    parser.add_argument("--rate", type=int, default=2000, help="offered packets per second")
+    parser.add_argument("--duration", type=float, default=5.0, help="seconds per test")
+    parser.add_argument("--label", default="", help="free-form build label stored in the report")
+    parser.add_argument("--json", help="write the report as JSON")
+    parser.add_argument("--csv", help="append one row per test to a CSV file")
+    parser.add_argument("--serial-log", default="bench_serial.log", help="kernel serial output")
+    parser.add_argument("--kvm", action="store_true", help="add -enable-kvm")
+    parser.add_argument("--gcov", action="store_true",
+                        help="PGO training: reset branch counters after boot, 'gcov dump' into the serial log at the end")
+    args = parser.parse_args()
+
+    tests = [t for t in args.tests.split(",") if t]
+    for t in tests:
+        if t not in TESTS:
+            sys.exit("unknown test %r" % t)
+
+    with open(args.kernel, "rb") as f:
+        kernel_sha = hashlib.sha256(f.read()).hexdigest()
+
+    wire = Wire()
+    probe = socket.socket()
+    probe.bind(("127.0.0.1", 0))
+    serial_port = probe.getsockname()[1]
+    probe.close()
+
+    device = "rtl8139" if args.nic == "rtl8139" else "virtio-net-pci,disable-legacy=off"
+    cmd = [args.qemu, "-kernel", args.kernel, "-display", "none", "-no-reboot", "-monitor", "none",
+           "-serial", "tcp:127.0.0.1:%d,server=on,wait=on" % serial_port,
+           "-netdev", "socket,id=n0,udp=127.0.0.1:%d,localaddr=127.0.0.1:%d" % (wire.port, wire.qemu_port),
+           "-device", "%s,netdev=n0,mac=52:54:00:12:34:56" % device]
+    if args.kvm:
+        cmd.append("-enable-kvm")
+    qemu = subprocess.Popen(cmd)
+    log = open(args.serial_log, "w")
+    results = []
+    try:
+        console = Console(serial_port, log)
+        console.read_until(r"console ready.*?\n> ", 60)
+        # 调试构建默认逐包输出调试日志，只保留警告和错误
+        console.command("loglevel all warn")
+        if args.gcov:
+            console.command("gcov reset")
+        for name in tests:
+            print("running %s: %d pps for %.1fs" % (name, args.rate, args.duration), file=sys.stderr)
+            results.append(run_test(name, wire, console, args.rate, args.duration))
+        if args.gcov:
+            console.command("gcov dump", timeout=300)
+        console.close()
+    finally:
+        wire.close()
+        qemu.terminate()
+        qemu.wait()
+        log.close()
+
+    report = {
+        "label": args.label,
+        "date": datetime.datetime.now().isoformat(timespec="seconds"),
+        "kernel": os.path.abspath(args.kernel),
+        "kernel_sha256": kernel_sha,
+        "nic": args.nic,
+        "kvm": args.kvm,
+        "tests": results,
+    }
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(report, f, indent=2)
+    if args.csv:
+        columns = ["label", "date", "kernel_sha256", "nic"] + \
+                  [k for k in results[0] if k not in ("guest_stats_delta", "guest_lat")] if results else []
+        new_file = not os.path.exists(args.csv)
+        with open(args.csv, "a", newline="") as f:
+            writer = csv.DictWriter(f, fieldnames=columns, extrasaction="ignore")
+            if new_file:
+                writer.writeheader()
+            for row in results:
+                writer.writerow(dict(row, label=args.label, date=report["date"],
+                                     kernel_sha256=kernel_sha[:12], nic=args.nic))
+
+    for r in results:
+        print("%-5s sent=%d replies=%s loss=%s%% rtt_p50=%s rtt_p99=%s us guest_rx_pps=%s idle=%s%%"
+              % (r["test"], r["sent"], r["replies"], r["loss_pct"], fmt_us(r["rtt_p50_us"]),
+                 fmt_us(r["rtt_p99_us"]), r["guest_rx_pps"], r["guest_idle_pct"]))
+
+
+def fmt_us(value):
+    return "-" if value is None else "%.0f" % value
+
+
+if __name__ == "__main__":
+    main()
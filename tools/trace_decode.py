@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+"""把内核 trace_dump 的输出 (串口日志或 debugcon.log) 转成 Chrome trace / Perfetto JSON。
+
+用法:
+    python3 tools/trace_decode.py serial_output.log > trace.json
+然后在 chrome://tracing 或 https://ui.perfetto.dev 中打开 trace.json。
+日志中有多次导出时默认使用最后一次，--dump N 选择第 N 次 (从 0 开始)。
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+RECORD = struct.Struct("<QHHIII")
+
+# irq_entry/irq_exit 成对显示为时间段，其余事件显示为瞬时事件
+SPAN_BEGIN = {"irq_entry": "irq"}
+SPAN_END = {"irq_exit": "irq"}
+
+
+def ip_str(value):
+    return "%d.%d.%d.%d" % ((value >> 24) & 0xFF, (value >> 16) & 0xFF,
+                            (value >> 8) & 0xFF, value & 0xFF)
+
+
+# 各事件参数的含义，与 trace.h 中的注释对应
+ARG_FORMAT = {
+    "irq_entry": lambda a: {"irq": a[0]},
+    "irq_exit": lambda a: {"irq": a[0]},
+    "rx_frame": lambda a: {"length": a[0], "ethertype": "0x%04x" % a[1]},
+    "arp_hit": lambda a: {"ip": ip_str(a[0])},
+    "arp_miss": lambda a: {"ip": ip_str(a[0])},
+    "icmp_rx": lambda a: {"type": a[0], "src": ip_str(a[1])},
+    "icmp_tx": lambda a: {"type": a[0], "dst": ip_str(a[1])},
+    "tx_enqueue": lambda a: {"length": a[0], "frags": a[1]},
+    "tx_complete": lambda a: {"value": a[0]},
+}
+
+
+def parse_dumps(lines):
+    """返回每次导出的 (header, events, records) 列表"""
+    dumps = []
+    current = None
+    blob = None
+    for raw in lines:
+        line = raw.strip()
+        if line.startswith("@@TRACE"):
+            header = dict(f.split("=", 1) for f in line.split()[2:] if "=" in f)
+            current = {"header": header, "events": {}, "records": []}
+            dumps.append(current)
+            blob = None
+        elif current is None:
+            continue
+        elif line.startswith("@@EVENT"):
+            _, num, name = line.split(None, 2)
+            current["events"][int(num)] = name
+        elif line.startswith("@@BLOB"):
+            blob = []
+        elif line.startswith("@@END"):
+            blob = None
+        elif blob is not None and line:
+            try:
+                data = bytes.fromhex(line)
+            except ValueError:
+                continue   # 串口上混入的其他输出
+            if len(data) == RECORD.size:
+                current["records"].append(RECORD.unpack(data))
+    return dumps
+
+
+def to_chrome(dump):
+    khz = int(dump["header"].get("khz", "0")) or 1
+    names = dump["events"]
+    records = sorted(dump["records"], key=lambda r: r[0])
+    base = records[0][0] if records else 0
+
+    events = []
+    for cpu in sorted({r[2] for r in records}):
+        events.append({"ph": "M", "name": "thread_name", "pid": 0, "tid": cpu,
+                       "args": {"name": "cpu%d" % cpu}})
+
+    for tsc, event, cpu, a0, a1, a2 in records:
+        name = names.get(event, "event%d" % event)
+        ts = (tsc - base) * 1000.0 / khz   # 微秒
+        args = ARG_FORMAT.get(name, lambda a: {"arg0": a[0], "arg1": a[1], "arg2": a[2]})((a0, a1, a2))
+        entry = {"pid": 0, "tid": cpu, "ts": ts, "args": args}
+        if name in SPAN_BEGIN:
+            entry.update(ph="B", name="%s %d" % (SPAN_BEGIN[name], a0))
+        elif name in SPAN_END:
+            entry.update(ph="E", name="%s %d" % (SPAN_END[name], a0))
+        else:
+            entry.update(ph="i", s="t", name=name)
+        events.append(entry)
+
+    return {"traceEvents": events, "displayTimeUnit": "ns",
+            "otherData": {"tsc_khz": khz, "records": len(records)}}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("log", help="包含 @@TRACE 导出的串口日志")
+    parser.add_argument("--dump", type=int, default=-1, help="使用第几次导出 (默认最后一次)")
+    parser.add_argument("-o", "--output", help="输出文件 (默认标准输出)")
+    args = parser.parse_args()
+
+    with open(args.log, "r", errors="replace") as f:
+        dumps = parse_dumps(f)
+    if not dumps:
+        sys.exit("no @@TRACE dump found in %s" % args.log)
+
+    result = to_chrome(dumps[args.dump])
+    out = open(args.output, "w") if args.output else sys.stdout
+    json.dump(result, out, indent=1)
+    out.write("\n")
+    sys.stderr.write("%d records from %d dump(s)\n" % (result["otherData"]["records"], len(dumps)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,139 @@
+#include "trace.h"
+#include "tsc.h"
+#include "cpu.h"
+#include "kprintf.h"
+#include "serial.h"
+
+// 每个CPU一个环; 写者 (本CPU及其中断) 用原子加预留位置，满了直接覆盖最旧的记录
+struct trace_ring {
+    volatile uint32_t head;     // 已写入的记录总数
+    struct trace_record records[TRACE_RING_SIZE];
+} __cacheline_aligned;
+
+static struct trace_ring trace_rings[NR_CPUS];
+
+volatile uint32_t trace_event_mask = 0;
+
+static const char *const trace_event_names[TRACE_EVENT_COUNT] = {
+    "irq_entry", "irq_exit", "rx_frame", "arp_hit", "arp_miss",
+    "icmp_rx", "icmp_tx", "tx_enqueue", "tx_complete",
+};
+
+void trace_init(void) {
+    trace_reset();
+    trace_event_mask = (1u << TRACE_EVENT_COUNT) - 1;
+}
+
+void trace_record_event(uint16_t event, uint32_t arg0, uint32_t arg1, uint32_t arg2) {
+    uint32_t cpu = smp_processor_id();
+    struct trace_ring *ring = &trace_rings[cpu];
+    uint32_t index = __sync_fetch_and_add(&ring->head, 1);
+    struct trace_record *rec = &ring->records[index & (TRACE_RING_SIZE - 1)];
+
+    rec->tsc = tsc_read();
+    rec->event = event;
+    rec->cpu = cpu;
+    rec->arg0 = arg0;
+    rec->arg1 = arg1;
+    rec->arg2 = arg2;
+}
+
+void trace_enable(uint32_t event, bool enable) {
+    uint32_t bits;
+    if (event == TRACE_EVENT_COUNT) {
+        bits = (1u << TRACE_EVENT_COUNT) - 1;
+    } else if (event < TRACE_EVENT_COUNT) {
+        bits = 1u << event;
+    } else {
+        return;
+    }
+
+    if (enable) {
+        __sync_fetch_and_or(&trace_event_mask, bits);
+    } else {
+        __sync_fetch_and_and(&trace_event_mask, ~bits);
+    }
+}
+
+bool trace_is_enabled(uint32_t event) {
+    return event < TRACE_EVENT_COUNT && (trace_event_mask & (1u << event));
+}
+
+const char *trace_event_name(uint32_t event) {
+    return event < TRACE_EVENT_COUNT ? trace_event_names[event] : "?";
+}
+
+int trace_event_from_name(const char *name) {
+    for (int i = 0; i < TRACE_EVENT_COUNT; i++) {
+        const char *a = trace_event_names[i];
+        const char *b = name;
+        while (*a && *a == *b) {
+            a++;
+            b++;
+        }
+        if (*a == '\0' && *b == '\0') {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void trace_reset(void) {
+    for (int i = 0; i < NR_CPUS; i++) {
+        trace_rings[i].head = 0;
+    }
+}
+
+// 一条记录输出为一行48个十六进制字符 (内存顺序，即小端)
+static void trace_emit_record(const struct trace_record *rec) {
+    static const char digits[] = "0123456789abcdef";
+    const uint8_t *bytes = (const uint8_t *)rec;
+    char line[sizeof(*rec) * 2 + 2];
+    uint32_t pos = 0;
+
+    for (uint32_t i = 0; i < sizeof(*rec); i++) {
+        line[pos++] = digits[bytes[i] >> 4];
+        line[pos++] = digits[bytes[i] & 0xF];
+    }
+    line[pos++] = '\n';
+    line[pos] = '\0';
+    serial_write_string(line);
+}
+
+// 格式:
+//   @@TRACE v1 khz=<TSC频率> cpus=<CPU数> recsize=24
+//   @@EVENT <编号> <名称>          (每个事件一行)
+//   @@BLOB cpu=<n> count=<记录数>  之后每行一条记录，从旧到新
+//   @@END
+void trace_dump(void) {
+    char line[64];
+    uint32_t saved_mask = trace_event_mask;
+    trace_event_mask = 0;
+    mb();
+
+    ksnprintf(line, sizeof(line), "\n@@TRACE v1 khz=%u cpus=%u recsize=%u\n",
+              tsc_khz(), (uint32_t)NR_CPUS, (uint32_t)sizeof(struct trace_record));
+    serial_write_string(line);
+    for (uint32_t i = 0; i < TRACE_EVENT_COUNT; i++) {
+        ksnprintf(line, sizeof(line), "@@EVENT %u %s\n", i, trace_event_names[i]);
+        serial_write_string(line);
+    }
+
+    for (uint32_t cpu = 0; cpu < NR_CPUS; cpu++) {
+        struct trace_ring *ring = &trace_rings[cpu];
+        uint32_t head = ring->head;
+        uint32_t count = head < TRACE_RING_SIZE ? head : TRACE_RING_SIZE;
+        if (count == 0) {
+            continue;
+        }
+
+        ksnprintf(line, sizeof(line), "@@BLOB cpu=%u count=%u\n", cpu, count);
+        serial_write_string(line);
+        for (uint32_t i = head - count; i != head; i++) {
+            trace_emit_record(&ring->records[i & (TRACE_RING_SIZE - 1)]);
+        }
+        serial_write_string("@@END\n");
+    }
+
+    trace_event_mask = saved_mask;
+}
@@ -0,0 +1,64 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "types.h"
+
+// 二进制跟踪点: 每个事件写一条定长记录到本CPU的环形缓冲区
+// 环满时覆盖最旧的记录 (飞行记录器)，由 trace_dump 导出后在主机上用 tools/trace_decode.py 解码
+
+// 事件编号 (与 tools/trace_decode.py 保持一致)
+#define TRACE_IRQ_ENTRY    0   // arg0 = IRQ号 (MSI为向量号)
+#define TRACE_IRQ_EXIT     1   // arg0 = IRQ号 (MSI为向量号)
+#define TRACE_RX_FRAME     2   // arg0 = 帧长, arg1 = 以太网类型
+#define TRACE_ARP_HIT      3   // arg0 = IP
+#define TRACE_ARP_MISS     4   // arg0 = IP
+#define TRACE_ICMP_RX      5   // arg0 = 类型, arg1 = 源IP
+#define TRACE_ICMP_TX      6   // arg0 = 类型, arg1 = 目的IP
+#define TRACE_TX_ENQUEUE   7   // arg0 = 帧长, arg1 = 分片数
+#define TRACE_TX_COMPLETE  8   // arg0 = 槽位/完成数
+#define TRACE_EVENT_COUNT  9
+
+// 每个CPU的记录数 (2的幂)
+#define TRACE_RING_SIZE 1024
+
+// 一条记录 24 字节，小端，主机端按 "<QHHIII" 解析
+struct trace_record {
+    uint64_t tsc;
+    uint16_t event;
+    uint16_t cpu;
+    uint32_t arg0;
+    uint32_t arg1;
+    uint32_t arg2;
+} __attribute__((packed));
+
+// 运行时事件开关，每个事件一位
+extern volatile uint32_t trace_event_mask;
+
+void trace_init(void);
+void trace_record_event(uint16_t event, uint32_t arg0, uint32_t arg1, uint32_t arg2);
+
+// 跟踪点; 关闭的事件只有一次位测试。定义 NO_TRACE 时完全不编译
+#ifdef NO_TRACE
+#define TRACE(event, a0, a1, a2) do { } while (0)
+#else
+#define TRACE(event, a0, a1, a2) do { \
+    if (trace_event_mask & (1u << (event))) { \
+        trace_record_event((event), (uint32_t)(a0), (uint32_t)(a1), (uint32_t)(a2)); \
+    } \
+} while (0)
+#endif
+
+// 单个事件的开关; event 为 TRACE_EVENT_COUNT 时作用于全部事件
+void trace_enable(uint32_t event, bool enable);
+bool trace_is_enabled(uint32_t event);
+const char *trace_event_name(uint32_t event);
+int trace_event_from_name(const char *name);
+
+// 清空所有CPU的记录
+void trace_reset(void);
+
+// 把全部记录以十六进制块写到当前串口输出 (UART/debugcon)
+// 导出期间暂停记录，导出后恢复原来的事件开关
+void trace_dump(void);
+
+#endif // TRACE_H
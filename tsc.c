@@ -0,0 +1,61 @@
+#include "tsc.h"
+#include "io.h"
+#include "serial.h"
+
+// PIT 端口与输入时钟
+#define PIT_CH2_DATA   0x42
+#define PIT_CMD        0x43
+#define PIT_CH2_GATE   0x61
+#define PIT_HZ         1193182
+#define TSC_CALIBRATE_MS 10
+
+// 未校准时假设 1GHz，保证换算不会除零
+static uint32_t tsc_freq_khz = 1000000;
+static uint64_t tsc_boot = 0;
+
+// 通道2以模式0计数 10ms，端口0x61的bit5在计数到0时变高
+void tsc_init(void) {
+    uint8_t gate = inb(PIT_CH2_GATE);
+    outb(PIT_CH2_GATE, (gate & ~0x02) | 0x01);   // 打开门控，关闭扬声器
+
+    uint16_t count = PIT_HZ / (1000 / TSC_CALIBRATE_MS);
+    outb(PIT_CMD, 0xB0);                          // 通道2，低/高字节，模式0
+    outb(PIT_CH2_DATA, count & 0xFF);
+    outb(PIT_CH2_DATA, count >> 8);
+
+    uint64_t start = tsc_read();
+    int timeout = 10000000;
+    while (!(inb(PIT_CH2_GATE) & 0x20) && --timeout) {}
+    uint64_t end = tsc_read();
+
+    outb(PIT_CH2_GATE, gate);
+
+    if (timeout && end > start) {
+        tsc_freq_khz = (uint32_t)(end - start) / TSC_CALIBRATE_MS;
+    }
+    tsc_boot = tsc_read();
+
+    serial_write_string("TSC: ");
+    serial_write_dec(tsc_freq_khz / 1000);
+    serial_write_string(" MHz\r\n");
+}
+
+uint32_t tsc_khz(void) {
+    return tsc_freq_khz;
+}
+
+uint64_t tsc_to_us(uint64_t cycles) {
+    return div64_u32(cycles * 1000, tsc_freq_khz, NULL);
+}
+
+uint64_t tsc_from_us(uint32_t us) {
+    return div64_u32((uint64_t)us * tsc_freq_khz, 1000, NULL);
+}
+
+uint64_t tsc_to_uptime_us(uint64_t tsc) {
+    return tsc > tsc_boot ? tsc_to_us(tsc - tsc_boot) : 0;
+}
+
+uint64_t tsc_uptime_us(void) {
+    return tsc_to_uptime_us(tsc_read());
+}
@@ -0,0 +1,45 @@
+#ifndef TSC_H
+#define TSC_H
+
+#include "types.h"
+
+// 读取时间戳计数器
+static inline uint64_t tsc_read(void) {
+    uint32_t lo, hi;
+    asm volatile ("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+// 有序的TSC读取: 第一个 lfence 等之前的指令执行完，第二个让之后的指令不提前开始
+// 比 cpuid 便宜得多 (虚拟机中 cpuid 会引起VM exit)，用于测量短代码段
+static inline uint64_t tsc_read_fenced(void) {
+    uint32_t lo, hi;
+    asm volatile ("lfence; rdtsc; lfence" : "=a"(lo), "=d"(hi) : : "memory");
+    return ((uint64_t)hi << 32) | lo;
+}
+
+// 64位除以32位 (避免依赖 libgcc 的 __udivdi3)，余数写入 rem
+static inline uint64_t div64_u32(uint64_t n, uint32_t d, uint32_t *rem) {
+    uint32_t hi = (uint32_t)(n >> 32);
+    uint32_t lo = (uint32_t)n;
+    uint32_t q_hi = hi / d;
+    uint32_t r = hi % d;
+    uint32_t q_lo;
+    asm ("divl %4" : "=a"(q_lo), "=d"(r) : "a"(lo), "d"(r), "rm"(d));
+    if (rem) *rem = r;
+    return ((uint64_t)q_hi << 32) | q_lo;
+}
+
+// 用PIT通道2校准TSC频率
+void tsc_init(void);
+uint32_t tsc_khz(void);
+// 周期数换算为微秒
+uint64_t tsc_to_us(uint64_t cycles);
+// 微秒换算为周期数 (计算轮询的截止时间)
+uint64_t tsc_from_us(uint32_t us);
+// 某个TSC读数距启动的微秒数
+uint64_t tsc_to_uptime_us(uint64_t tsc);
+// 启动以来的微秒数
+uint64_t tsc_uptime_us(void);
+
+#endif // TSC_H
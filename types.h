@@ -1,12 +1,20 @@
 #ifndef TYPES_H
 #define TYPES_H
 
+#ifdef HOST_BUILD
+// 主机构建 (host/): 使用libc的定义，指针可能是64位
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#else
 typedef unsigned char uint8_t;
 typedef unsigned short uint16_t;
 typedef unsigned int uint32_t;
 typedef unsigned long long uint64_t;
 
 typedef unsigned int size_t;
+// 与指针等宽的整数
+typedef unsigned int uintptr_t;
 
 // 布尔类型定义
 #ifndef __cplusplus
@@ -17,5 +25,6 @@ typedef _Bool bool;
 
 // NULL定义
 #define NULL ((void*)0)
+#endif
 
 #endif /* TYPES_H */
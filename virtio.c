@@ -0,0 +1,174 @@
+#include "virtio.h"
+#include "io.h"
+#include "cpu.h"
+#include "memory.h"
+#include "serial.h"
+
+// 设备复位
+void virtio_reset(uint16_t iobase) {
+    outb(iobase + VIRTIO_PCI_STATUS, 0);
+}
+
+void virtio_add_status(uint16_t iobase, uint8_t status) {
+    outb(iobase + VIRTIO_PCI_STATUS, inb(iobase + VIRTIO_PCI_STATUS) | status);
+}
+
+// 特性协商，返回双方都支持的特性
+uint32_t virtio_negotiate_features(uint16_t iobase, uint32_t wanted) {
+    uint32_t host = inl(iobase + VIRTIO_PCI_HOST_FEATURES);
+    uint32_t guest = host & wanted;
+    outl(iobase + VIRTIO_PCI_GUEST_FEATURES, guest);
+    return guest;
+}
+
+// 设备配置区的起始，启用MSI-X后多出两个向量寄存器
+static uint16_t virtio_config_base = VIRTIO_PCI_CONFIG;
+
+uint8_t virtio_config_read8(uint16_t iobase, uint16_t offset) {
+    return inb(iobase + virtio_config_base + offset);
+}
+
+uint16_t virtio_config_read16(uint16_t iobase, uint16_t offset) {
+    return inw(iobase + virtio_config_base + offset);
+}
+
+void virtio_msix_init(uint16_t iobase) {
+    virtio_config_base = VIRTIO_PCI_CONFIG_MSIX;
+    outw(iobase + VIRTIO_MSI_CONFIG_VECTOR, VIRTIO_MSI_NO_VECTOR);
+}
+
+void virtio_msix_disable(void) {
+    virtio_config_base = VIRTIO_PCI_CONFIG;
+}
+
+static uint32_t vring_align(uint32_t size) {
+    return (size + VRING_ALIGN - 1) & ~(VRING_ALIGN - 1);
+}
+
+// 初始化第 index 个队列: 分配页对齐的vring并告知设备
+bool virtq_init(struct virtq *vq, uint16_t iobase, uint16_t index) {
+    outw(iobase + VIRTIO_PCI_QUEUE_SEL, index);
+    uint16_t size = inw(iobase + VIRTIO_PCI_QUEUE_NUM);
+    if (size == 0 || size > VIRTQ_MAX_SIZE) {
+        serial_write_string("virtio: unsupported queue size ");
+        serial_write_dec(size);
+        serial_write_string("\r\n");
+        return false;
+    }
+
+    uint32_t desc_avail = sizeof(struct vring_desc) * size + sizeof(uint16_t) * (3 + size);
+    uint32_t used = sizeof(uint16_t) * 3 + sizeof(struct vring_used_elem) * size;
+    uint32_t total = vring_align(desc_avail) + vring_align(used);
+
+    uint32_t mem = (uint32_t)kmalloc(total + VRING_ALIGN);
+    mem = vring_align(mem);
+    memset((void *)mem, 0, total);
+
+    vq->iobase = iobase;
+    vq->index = index;
+    vq->size = size;
+    vq->desc = (struct vring_desc *)mem;
+    vq->avail = (struct vring_avail *)(mem + sizeof(struct vring_desc) * size);
+    vq->used = (struct vring_used *)(mem + vring_align(desc_avail));
+    vq->last_used_idx = 0;
+
+    // 所有描述符串成空闲链表
+    for (uint16_t i = 0; i < size; i++) {
+        vq->desc[i].next = i + 1;
+        vq->tokens[i] = NULL;
+    }
+    vq->free_head = 0;
+    vq->num_free = size;
+
+    // 默认轮询used ring，不需要中断; 绑定了MSI-X向量的队列由驱动打开
+    vq->avail->flags = VRING_AVAIL_F_NO_INTERRUPT;
+
+    outl(iobase + VIRTIO_PCI_QUEUE_PFN, mem / VRING_ALIGN);
+    return true;
+}
+
+bool virtq_add(struct virtq *vq, const struct virtq_buf *bufs, int out_num, int in_num, void *token) {
+    int total = out_num + in_num;
+    if (total == 0 || total > vq->num_free) {
+        return false;
+    }
+
+    uint16_t head = vq->free_head;
+    uint16_t idx = head;
+    uint16_t last = head;
+    for (int i = 0; i < total; i++) {
+        struct vring_desc *d = &vq->desc[idx];
+        d->addr = (uint32_t)bufs[i].addr;
+        d->len = bufs[i].len;
+        d->flags = (i < out_num) ? 0 : VRING_DESC_F_WRITE;
+        if (i + 1 < total) {
+            d->flags |= VRING_DESC_F_NEXT;
+        }
+        last = idx;
+        idx = d->next;
+    }
+    vq->free_head = vq->desc[last].next;
+    vq->num_free -= total;
+    vq->tokens[head] = token;
+
+    // 先写好描述符再发布到avail ring
+    vq->avail->ring[vq->avail->idx % vq->size] = head;
+    barrier();
+    vq->avail->idx++;
+    return true;
+}
+
+void virtq_kick(struct virtq *vq) {
+    mb();
+    outw(vq->iobase + VIRTIO_PCI_QUEUE_NOTIFY, vq->index);
+}
+
+bool virtq_has_used(struct virtq *vq) {
+    barrier();
+    return vq->last_used_idx != *(volatile uint16_t *)&vq->used->idx;
+}
+
+void *virtq_get_used(struct virtq *vq, uint32_t *len) {
+    if (!virtq_has_used(vq)) {
+        return NULL;
+    }
+
+    struct vring_used_elem *e = &vq->used->ring[vq->last_used_idx % vq->size];
+    uint16_t head = e->id;
+    if (len) {
+        *len = e->len;
+    }
+    vq->last_used_idx++;
+
+    // 把整条链还给空闲链表
+    uint16_t idx = head;
+    uint16_t count = 1;
+    while (vq->desc[idx].flags & VRING_DESC_F_NEXT) {
+        idx = vq->desc[idx].next;
+        count++;
+    }
+    vq->desc[idx].next = vq->free_head;
+    vq->free_head = head;
+    vq->num_free += count;
+
+    void *token = vq->tokens[head];
+    vq->tokens[head] = NULL;
+    return token;
+}
+
+bool virtq_set_vector(struct virtq *vq, uint16_t entry) {
+    outw(vq->iobase + VIRTIO_PCI_QUEUE_SEL, vq->index);
+    outw(vq->iobase + VIRTIO_MSI_QUEUE_VECTOR, entry);
+    // 设备无法分配中断资源时读回 NO_VECTOR
+    return inw(vq->iobase + VIRTIO_MSI_QUEUE_VECTOR) == entry;
+}
+
+void virtq_enable_interrupts(struct virtq *vq) {
+    vq->avail->flags &= ~VRING_AVAIL_F_NO_INTERRUPT;
+    // 标志写入必须先于调用者随后对 used->idx 的检查
+    mb();
+}
+
+void virtq_disable_interrupts(struct virtq *vq) {
+    vq->avail->flags |= VRING_AVAIL_F_NO_INTERRUPT;
+}
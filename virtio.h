@@ -0,0 +1,114 @@
+#ifndef VIRTIO_H
+#define VIRTIO_H
+
+#include "types.h"
+
+// PCI 配置
+#define VIRTIO_VENDOR_ID 0x1AF4
+
+// Legacy virtio-pci I/O 寄存器偏移
+#define VIRTIO_PCI_HOST_FEATURES  0x00
+#define VIRTIO_PCI_GUEST_FEATURES 0x04
+#define VIRTIO_PCI_QUEUE_PFN      0x08
+#define VIRTIO_PCI_QUEUE_NUM      0x0C
+#define VIRTIO_PCI_QUEUE_SEL      0x0E
+#define VIRTIO_PCI_QUEUE_NOTIFY   0x10
+#define VIRTIO_PCI_STATUS         0x12
+#define VIRTIO_PCI_ISR            0x13
+#define VIRTIO_PCI_CONFIG         0x14  // 未启用MSI-X时设备配置空间的起始
+#define VIRTIO_MSI_CONFIG_VECTOR  0x14  // 以下两个寄存器只在启用MSI-X后存在
+#define VIRTIO_MSI_QUEUE_VECTOR   0x16
+#define VIRTIO_PCI_CONFIG_MSIX    0x18  // 启用MSI-X后设备配置空间的起始
+
+// 不使用中断的队列或配置变更
+#define VIRTIO_MSI_NO_VECTOR      0xFFFF
+
+// 设备状态位
+#define VIRTIO_STATUS_ACKNOWLEDGE 0x01
+#define VIRTIO_STATUS_DRIVER      0x02
+#define VIRTIO_STATUS_DRIVER_OK   0x04
+#define VIRTIO_STATUS_FAILED      0x80
+
+// 描述符标志
+#define VRING_DESC_F_NEXT   1
+#define VRING_DESC_F_WRITE  2
+
+// avail 标志: 不需要设备发中断
+#define VRING_AVAIL_F_NO_INTERRUPT 1
+
+// legacy 布局要求 used ring 按页对齐
+#define VRING_ALIGN 4096
+
+// 驱动支持的最大队列长度
+#define VIRTQ_MAX_SIZE 256
+
+struct vring_desc {
+    uint64_t addr;
+    uint32_t len;
+    uint16_t flags;
+    uint16_t next;
+} __attribute__((packed));
+
+struct vring_avail {
+    uint16_t flags;
+    uint16_t idx;
+    uint16_t ring[];
+} __attribute__((packed));
+
+struct vring_used_elem {
+    uint32_t id;
+    uint32_t len;
+} __attribute__((packed));
+
+struct vring_used {
+    uint16_t flags;
+    uint16_t idx;
+    struct vring_used_elem ring[];
+} __attribute__((packed));
+
+// 一个虚拟队列
+struct virtq {
+    uint16_t iobase;
+    uint16_t index;
+    uint16_t size;
+    uint16_t free_head;
+    uint16_t num_free;
+    uint16_t last_used_idx;
+    struct vring_desc *desc;
+    struct vring_avail *avail;
+    struct vring_used *used;
+    void *tokens[VIRTQ_MAX_SIZE];   // 以链头描述符下标索引
+};
+
+// 加入队列的一段缓冲区
+struct virtq_buf {
+    const void *addr;
+    uint32_t len;
+};
+
+// 设备级操作
+void virtio_reset(uint16_t iobase);
+void virtio_add_status(uint16_t iobase, uint8_t status);
+uint32_t virtio_negotiate_features(uint16_t iobase, uint32_t wanted);
+uint8_t virtio_config_read8(uint16_t iobase, uint16_t offset);
+uint16_t virtio_config_read16(uint16_t iobase, uint16_t offset);
+// 功能的MSI-X已启用: 设备配置区后移，配置变更不发中断 (只支持一个virtio设备)
+void virtio_msix_init(uint16_t iobase);
+// 功能的MSI-X已关闭: 设备配置区回到 0x14
+void virtio_msix_disable(void);
+
+// 队列操作
+bool virtq_init(struct virtq *vq, uint16_t iobase, uint16_t index);
+// 前 out_num 段由设备读取，后 in_num 段由设备写入；返回 false 表示描述符不足
+bool virtq_add(struct virtq *vq, const struct virtq_buf *bufs, int out_num, int in_num, void *token);
+void virtq_kick(struct virtq *vq);
+// 取回一个已完成的缓冲区，没有时返回 NULL
+void *virtq_get_used(struct virtq *vq, uint32_t *len);
+bool virtq_has_used(struct virtq *vq);
+// 队列使用第 entry 个MSI-X表项; 设备无法分配时返回 false
+bool virtq_set_vector(struct virtq *vq, uint16_t entry);
+// 打开/关闭设备在 used ring 更新后发中断 (avail 标志只是提示，关闭后仍可能收到一个)
+void virtq_enable_interrupts(struct virtq *vq);
+void virtq_disable_interrupts(struct virtq *vq);
+
+#endif // VIRTIO_H
@@ -0,0 +1,565 @@
+#include "virtio_net.h"
+#include "virtio.h"
+#include "netdev.h"
+#include "network.h"
+#include "rss.h"
+#include "pci.h"
+#include "io.h"
+#include "memory.h"
+#include "terminal.h"
+#include "serial.h"
+#include "trace.h"
+#include "tsc.h"
+#include "netlat.h"
+#include "region.h"
+#include "msi.h"
+
+// 接收缓冲区: 头和帧分别作为两个描述符
+struct vnet_rx_buf {
+    struct virtio_net_hdr hdr;
+    uint8_t frame[VIRTIO_NET_FRAME_MAX];
+};
+
+// 发送槽位; 帧缓冲区只存放第一个分片 (协议头)，负载分片按引用挂在描述符链上
+struct vnet_tx_slot {
+    struct virtio_net_hdr hdr;
+    uint8_t *frame;
+    bool busy;
+};
+
+// 一个RX/TX队列对，绑定到一个CPU
+struct vnet_queue_pair {
+    struct virtq rx;
+    struct virtq tx;
+    struct vnet_rx_buf *rx_bufs;
+    struct vnet_tx_slot *tx_slots;
+    uint16_t tx_next;
+    uint32_t cpu;
+    uint8_t rx_vector;           // MSI-X向量，0表示没有 (一直轮询)
+    volatile bool rx_pending;    // 有向量时: 中断已到，等待轮询处理
+    struct virtio_net_queue_stats stats;
+};
+
+static uint16_t vnet_iobase = 0;
+static uint32_t vnet_features = 0;
+static uint16_t vnet_num_pairs = 0;
+static uint32_t vnet_tx_frame_max = VIRTIO_NET_FRAME_MAX;
+static struct vnet_queue_pair vnet_pairs[VIRTIO_NET_MAX_PAIRS];
+static struct virtq vnet_ctrl;
+static bool vnet_has_ctrl = false;
+
+static bool virtio_net_xmit(struct netdev *dev, const struct netdev_frag *frags, int nfrags,
+                            uint16_t length, const struct netdev_tx_meta *meta);
+static void virtio_net_tx_drain(struct netdev *dev);
+static uint8_t *virtio_net_tx_reserve(struct netdev *dev, uint16_t length);
+static bool virtio_net_tx_commit(struct netdev *dev, uint16_t length,
+                                 const struct netdev_tx_meta *meta);
+static void virtio_net_poll(struct netdev *dev);
+
+static const struct netdev_ops virtio_net_ops = {
+    .xmit = virtio_net_xmit,
+    .tx_drain = virtio_net_tx_drain,
+    .tx_reserve = virtio_net_tx_reserve,
+    .tx_commit = virtio_net_tx_commit,
+    .poll = virtio_net_poll,
+};
+
+static struct netdev virtio_netdev = {
+    .name = "eth0",
+    .mtu = 1500,
+    .features = NETDEV_F_SG,
+    .ops = &virtio_net_ops,
+};
+
+// 当前CPU使用的队列对
+static struct vnet_queue_pair *vnet_local_pair(void) {
+    return &vnet_pairs[smp_processor_id() % vnet_num_pairs];
+}
+
+// 把一个接收缓冲区交给设备
+static bool vnet_rx_post(struct vnet_queue_pair *qp, struct vnet_rx_buf *buf) {
+    struct virtq_buf bufs[2] = {
+        { &buf->hdr, sizeof(buf->hdr) },
+        { buf->frame, VIRTIO_NET_FRAME_MAX },
+    };
+    return virtq_add(&qp->rx, bufs, 0, 2, buf);
+}
+
+// 回收已发送完成的槽位
+static void vnet_tx_reclaim(struct vnet_queue_pair *qp) {
+    struct vnet_tx_slot *slot;
+    uint32_t completed = 0;
+    while ((slot = virtq_get_used(&qp->tx, NULL)) != NULL) {
+        slot->busy = false;
+        completed++;
+    }
+    if (completed) {
+        qp->stats.tx_completed += completed;
+        TRACE(TRACE_TX_COMPLETE, completed, 0, 0);
+    }
+}
+
+// 通过控制队列发送命令，同步等待设备应答
+static bool vnet_ctrl_cmd(uint8_t class, uint8_t cmd, const void *data, uint32_t length) {
+    static struct {
+        uint8_t class;
+        uint8_t cmd;
+    } __attribute__((packed)) ctrl_hdr;
+    static volatile uint8_t ack;
+
+    if (!vnet_has_ctrl) {
+        return false;
+    }
+
+    ctrl_hdr.class = class;
+    ctrl_hdr.cmd = cmd;
+    ack = 0xFF;
+
+    struct virtq_buf bufs[3] = {
+        { &ctrl_hdr, sizeof(ctrl_hdr) },
+        { data, length },
+        { (const void *)&ack, 1 },
+    };
+    if (!virtq_add(&vnet_ctrl, bufs, 2, 1, &ctrl_hdr)) {
+        return false;
+    }
+    virtq_kick(&vnet_ctrl);
+
+    for (int timeout = 1000000; timeout > 0; timeout--) {
+        if (virtq_get_used(&vnet_ctrl, NULL)) {
+            return ack == VIRTIO_NET_OK;
+        }
+    }
+    serial_write_string("virtio-net: control command timeout\r\n");
+    return false;
+}
+
+static bool vnet_setup_pair(uint16_t i) {
+    struct vnet_queue_pair *qp = &vnet_pairs[i];
+    memset(&qp->stats, 0, sizeof(qp->stats));
+    qp->cpu = i % num_online_cpus();
+    qp->tx_next = 0;
+
+    if (!virtq_init(&qp->rx, vnet_iobase, 2 * i) ||
+        !virtq_init(&qp->tx, vnet_iobase, 2 * i + 1)) {
+        return false;
+    }
+
+    qp->rx_bufs = (struct vnet_rx_buf *)kmalloc(sizeof(struct vnet_rx_buf) * VIRTIO_NET_RX_BUFS);
+    qp->tx_slots = (struct vnet_tx_slot *)kmalloc(sizeof(struct vnet_tx_slot) * VIRTIO_NET_TX_SLOTS);
+    memset(qp->tx_slots, 0, sizeof(struct vnet_tx_slot) * VIRTIO_NET_TX_SLOTS);
+    for (int t = 0; t < VIRTIO_NET_TX_SLOTS; t++) {
+        qp->tx_slots[t].frame = (uint8_t *)kmalloc(VIRTIO_NET_FRAME_MAX);
+    }
+
+    for (int b = 0; b < VIRTIO_NET_RX_BUFS; b++) {
+        if (!vnet_rx_post(qp, &qp->rx_bufs[b])) {
+            break;
+        }
+    }
+    return true;
+}
+
+// RX队列的MSI-X中断: 关闭该队列的中断并标记，由队列所在CPU的轮询处理 (NAPI方式)
+// 连续到达的帧在轮询清空队列之前不再产生中断
+static void vnet_rx_irq(void *data) {
+    struct vnet_queue_pair *qp = (struct vnet_queue_pair *)data;
+    qp->stats.rx_irqs++;
+    virtq_disable_interrupts(&qp->rx);
+    qp->rx_pending = true;
+}
+
+// 每个RX队列一个MSI-X表项和向量，消息发往队列所在CPU的LAPIC，不经过PIC
+// 发送完成在发送路径上回收，配置变更不处理，都不需要向量
+static void vnet_setup_msix(struct pci_dev *dev) {
+    if (pci_msix_table_size(dev) < vnet_num_pairs || !pci_msix_enable(dev)) {
+        return;
+    }
+    virtio_msix_init(vnet_iobase);
+    for (uint16_t i = 0; i < vnet_num_pairs; i++) {
+        struct vnet_queue_pair *qp = &vnet_pairs[i];
+        uint8_t vector = msi_alloc_vector("virtio-net rx", vnet_rx_irq, qp, qp->cpu);
+        if (vector) {
+            qp->rx_vector = vector;
+        }
+        if (!vector || !pci_msix_set_vector(dev, i, vector) || !virtq_set_vector(&qp->rx, i)) {
+            // 全部退回轮询: 先关闭MSI-X (设备配置区随之移回)，再释放向量
+            serial_write_string("virtio-net: MSI-X vector setup failed, polling\r\n");
+            pci_msix_disable(dev);
+            virtio_msix_disable();
+            for (uint16_t j = 0; j <= i; j++) {
+                if (vnet_pairs[j].rx_vector) {
+                    msi_free_vector(vnet_pairs[j].rx_vector);
+                    vnet_pairs[j].rx_vector = 0;
+                }
+            }
+            return;
+        }
+    }
+    // 第一次轮询处理已有的帧并打开中断
+    for (uint16_t i = 0; i < vnet_num_pairs; i++) {
+        vnet_pairs[i].rx_pending = true;
+    }
+}
+
+// 传统 (0.9.5) 接口的网卡，配置在I/O BAR中
+static const struct pci_device_id virtio_net_ids[] = {
+    PCI_DEVICE(VIRTIO_VENDOR_ID, VIRTIO_NET_DEVICE_ID),
+    { 0 },
+};
+
+static bool virtio_net_probe(struct pci_dev *dev, const struct pci_device_id *id);
+
+struct pci_driver virtio_net_pci_driver = {
+    .name = "virtio-net",
+    .id_table = virtio_net_ids,
+    .probe = virtio_net_probe,
+};
+
+// 初始化virtio-net网卡
+static bool virtio_net_probe(struct pci_dev *dev, const struct pci_device_id *id) {
+    (void)id;
+    // 协议栈只使用一块网卡
+    if (netdev_get_default()) {
+        return false;
+    }
+
+    terminal_writestring("\n=== virtio-net Initialization ===\n");
+    serial_write_string("\r\n=== virtio-net Initialization ===\r\n");
+
+    vnet_iobase = pci_iobase(dev);
+    if (!vnet_iobase) {
+        terminal_writestring("virtio-net: no I/O BAR (legacy interface disabled?)\n");
+        return false;
+    }
+    pci_enable_device(dev, PCI_COMMAND_IO | PCI_COMMAND_MASTER);
+
+    virtio_reset(vnet_iobase);
+    virtio_add_status(vnet_iobase, VIRTIO_STATUS_ACKNOWLEDGE);
+    virtio_add_status(vnet_iobase, VIRTIO_STATUS_DRIVER);
+
+    vnet_features = virtio_negotiate_features(vnet_iobase,
+        VIRTIO_NET_F_CSUM | VIRTIO_NET_F_GUEST_CSUM | VIRTIO_NET_F_HOST_TSO4 |
+        VIRTIO_NET_F_MAC | VIRTIO_NET_F_STATUS | VIRTIO_NET_F_CTRL_VQ | VIRTIO_NET_F_MQ);
+
+    // 卸载能力; TSO依赖发送校验和卸载
+    if (vnet_features & VIRTIO_NET_F_CSUM) {
+        virtio_netdev.features |= NETDEV_F_TX_CSUM;
+        if (vnet_features & VIRTIO_NET_F_HOST_TSO4) {
+            virtio_netdev.features |= NETDEV_F_TSO4;
+            vnet_tx_frame_max = NETDEV_GSO_MAX_FRAME;
+        }
+    }
+    if (vnet_features & VIRTIO_NET_F_GUEST_CSUM) {
+        virtio_netdev.features |= NETDEV_F_RX_CSUM;
+    }
+
+    // 每个CPU一个队列对，不超过设备支持的数量
+    uint16_t max_pairs = 1;
+    if (vnet_features & VIRTIO_NET_F_MQ) {
+        max_pairs = virtio_config_read16(vnet_iobase, VIRTIO_NET_CFG_MAX_PAIRS);
+    }
+    vnet_num_pairs = max_pairs;
+    if (vnet_num_pairs > num_online_cpus()) vnet_num_pairs = num_online_cpus();
+    if (vnet_num_pairs > VIRTIO_NET_MAX_PAIRS) vnet_num_pairs = VIRTIO_NET_MAX_PAIRS;
+
+    if (vnet_features & VIRTIO_NET_F_MAC) {
+        for (int i = 0; i < 6; i++) {
+            virtio_netdev.mac_addr[i] = virtio_config_read8(vnet_iobase, VIRTIO_NET_CFG_MAC + i);
+        }
+    }
+
+    for (uint16_t i = 0; i < vnet_num_pairs; i++) {
+        if (!vnet_setup_pair(i)) {
+            terminal_writestring("virtio-net: queue setup failed\n");
+            virtio_add_status(vnet_iobase, VIRTIO_STATUS_FAILED);
+            return false;
+        }
+    }
+
+    // 控制队列位于所有数据队列之后
+    if (vnet_features & VIRTIO_NET_F_CTRL_VQ) {
+        vnet_has_ctrl = virtq_init(&vnet_ctrl, vnet_iobase, 2 * max_pairs);
+    }
+
+    // 队列向量必须在 DRIVER_OK 之前设置
+    vnet_setup_msix(dev);
+
+    virtio_add_status(vnet_iobase, VIRTIO_STATUS_DRIVER_OK);
+
+    for (uint16_t i = 0; i < vnet_num_pairs; i++) {
+        virtq_kick(&vnet_pairs[i].rx);
+    }
+
+    // 设备默认只启用第一对队列
+    if (vnet_num_pairs > 1) {
+        uint16_t pairs = vnet_num_pairs;
+        if (!vnet_ctrl_cmd(VIRTIO_NET_CTRL_MQ, VIRTIO_NET_CTRL_MQ_VQ_PAIRS_SET, &pairs, sizeof(pairs))) {
+            serial_write_string("virtio-net: failed to enable multiqueue, using 1 pair\r\n");
+            vnet_num_pairs = 1;
+        }
+    }
+
+    rss_init();
+    netdev_register(&virtio_netdev);
+
+    terminal_writestring("virtio-net I/O Base: 0x");
+    terminal_writehex16(vnet_iobase);
+    terminal_writestring(" Queue pairs: ");
+    terminal_writedec(vnet_num_pairs);
+    terminal_writestring("/");
+    terminal_writedec(max_pairs);
+    terminal_writestring("\n");
+
+    serial_write_string("virtio-net features: ");
+    serial_write_hex32(vnet_features);
+    serial_write_string(" queue pairs: ");
+    serial_write_dec(vnet_num_pairs);
+    serial_write_string("\r\n");
+    return true;
+}
+
+// 取当前队列对的下一个空闲发送槽位
+static struct vnet_tx_slot *vnet_tx_next_slot(struct vnet_queue_pair *qp) {
+    vnet_tx_reclaim(qp);
+
+    struct vnet_tx_slot *slot = &qp->tx_slots[qp->tx_next];
+    if (slot->busy) {
+        qp->stats.tx_ring_full++;
+        return NULL;
+    }
+    return slot;
+}
+
+// 按卸载信息填写virtio-net头
+static void vnet_tx_fill_hdr(struct vnet_queue_pair *qp, struct vnet_tx_slot *slot,
+                             const struct netdev_tx_meta *meta) {
+    memset(&slot->hdr, 0, sizeof(slot->hdr));
+    if (meta && (meta->flags & NETDEV_TX_CSUM_PARTIAL)) {
+        slot->hdr.flags = VIRTIO_NET_HDR_F_NEEDS_CSUM;
+        slot->hdr.csum_start = meta->csum_start;
+        slot->hdr.csum_offset = meta->csum_offset;
+        qp->stats.tx_csum_offload++;
+    }
+    if (meta && (meta->flags & NETDEV_TX_GSO_TCPV4)) {
+        slot->hdr.gso_type = VIRTIO_NET_HDR_GSO_TCPV4;
+        slot->hdr.gso_size = meta->gso_size;
+        slot->hdr.hdr_len = meta->hdr_len;
+        qp->stats.tx_tso++;
+    }
+}
+
+// 把槽位的描述符链放入发送队列并通知设备
+static bool vnet_tx_submit(struct vnet_queue_pair *qp, struct vnet_tx_slot *slot,
+                           const struct virtq_buf *bufs, int n, uint16_t length) {
+    if (!virtq_add(&qp->tx, bufs, n, 0, slot)) {
+        qp->stats.tx_ring_full++;
+        return false;
+    }
+    slot->busy = true;
+    qp->tx_next = (qp->tx_next + 1) % VIRTIO_NET_TX_SLOTS;
+    virtq_kick(&qp->tx);
+
+    qp->stats.tx_packets++;
+    qp->stats.tx_bytes += length;
+    return true;
+}
+
+static bool virtio_net_xmit(struct netdev *dev, const struct netdev_frag *frags, int nfrags,
+                            uint16_t length, const struct netdev_tx_meta *meta) {
+    (void)dev;
+    struct vnet_queue_pair *qp = vnet_local_pair();
+
+    if (length > vnet_tx_frame_max || frags[0].length > VIRTIO_NET_FRAME_MAX) {
+        return false;
+    }
+
+    struct vnet_tx_slot *slot = vnet_tx_next_slot(qp);
+    if (!slot) {
+        return false;
+    }
+    vnet_tx_fill_hdr(qp, slot, meta);
+
+    // 头部分片复制到槽位，调用者可以立即重用; 其余分片由设备直接读取
+    memcpy(slot->frame, frags[0].data, frags[0].length);
+
+    struct virtq_buf bufs[NETDEV_MAX_FRAGS + 1];
+    int n = 0;
+    bufs[n].addr = &slot->hdr;
+    bufs[n++].len = sizeof(slot->hdr);
+    bufs[n].addr = slot->frame;
+    bufs[n++].len = frags[0].length;
+    for (int i = 1; i < nfrags; i++) {
+        if (frags[i].length) {
+            bufs[n].addr = frags[i].data;
+            bufs[n++].len = frags[i].length;
+        }
+    }
+
+    if (!vnet_tx_submit(qp, slot, bufs, n, length)) {
+        return false;
+    }
+    if (nfrags > 1) {
+        qp->stats.tx_sg++;
+    }
+    return true;
+}
+
+// 预留: 协议层直接在下一个槽位的帧缓冲区中构造帧
+static uint8_t *virtio_net_tx_reserve(struct netdev *dev, uint16_t length) {
+    (void)dev;
+    if (length > VIRTIO_NET_FRAME_MAX) {
+        return NULL;
+    }
+    struct vnet_tx_slot *slot = vnet_tx_next_slot(vnet_local_pair());
+    return slot ? slot->frame : NULL;
+}
+
+static bool virtio_net_tx_commit(struct netdev *dev, uint16_t length,
+                                 const struct netdev_tx_meta *meta) {
+    (void)dev;
+    struct vnet_queue_pair *qp = vnet_local_pair();
+    struct vnet_tx_slot *slot = &qp->tx_slots[qp->tx_next];
+
+    vnet_tx_fill_hdr(qp, slot, meta);
+    struct virtq_buf bufs[2] = {
+        { &slot->hdr, sizeof(slot->hdr) },
+        { slot->frame, length },
+    };
+    return vnet_tx_submit(qp, slot, bufs, 2, length);
+}
+
+// 等待本CPU队列上的发送全部完成，释放按引用发送的负载
+static void virtio_net_tx_drain(struct netdev *dev) {
+    (void)dev;
+    struct vnet_queue_pair *qp = vnet_local_pair();
+
+    for (int timeout = 1000000; timeout > 0; timeout--) {
+        vnet_tx_reclaim(qp);
+
+        bool busy = false;
+        for (int t = 0; t < VIRTIO_NET_TX_SLOTS; t++) {
+            if (qp->tx_slots[t].busy) {
+                busy = true;
+                break;
+            }
+        }
+        if (!busy) {
+            return;
+        }
+    }
+    serial_write_string("virtio-net: tx drain timeout\r\n");
+}
+
+// 处理本CPU队列上收到的帧
+static void virtio_net_poll(struct netdev *dev) {
+    (void)dev;
+    uint32_t cpu = smp_processor_id();
+
+    for (uint16_t i = 0; i < vnet_num_pairs; i++) {
+        struct vnet_queue_pair *qp = &vnet_pairs[i];
+        if (qp->cpu != cpu) {
+            continue;
+        }
+
+        // 有向量的队列只在中断到达后处理，没有向量的每次都轮询
+        if (!qp->rx_vector || qp->rx_pending) {
+            bool reposted = false;
+            struct vnet_rx_buf *buf;
+            uint32_t len;
+            // 同一批的帧都在这次轮询时被发现，排在后面的帧在驱动阶段等待更久
+            uint64_t found_tsc = tsc_read();
+            REGION_BEGIN(rx_parse);
+            while ((buf = virtq_get_used(&qp->rx, &len)) != NULL) {
+                if (len > sizeof(struct virtio_net_hdr)) {
+                    uint16_t frame_len = len - sizeof(struct virtio_net_hdr);
+
+                    // 没有设备提供的哈希，用软件Toeplitz计算流应该落在哪个CPU
+                    // 只有一个队列对时所有帧都归本CPU，不计算
+                    if (vnet_num_pairs > 1 && rss_select_cpu(rss_frame_hash(buf->frame, frame_len)) != cpu) {
+                        qp->stats.rx_steered_remote++;
+                    }
+
+                    // 协议栈不校验L4校验和，这里只统计设备的校验结果
+                    if (buf->hdr.flags & VIRTIO_NET_HDR_F_DATA_VALID) {
+                        qp->stats.rx_csum_valid++;
+                    } else if (buf->hdr.flags & VIRTIO_NET_HDR_F_NEEDS_CSUM) {
+                        qp->stats.rx_csum_partial++;
+                    }
+
+                    qp->stats.rx_packets++;
+                    qp->stats.rx_bytes += frame_len;
+                    REGION_END(REGION_RX_PARSE, rx_parse);
+                    netlat_rx_arrival(found_tsc);
+                    handle_network_packet(buf->frame, frame_len);
+                } else {
+                    qp->stats.rx_dropped++;
+                }
+
+                vnet_rx_post(qp, buf);
+                reposted = true;
+                REGION_RESTART(rx_parse);
+            }
+            if (reposted) {
+                virtq_kick(&qp->rx);
+            }
+            if (qp->rx_vector) {
+                // 清空后再打开中断; 打开前到达的帧不会再产生中断，重新检查一次
+                qp->rx_pending = false;
+                virtq_enable_interrupts(&qp->rx);
+                if (virtq_has_used(&qp->rx)) {
+                    virtq_disable_interrupts(&qp->rx);
+                    qp->rx_pending = true;
+                }
+            }
+        }
+
+        vnet_tx_reclaim(qp);
+    }
+}
+
+uint16_t virtio_net_num_queue_pairs(void) {
+    return vnet_num_pairs;
+}
+
+uint32_t virtio_net_queue_cpu(uint16_t pair) {
+    return vnet_pairs[pair].cpu;
+}
+
+const struct virtio_net_queue_stats *virtio_net_get_queue_stats(uint16_t pair) {
+    return &vnet_pairs[pair].stats;
+}
+
+// 输出每个队列的计数器
+void virtio_net_dump_stats(void) {
+    for (uint16_t i = 0; i < vnet_num_pairs; i++) {
+        const struct virtio_net_queue_stats *s = &vnet_pairs[i].stats;
+        serial_write_string("virtio-net q");
+        serial_write_dec(i);
+        serial_write_string(" cpu ");
+        serial_write_dec(vnet_pairs[i].cpu);
+        serial_write_string(": rx ");
+        serial_write_dec(s->rx_packets);
+        serial_write_string(" pkts/");
+        serial_write_dec(s->rx_bytes);
+        serial_write_string(" bytes drop ");
+        serial_write_dec(s->rx_dropped);
+        serial_write_string(" steered ");
+        serial_write_dec(s->rx_steered_remote);
+        serial_write_string(" irq ");
+        serial_write_dec(s->rx_irqs);
+        serial_write_string(" | tx ");
+        serial_write_dec(s->tx_packets);
+        serial_write_string(" pkts/");
+        serial_write_dec(s->tx_bytes);
+        serial_write_string(" bytes full ");
+        serial_write_dec(s->tx_ring_full);
+        serial_write_string(" csum ");
+        serial_write_dec(s->tx_csum_offload);
+        serial_write_string(" tso ");
+        serial_write_dec(s->tx_tso);
+        serial_write_string(" sg ");
+        serial_write_dec(s->tx_sg);
+        serial_write_string("\r\n");
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef VIRTIO_NET_H
+#define VIRTIO_NET_H
+
+#include "types.h"
+#include "cpu.h"
+#include "virtio.h"
+
+// PCI 配置 (transitional 设备ID)
+#define VIRTIO_NET_DEVICE_ID 0x1000
+
+// 特性位
+#define VIRTIO_NET_F_CSUM       (1u << 0)   // 设备可补全发送校验和
+#define VIRTIO_NET_F_GUEST_CSUM (1u << 1)   // 驱动接受部分校验和/已验证的接收帧
+#define VIRTIO_NET_F_MAC        (1u << 5)
+#define VIRTIO_NET_F_HOST_TSO4  (1u << 11)  // 设备可对TCPv4超长段分段
+#define VIRTIO_NET_F_STATUS     (1u << 16)
+#define VIRTIO_NET_F_CTRL_VQ    (1u << 17)
+#define VIRTIO_NET_F_MQ         (1u << 22)
+
+// virtio_net_hdr 标志和GSO类型
+#define VIRTIO_NET_HDR_F_NEEDS_CSUM  1
+#define VIRTIO_NET_HDR_F_DATA_VALID  2
+#define VIRTIO_NET_HDR_GSO_NONE      0
+#define VIRTIO_NET_HDR_GSO_TCPV4     1
+
+// 设备配置空间偏移
+#define VIRTIO_NET_CFG_MAC        0
+#define VIRTIO_NET_CFG_STATUS     6
+#define VIRTIO_NET_CFG_MAX_PAIRS  8
+
+// 控制队列命令
+#define VIRTIO_NET_CTRL_MQ               4
+#define VIRTIO_NET_CTRL_MQ_VQ_PAIRS_SET  0
+#define VIRTIO_NET_OK                    0
+
+// 队列对数上限 (每个CPU一对)
+#define VIRTIO_NET_MAX_PAIRS NR_CPUS
+
+// 每个队列预先提供的接收缓冲区和发送槽位数量
+#define VIRTIO_NET_RX_BUFS 32
+#define VIRTIO_NET_TX_SLOTS 16
+#define VIRTIO_NET_FRAME_MAX 1536
+
+// 每个帧前面的virtio-net头 (未协商 MRG_RXBUF)
+struct virtio_net_hdr {
+    uint8_t flags;
+    uint8_t gso_type;
+    uint16_t hdr_len;
+    uint16_t gso_size;
+    uint16_t csum_start;
+    uint16_t csum_offset;
+} __attribute__((packed));
+
+// 每个队列对的计数器
+struct virtio_net_queue_stats {
+    uint32_t rx_packets;
+    uint32_t rx_bytes;
+    uint32_t rx_dropped;
+    uint32_t rx_steered_remote;  // RSS 判定应由其他CPU处理的帧
+    uint32_t rx_irqs;            // RX队列的MSI-X中断
+    uint32_t rx_csum_valid;      // 设备已验证校验和
+    uint32_t rx_csum_partial;    // 主机送来的部分校验和帧
+    uint32_t tx_packets;
+    uint32_t tx_bytes;
+    uint32_t tx_ring_full;
+    uint32_t tx_completed;
+    uint32_t tx_csum_offload;    // 交给设备计算校验和的帧
+    uint32_t tx_tso;             // 交给设备分段的超长段
+    uint32_t tx_sg;              // 负载按引用发送的帧
+} __cacheline_aligned;
+
+// PCI驱动，由 kernel_main 注册
+struct pci_driver;
+extern struct pci_driver virtio_net_pci_driver;
+
+uint16_t virtio_net_num_queue_pairs(void);
+uint32_t virtio_net_queue_cpu(uint16_t pair);
+const struct virtio_net_queue_stats *virtio_net_get_queue_stats(uint16_t pair);
+void virtio_net_dump_stats(void);
+
+#endif // VIRTIO_NET_H